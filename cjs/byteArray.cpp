@@ -35,6 +35,7 @@
 typedef struct {
     GByteArray *array;
     GBytes     *bytes;
+    unsigned    borrowed;  /* C calls currently using array->data directly */
 } ByteArrayInstance;
 
 extern struct JSClass gjs_byte_array_class;
@@ -109,6 +110,30 @@ byte_array_ensure_gbytes (ByteArrayInstance  *priv)
     }
 }
 
+/* Arrays taken over from a GBytes don't clear new elements, so clear them
+ * here; reading them back should give zeroes either way */
+static void
+byte_array_set_size(ByteArrayInstance *priv,
+                    gsize              len)
+{
+    gsize old_len = priv->array->len;
+
+    g_byte_array_set_size(priv->array, len);
+    if (len > old_len)
+        memset(priv->array->data + old_len, 0, len - old_len);
+}
+
+static bool
+byte_array_check_not_borrowed(JSContext         *context,
+                              ByteArrayInstance *priv)
+{
+    if (priv->borrowed == 0)
+        return true;
+
+    gjs_throw(context, "Can't resize a ByteArray while a C function is using it");
+    return false;
+}
+
 static bool
 gjs_value_to_gsize(JSContext         *context,
                    JS::HandleValue    value,
@@ -258,7 +283,10 @@ byte_array_length_setter(JSContext *context,
                   "Can't set ByteArray length to non-integer");
         return false;
     }
-    g_byte_array_set_size(priv->array, len);
+    if (len != priv->array->len &&
+        !byte_array_check_not_borrowed(context, priv))
+        return false;
+    byte_array_set_size(priv, len);
     args.rval().setUndefined();
     return true;
 }
@@ -280,8 +308,9 @@ byte_array_set_index(JSContext         *context,
 
     /* grow the array if necessary */
     if (idx >= priv->array->len) {
-        g_byte_array_set_size(priv->array,
-                              idx + 1);
+        if (!byte_array_check_not_borrowed(context, priv))
+            return false;
+        byte_array_set_size(priv, idx + 1);
     }
 
     g_array_index(priv->array, guint8, idx) = v;
@@ -487,6 +516,80 @@ to_string_func(JSContext *context,
     }
 }
 
+/* implement parseJSON(), which parses the contents as UTF-8 encoded JSON
+ * without first creating a JS string from them */
+static bool
+parse_json_func(JSContext *context,
+                unsigned   argc,
+                JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, to, ByteArrayInstance, priv);
+    static const char16_t empty[] = { 0 };
+    guint8 *data;
+    gsize len;
+    char16_t *u16_data;
+    glong u16_len;
+    bool ok;
+
+    if (priv == NULL)
+        return true; /* prototype, not instance */
+
+    gjs_byte_array_peek_data(context, to, &data, &len);
+
+    /* A byte order mark is a common leftover of text editors */
+    if (len >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+        data += 3;
+        len -= 3;
+    }
+
+    if (len == 0)
+        return JS_ParseJSON(context, empty, 0, argv.rval());
+
+    if (len > G_MAXUINT32) {
+        gjs_throw(context, "ByteArray is too long to parse as JSON");
+        return false;
+    }
+
+    /* Most JSON is ASCII, which only needs widening */
+    gsize i;
+    for (i = 0; i < len; i++) {
+        if (data[i] >= 0x80)
+            break;
+    }
+
+    if (i == len) {
+        u16_data = g_new(char16_t, len);
+        for (i = 0; i < len; i++)
+            u16_data[i] = data[i];
+        u16_len = len;
+    } else {
+        GError *error = NULL;
+        glong items_read;
+        u16_data = reinterpret_cast<char16_t *>(g_utf8_to_utf16((const char *) data,
+                                                                len, &items_read,
+                                                                &u16_len, &error));
+        if (!u16_data) {
+            gjs_throw(context, "Failed to convert UTF-8 string to JS string: %s",
+                      error->message);
+            g_error_free(error);
+            return false;
+        }
+
+        /* g_utf8_to_utf16() stops quietly at a NUL byte; reject it here as
+         * JS_ParseJSON() does for the widened ASCII */
+        if ((gsize) items_read != len) {
+            g_free(u16_data);
+            gjs_throw(context, "Can't parse a ByteArray containing a NUL byte "
+                      "at offset %ld as JSON", items_read);
+            return false;
+        }
+    }
+
+    ok = JS_ParseJSON(context, u16_data, u16_len, argv.rval());
+    g_free(u16_data);
+    return ok;
+}
+
 static bool
 to_gbytes_func(JSContext *context,
                unsigned   argc,
@@ -499,11 +602,12 @@ to_gbytes_func(JSContext *context,
     if (priv == NULL)
         return true; /* prototype, not instance */
 
-    byte_array_ensure_gbytes(priv);
+    GBytes *bytes = gjs_byte_array_get_bytes(context, to);
 
     gbytes_info = g_irepository_find_by_gtype(NULL, G_TYPE_BYTES);
     ret_bytes_obj = gjs_boxed_from_c_struct(context, (GIStructInfo*)gbytes_info,
-                                            priv->bytes, GJS_BOXED_CREATION_NONE);
+                                            bytes, GJS_BOXED_CREATION_NONE);
+    g_bytes_unref(bytes);
 
     rec.rval().setObjectOrNull(ret_bytes_obj);
     return true;
@@ -710,7 +814,6 @@ from_gbytes_func(JSContext *context,
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
     JS::RootedObject bytes_obj(context);
     GBytes *gbytes;
-    ByteArrayInstance *priv;
 
     if (!gjs_parse_call_args(context, "overrides_gbytes_to_array", argv, "o",
                              "bytes", &bytes_obj))
@@ -721,18 +824,31 @@ from_gbytes_func(JSContext *context,
 
     gbytes = (GBytes*) gjs_c_struct_from_boxed(context, bytes_obj);
 
-    JS::RootedObject obj(context, byte_array_new(context));
+    JSObject *obj = gjs_byte_array_from_bytes(context, gbytes);
     if (obj == NULL)
         return false;
-    priv = priv_from_js(context, obj);
-    g_assert (priv != NULL);
-
-    priv->bytes = g_bytes_ref(gbytes);
 
     argv.rval().setObject(*obj);
     return true;
 }
 
+/* Shares @bytes with the new ByteArray until it is modified */
+JSObject *
+gjs_byte_array_from_bytes(JSContext *context,
+                          GBytes    *bytes)
+{
+    ByteArrayInstance *priv;
+
+    JS::RootedObject obj(context, byte_array_new(context));
+    if (obj == NULL)
+        return NULL;
+    priv = priv_from_js(context, obj);
+    g_assert (priv != NULL);
+
+    priv->bytes = g_bytes_ref(bytes);
+    return obj;
+}
+
 JSObject *
 gjs_byte_array_from_byte_array (JSContext *context,
                                 GByteArray *array)
@@ -769,6 +885,11 @@ gjs_byte_array_get_bytes (JSContext       *context,
     priv = priv_from_js(context, object);
     g_assert(priv != NULL);
 
+    /* Turning the array into a GBytes would hand its data to the GBytes,
+     * which the C function borrowing it can't keep alive */
+    if (priv->borrowed > 0)
+        return g_bytes_new(priv->array->data, priv->array->len);
+
     byte_array_ensure_gbytes(priv);
 
     return g_bytes_ref (priv->bytes);
@@ -807,6 +928,42 @@ gjs_byte_array_peek_data (JSContext       *context,
     }
 }
 
+/* Hands out the data of a ByteArray to a C function without copying it.
+ * Returns false if the ByteArray is backed by a GBytes, whose data must not
+ * be written to. Otherwise the ByteArray can't be resized until
+ * gjs_byte_array_return_data() is called.
+ */
+bool
+gjs_byte_array_borrow_data(JSContext       *context,
+                           JS::HandleObject obj,
+                           guint8         **out_data,
+                           gsize           *out_len)
+{
+    ByteArrayInstance *priv;
+    priv = priv_from_js(context, obj);
+    g_assert(priv != NULL);
+
+    if (priv->array == NULL)
+        return false;
+
+    priv->borrowed++;
+    *out_data = (guint8*)priv->array->data;
+    *out_len = (gsize)priv->array->len;
+    return true;
+}
+
+void
+gjs_byte_array_return_data(JSContext       *context,
+                           JS::HandleObject obj)
+{
+    ByteArrayInstance *priv;
+    priv = priv_from_js(context, obj);
+    g_assert(priv != NULL);
+    g_assert(priv->borrowed > 0);
+
+    priv->borrowed--;
+}
+
 static JSPropertySpec gjs_byte_array_proto_props[] = {
     JS_PSGS("length", byte_array_length_getter, byte_array_length_setter,
             JSPROP_PERMANENT),
@@ -816,6 +973,7 @@ static JSPropertySpec gjs_byte_array_proto_props[] = {
 static JSFunctionSpec gjs_byte_array_proto_funcs[] = {
     JS_FS("toString", to_string_func, 0, 0),
     JS_FS("toGBytes", to_gbytes_func, 0, 0),
+    JS_FS("parseJSON", parse_json_func, 0, 0),
     JS_FS_END
 };
 
@@ -290,8 +290,14 @@ main(int argc, char **argv)
     g_strfreev(gjs_argv_addr);
 
     /* Probably doesn't make sense to write statistics on failure */
-    if (coverage && code == 0)
-        gjs_coverage_write_statistics(coverage);
+    if (coverage && code == 0) {
+        /* Binary records are much cheaper to write when many processes
+         * contribute to the same report; see cjs-coverage-merge */
+        if (g_strcmp0(g_getenv("GJS_COVERAGE_FORMAT"), "record") == 0)
+            gjs_coverage_write_record(coverage);
+        else
+            gjs_coverage_write_statistics(coverage);
+    }
 
     g_free(coverage_output_path);
     g_strfreev(coverage_prefixes);
@@ -27,6 +27,7 @@
 #include <inttypes.h>
 
 #include "context.h"
+#include "jsapi-wrapper.h"
 
 G_BEGIN_DECLS
 
@@ -42,6 +43,14 @@ bool _gjs_context_get_is_owner_thread(GjsContext *js_context);
 bool _gjs_context_should_exit(GjsContext *js_context,
                               uint8_t    *exit_code_p);
 
+JSObject *_gjs_context_lookup_error_proto(GjsContext *js_context,
+                                          GQuark      domain);
+void _gjs_context_remember_error_proto(GjsContext *js_context,
+                                       GQuark      domain,
+                                       JSObject   *proto);
+
+GHashTable *_gjs_context_get_fundamental_table(GjsContext *js_context);
+
 G_END_DECLS
 
 #endif  /* __GJS_CONTEXT_PRIVATE_H__ */
@@ -24,6 +24,7 @@
 #include <config.h>
 
 #include <array>
+#include <unordered_map>
 
 #include <gio/gio.h>
 
@@ -34,10 +35,14 @@
 #include "jsapi-util.h"
 #include "jsapi-wrapper.h"
 #include "native.h"
+#include "profiler-private.h"
 #include "byteArray.h"
 #include "runtime.h"
+#include "gi/function.h"
+#include "gi/gjs_gi_trace.h"
 #include "gi/object.h"
 #include "gi/repo.h"
+#include "gi/toggle.h"
 
 #include <modules/modules.h>
 
@@ -50,6 +55,7 @@
 #include <windows.h>
 #endif
 
+#include <errno.h>
 #include <string.h>
 
 static void     gjs_context_dispose           (GObject               *object);
@@ -82,16 +88,26 @@ struct _GjsContext {
 
     guint    auto_gc_id;
 
+    GjsProfiler *profiler;
+
     std::array<JS::PersistentRootedId*, GJS_STRING_LAST> const_strings;
+
+    /* Prototypes of the GError domains defined so far, see gi/gerror.cpp.
+     * They are traced, not weak: each is also reachable from its namespace
+     * object, which lives as long as the context does. */
+    std::unordered_map<GQuark, JS::Heap<JSObject *>> *error_protos;
+
+    /* Native fundamental instance -> JS wrapper, see gi/fundamental.cpp */
+    GHashTable *fundamental_table;
 };
 
 /* Keep this consistent with GjsConstString */
 static const char *const_strings[] = {
     "constructor", "prototype", "length",
     "imports", "__parentModule__", "__init__", "searchPath",
-    "__gjsKeepAlive", "__gjsPrivateNS",
+    "__gjsKeepAlive", "__gjsPrivateNS", "__gjsDBusObject",
     "gi", "versions", "overrides",
-    "_init", "_instance_init", "_new_internal", "new",
+    "_init", "_instance_init", "new",
     "message", "code", "stack", "fileName", "lineNumber", "name",
     "x", "y", "width", "height", "__modulePath__"
 };
@@ -276,8 +292,32 @@ on_garbage_collect(JSRuntime *rt,
      * so that we can collect the JS wrapper objects, and in order to minimize
      * the chances of objects having a pending toggle up queued when they are
      * garbage collected. */
-    if (status == JSGC_BEGIN)
-        gjs_object_clear_toggles();
+    if (status == JSGC_BEGIN) {
+        TRACE(GJS_GC_BEGIN());
+        int64_t start = g_get_monotonic_time();
+        unsigned n_toggles = gjs_object_clear_toggles();
+        _gjs_gc_telemetry_toggles_drained(gjs_runtime_get_gc_telemetry(rt),
+                                          n_toggles,
+                                          g_get_monotonic_time() - start);
+    } else if (status == JSGC_END) {
+        TRACE(GJS_GC_END());
+    }
+}
+
+static void
+on_gc_slice(JSRuntime                *rt,
+            JS::GCProgress            progress,
+            const JS::GCDescription&  desc)
+{
+    /* The first and last slices are reported as the cycle's beginning and
+     * end */
+    if (progress == JS::GC_CYCLE_BEGIN || progress == JS::GC_SLICE_BEGIN)
+        TRACE(GJS_GC_SLICE_BEGIN());
+    else
+        TRACE(GJS_GC_SLICE_END());
+
+    _gjs_gc_telemetry_gc_progress(gjs_runtime_get_gc_telemetry(rt), rt,
+                                  progress, desc);
 }
 
 /* Requires request, does not throw error */
@@ -386,6 +426,9 @@ gjs_context_tracer(JSTracer *trc, void *data)
 {
     GjsContext *gjs_context = reinterpret_cast<GjsContext *>(data);
     JS_CallObjectTracer(trc, &gjs_context->global, "GJS global object");
+
+    for (auto& entry : *gjs_context->error_protos)
+        JS_CallObjectTracer(trc, &entry.second, "GError domain prototype");
 }
 
 static void
@@ -415,6 +458,18 @@ gjs_context_dispose(GObject *object)
 
         js_context->destroying = true;
 
+        if (gjs_function_stats_get_enabled()) {
+            const char *max_entries = g_getenv("GJS_FUNCTION_STATS");
+            unsigned n = g_ascii_strtoull(max_entries ? max_entries : "", NULL, 10);
+            char *report = gjs_function_stats_format(n > 0 ? n : 20);
+            g_printerr("%s", report);
+            g_free(report);
+        }
+
+        /* Stop sampling before anything is torn down, so that the profile
+         * still gets written and the signal handler can't see a dead stack */
+        g_clear_pointer(&js_context->profiler, _gjs_profiler_free);
+
         /* Now, release all native objects, to avoid recursion between
          * the JS teardown and the C teardown.  The JSObject proxies
          * still exist, but point to NULL.
@@ -432,6 +487,8 @@ gjs_context_dispose(GObject *object)
 
         for (auto& root : js_context->const_strings)
             delete root;
+        delete js_context->error_protos;
+        js_context->error_protos = NULL;
 
         /* Tear down JS */
         JS_DestroyContext(js_context->context);
@@ -464,6 +521,8 @@ gjs_context_finalize(GObject *object)
     all_contexts = g_list_remove(all_contexts, object);
     g_mutex_unlock(&contexts_lock);
 
+    g_clear_pointer(&js_context->fundamental_table, g_hash_table_unref);
+
     js_context->global.~Heap();
     G_OBJECT_CLASS(gjs_context_parent_class)->finalize(object);
 }
@@ -499,9 +558,13 @@ gjs_context_constructed(GObject *object)
                 gjs_intern_string_to_id(js_context->context, const_strings[i]));
     }
 
+    js_context->error_protos = new std::unordered_map<GQuark, JS::Heap<JSObject *>>();
+    js_context->fundamental_table = g_hash_table_new(NULL, NULL);
+
     JS_BeginRequest(js_context->context);
 
     JS_SetGCCallback(js_context->runtime, on_garbage_collect, js_context);
+    JS::SetGCSliceCallback(js_context->runtime, on_gc_slice);
 
     /* set ourselves as the private data */
     JS_SetContextPrivate(js_context->context, js_context);
@@ -549,6 +612,23 @@ gjs_context_constructed(GObject *object)
 
     JS_EndRequest(js_context->context);
 
+    js_context->profiler = _gjs_profiler_new(js_context);
+
+    if (g_getenv("GJS_FUNCTION_STATS"))
+        gjs_function_stats_set_enabled(true);
+
+    if (g_getenv("GJS_ENABLE_PROFILER")) {
+        const char *output = g_getenv("GJS_PROFILER_OUTPUT");
+        const char *frequency = g_getenv("GJS_PROFILER_FREQUENCY");
+
+        if (output)
+            gjs_profiler_set_filename(js_context->profiler, output);
+        if (frequency)
+            gjs_profiler_set_frequency(js_context->profiler,
+                                       g_ascii_strtoull(frequency, NULL, 10));
+        gjs_profiler_start(js_context->profiler);
+    }
+
     g_mutex_lock (&contexts_lock);
     all_contexts = g_list_prepend(all_contexts, object);
     g_mutex_unlock (&contexts_lock);
@@ -709,6 +789,74 @@ gjs_context_gc (GjsContext  *context)
     JS_GC(context->runtime);
 }
 
+/**
+ * gjs_context_get_gc_stats:
+ * @context: a #GjsContext
+ * @stats: (out caller-allocates): return location for the statistics
+ *
+ * Fills in @stats with the recent garbage collection activity of the
+ * context's runtime: how long the GCs and their slices took, the heap size
+ * around the last GC, and how much work the toggle queue and the wrapper
+ * bookkeeping added to it.
+ */
+void
+gjs_context_get_gc_stats(GjsContext *context,
+                         GjsGCStats *stats)
+{
+    g_return_if_fail(GJS_IS_CONTEXT(context));
+    g_return_if_fail(stats);
+
+    _gjs_gc_telemetry_get_stats(gjs_runtime_get_gc_telemetry(context->runtime),
+                                stats);
+    stats->toggle_queue_high_water = ToggleQueue::get_default().high_water_mark();
+}
+
+/**
+ * gjs_context_dump_heap:
+ * @context: a #GjsContext
+ * @filename: file to write the snapshot to
+ * @error: return location for a #GError
+ *
+ * Writes every GC thing in the context's runtime, with its outgoing edges
+ * and the GC roots, in SpiderMonkey's heap dump format. A final
+ * "# GI wrappers." section describes the GObject behind each wrapper, so
+ * that tools can summarize the heap by type.
+ *
+ * Returns: %true on success
+ */
+bool
+gjs_context_dump_heap(GjsContext  *context,
+                      const char  *filename,
+                      GError     **error)
+{
+    g_return_val_if_fail(GJS_IS_CONTEXT(context), false);
+    g_return_val_if_fail(filename, false);
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        int errsv = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                    "Failed to open %s for writing: %s", filename,
+                    g_strerror(errsv));
+        return false;
+    }
+
+    JSAutoRequest ar(context->context);
+    js::DumpHeap(context->runtime, fp, js::CollectNurseryBeforeDump);
+
+    fputs("# GI wrappers.\n", fp);
+    gjs_object_dump_wrappers(fp);
+
+    if (fclose(fp) != 0) {
+        int errsv = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                    "Failed to write %s: %s", filename, g_strerror(errsv));
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * gjs_context_get_all:
  *
@@ -744,6 +892,20 @@ gjs_context_get_native_context (GjsContext *js_context)
     return js_context->context;
 }
 
+/**
+ * gjs_context_get_profiler:
+ *
+ * Returns the sampling profiler for this context. It is owned by the
+ * context, and is not running unless started with gjs_profiler_start() or
+ * the GJS_ENABLE_PROFILER environment variable.
+ */
+GjsProfiler *
+gjs_context_get_profiler(GjsContext *js_context)
+{
+    g_return_val_if_fail(GJS_IS_CONTEXT(js_context), NULL);
+    return js_context->profiler;
+}
+
 bool
 gjs_context_eval(GjsContext   *js_context,
                  const char   *script,
@@ -877,6 +1039,30 @@ gjs_context_make_current (GjsContext *context)
     current_context = context;
 }
 
+JSObject *
+_gjs_context_lookup_error_proto(GjsContext *js_context,
+                                GQuark      domain)
+{
+    auto entry = js_context->error_protos->find(domain);
+    if (entry == js_context->error_protos->end())
+        return NULL;
+    return entry->second;
+}
+
+void
+_gjs_context_remember_error_proto(GjsContext *js_context,
+                                  GQuark      domain,
+                                  JSObject   *proto)
+{
+    (*js_context->error_protos)[domain] = proto;
+}
+
+GHashTable *
+_gjs_context_get_fundamental_table(GjsContext *js_context)
+{
+    return js_context->fundamental_table;
+}
+
 /* It's OK to return JS::HandleId here, to avoid an extra root, with the
  * caveat that you should not use this value after the GjsContext has
  * been destroyed. */
@@ -32,6 +32,7 @@
 #include <glib-object.h>
 
 #include <cjs/macros.h>
+#include <cjs/profiler.h>
 
 G_BEGIN_DECLS
 
@@ -82,6 +83,9 @@ void            gjs_context_make_current         (GjsContext *js_context);
 GJS_EXPORT
 void*           gjs_context_get_native_context   (GjsContext *js_context);
 
+GJS_EXPORT
+GjsProfiler    *gjs_context_get_profiler          (GjsContext *js_context);
+
 GJS_EXPORT
 void            gjs_context_print_stack_stderr    (GjsContext *js_context);
 
@@ -91,6 +95,47 @@ void            gjs_context_maybe_gc              (GjsContext  *context);
 GJS_EXPORT
 void            gjs_context_gc                    (GjsContext  *context);
 
+/* GC pauses and toggle queue drains are kept for the last few hundred
+ * events and summarized as a histogram. buckets[i] counts the events that
+ * took less than gjs_gc_histogram_bucket_limit_ms(i), 2^i / 4 ms, and at
+ * least the previous bucket's limit; the last bucket's limit is infinite. */
+#define GJS_GC_HISTOGRAM_N_BUCKETS 12
+
+typedef struct {
+    unsigned n_samples;
+    double   min_ms;
+    double   max_ms;
+    double   mean_ms;
+    unsigned buckets[GJS_GC_HISTOGRAM_N_BUCKETS];
+} GjsGCHistogram;
+
+typedef struct {
+    unsigned       n_gcs;  /* since the runtime was created */
+    unsigned       n_slices;
+    char           last_reason[32];  /* empty unless GJS_GC_REASON is set */
+    guint64        heap_bytes_before;  /* of the last GC */
+    guint64        heap_bytes_after;
+    GjsGCHistogram pauses;  /* total time in slices, per GC */
+    GjsGCHistogram slices;
+    GjsGCHistogram toggle_drains;  /* draining the toggle queue before GC */
+    unsigned       toggle_queue_high_water;
+    unsigned       toggles_drained;  /* before the last GC */
+    unsigned       wrappers_disassociated;  /* by the last GC */
+    guint64        total_wrappers_disassociated;
+} GjsGCStats;
+
+GJS_EXPORT
+void            gjs_context_get_gc_stats          (GjsContext  *context,
+                                                   GjsGCStats  *stats);
+
+GJS_EXPORT
+double          gjs_gc_histogram_bucket_limit_ms  (unsigned     bucket);
+
+GJS_EXPORT
+bool            gjs_context_dump_heap             (GjsContext  *context,
+                                                   const char  *filename,
+                                                   GError     **error);
+
 GJS_EXPORT
 void            gjs_dumpstack                     (void);
 
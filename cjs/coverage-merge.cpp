@@ -0,0 +1,120 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Merges the binary coverage records written by processes run with
+ * GJS_COVERAGE_FORMAT=record into a single lcov report. */
+
+#include <config.h>
+#include <stdlib.h>
+
+#include <gio/gio.h>
+
+#include <cjs/gjs.h>
+
+static char *output_path = NULL;
+static char **record_paths = NULL;
+
+static GOptionEntry entries[] = {
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Write coverage.lcov and the covered sources to directory DIR", "DIR" },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &record_paths, NULL, "RECORD|DIR..." },
+    { NULL }
+};
+
+/* Directories are expanded to the records they contain, so that the
+ * command line stays short when thousands of processes were run */
+static bool
+collect_records(GPtrArray  *records,
+                const char *path,
+                GError    **error)
+{
+    GFile *file = g_file_new_for_commandline_arg(path);
+
+    if (g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE, NULL) != G_FILE_TYPE_DIRECTORY) {
+        g_ptr_array_add(records, file);
+        return true;
+    }
+
+    GFileEnumerator *enumerator =
+        g_file_enumerate_children(file, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                  G_FILE_QUERY_INFO_NONE, NULL, error);
+    if (!enumerator) {
+        g_object_unref(file);
+        return false;
+    }
+
+    GFileInfo *info;
+    while ((info = g_file_enumerator_next_file(enumerator, NULL, error))) {
+        const char *name = g_file_info_get_name(info);
+        if (g_str_has_suffix(name, ".record"))
+            g_ptr_array_add(records, g_file_get_child(file, name));
+        g_object_unref(info);
+    }
+
+    g_object_unref(enumerator);
+    g_object_unref(file);
+    return error == NULL || *error == NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    int code = 0;
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+        g_error("option parsing failed: %s", error->message);
+    g_option_context_free(context);
+
+    if (!output_path || !record_paths) {
+        g_printerr("Usage: %s --output DIR RECORD|DIR...\n", g_get_prgname());
+        exit(2);
+    }
+
+    GPtrArray *records = g_ptr_array_new_with_free_func(g_object_unref);
+    for (char **iter = record_paths; *iter; ++iter) {
+        if (!collect_records(records, *iter, &error)) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            code = 1;
+            goto out;
+        }
+    }
+
+    {
+        GFile *output_dir = g_file_new_for_commandline_arg(output_path);
+        if (!gjs_coverage_merge_records(output_dir, (GFile **) records->pdata,
+                                        records->len, &error)) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            code = 1;
+        }
+        g_object_unref(output_dir);
+    }
+
+ out:
+    g_ptr_array_unref(records);
+    g_strfreev(record_paths);
+    g_free(output_path);
+    return code;
+}
@@ -21,12 +21,19 @@
 #include <sys/stat.h>
 #include <gio/gio.h>
 
+#ifdef G_OS_WIN32
+# include <process.h>
+#else
+# include <unistd.h>
+#endif
+
 #include <cjs/context.h>
 
 #include "coverage.h"
 #include "coverage-internal.h"
 #include "importer.h"
 #include "jsapi-util-args.h"
+#include "runtime.h"
 #include "util/error.h"
 
 struct _GjsCoverage {
@@ -1166,6 +1173,50 @@ coverage_statistics_has_stale_cache(GjsCoverage *coverage)
 
 static unsigned int _suppressed_coverage_messages_count = 0;
 
+static bool
+ensure_output_directory(GFile *output_dir)
+{
+    GError *error = NULL;
+
+    /* Create output directory if it doesn't exist */
+    if (!g_file_make_directory_with_parents(output_dir, NULL, &error)) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+            g_critical("Could not create coverage output: %s", error->message);
+            g_clear_error(&error);
+            return false;
+        }
+        g_clear_error(&error);
+    }
+
+    return true;
+}
+
+static void
+write_cache_if_stale(GjsCoverage *coverage)
+{
+    GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
+
+    const bool has_cache_path = priv->cache != NULL;
+    const bool cache_is_stale = coverage_statistics_has_stale_cache(coverage);
+
+    if (has_cache_path && cache_is_stale) {
+        GBytes *cache_data = gjs_serialize_statistics(coverage);
+        gjs_write_cache_file(priv->cache, cache_data);
+        g_bytes_unref(cache_data);
+    }
+}
+
+static void
+report_suppressed_coverage_messages(void)
+{
+    if (_suppressed_coverage_messages_count) {
+        g_message("There were %i suppressed message(s) when collecting "
+                  "coverage, set GJS_SHOW_COVERAGE_MESSAGES to see them.",
+                  _suppressed_coverage_messages_count);
+        _suppressed_coverage_messages_count = 0;
+    }
+}
+
 /**
  * gjs_coverage_write_statistics:
  * @coverage: A #GjsCoverage
@@ -1189,15 +1240,8 @@ gjs_coverage_write_statistics(GjsCoverage *coverage)
     JSAutoCompartment compartment(context, priv->coverage_statistics);
     JSAutoRequest ar(context);
 
-    /* Create output directory if it doesn't exist */
-    if (!g_file_make_directory_with_parents(priv->output_dir, NULL, &error)) {
-        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
-            g_critical("Could not create coverage output: %s", error->message);
-            g_clear_error(&error);
-            return;
-        }
-        g_clear_error(&error);
-    }
+    if (!ensure_output_directory(priv->output_dir))
+        return;
 
     GFile *output_file = g_file_get_child(priv->output_dir, "coverage.lcov");
 
@@ -1228,23 +1272,11 @@ gjs_coverage_write_statistics(GjsCoverage *coverage)
 
     g_strfreev(executed_coverage_files);
 
-    const bool has_cache_path = priv->cache != NULL;
-    const bool cache_is_stale = coverage_statistics_has_stale_cache(coverage);
-
-    if (has_cache_path && cache_is_stale) {
-        GBytes *cache_data = gjs_serialize_statistics(coverage);
-        gjs_write_cache_file(priv->cache, cache_data);
-        g_bytes_unref(cache_data);
-    }
+    write_cache_if_stale(coverage);
 
     char *output_file_path = g_file_get_path(priv->output_dir);
     g_message("Wrote coverage statistics to %s", output_file_path);
-    if (_suppressed_coverage_messages_count) {
-        g_message("There were %i suppressed message(s) when collecting "
-                  "coverage, set GJS_SHOW_COVERAGE_MESSAGES to see them.",
-                  _suppressed_coverage_messages_count);
-        _suppressed_coverage_messages_count = 0;
-    }
+    report_suppressed_coverage_messages();
 
     g_free(output_file_path);
     g_array_unref(file_statistics_array);
@@ -1252,6 +1284,527 @@ gjs_coverage_write_statistics(GjsCoverage *coverage)
     g_object_unref(output_file);
 }
 
+/* Coverage records are the binary counterpart of the lcov output. Each
+ * process writes one record, and the records are merged afterwards by
+ * gjs_coverage_merge_records(). A record is a GVariant in serialized form,
+ * so it can be mapped and read in place:
+ *
+ * (
+ *     uint32 version;
+ *     array [ tuple {
+ *         string checksum;
+ *         string filename;
+ *         array [
+ *             int hit_count;       (-1 for a non-executable line)
+ *         ] lines;
+ *         array [ tuple {
+ *             uint32 branch_point;
+ *             bool hit;
+ *             array [ tuple {
+ *                 uint32 line;
+ *                 uint32 hit_count;
+ *             } ] exits;
+ *         } ] branches;
+ *         array [ tuple {
+ *             string key;
+ *             uint32 line;
+ *             uint32 hit_count;
+ *         } ] functions;
+ *     } file ] files;
+ * )
+ *
+ * Files are identified by the checksum of their contents together with
+ * their name, so that statistics for different revisions of a file are
+ * never summed.
+ */
+#define COVERAGE_RECORD_FILE_DATA_TYPE "(ssaia(uba(uu))a(suu))"
+static const char *COVERAGE_RECORD_DATA_TYPE = "(ua" COVERAGE_RECORD_FILE_DATA_TYPE ")";
+static const unsigned COVERAGE_RECORD_VERSION = 1;
+
+static GVariant *
+file_statistics_to_variant(GjsCoverageFileStatistics *statistics,
+                           const char                *checksum)
+{
+    GVariantBuilder lines;
+    g_variant_builder_init(&lines, G_VARIANT_TYPE("ai"));
+    for (unsigned i = 0; i < statistics->lines->len; ++i)
+        g_variant_builder_add(&lines, "i", g_array_index(statistics->lines, int, i));
+
+    GVariantBuilder branches;
+    g_variant_builder_init(&branches, G_VARIANT_TYPE("a(uba(uu))"));
+    for (unsigned i = 0; i < statistics->branches->len; ++i) {
+        GjsCoverageBranch *branch = &(g_array_index(statistics->branches, GjsCoverageBranch, i));
+
+        GVariantBuilder exits;
+        g_variant_builder_init(&exits, G_VARIANT_TYPE("a(uu)"));
+        for (unsigned j = 0; j < branch->exits->len; ++j) {
+            GjsCoverageBranchExit *exit = &(g_array_index(branch->exits, GjsCoverageBranchExit, j));
+            g_variant_builder_add(&exits, "(uu)", exit->line, exit->hit_count);
+        }
+
+        g_variant_builder_add(&branches, "(uba(uu))", branch->point,
+                              (gboolean) branch->hit, &exits);
+    }
+
+    GVariantBuilder functions;
+    g_variant_builder_init(&functions, G_VARIANT_TYPE("a(suu)"));
+    for (unsigned i = 0; i < statistics->functions->len; ++i) {
+        GjsCoverageFunction *function = &(g_array_index(statistics->functions, GjsCoverageFunction, i));
+        g_variant_builder_add(&functions, "(suu)",
+                              function->key ? function->key : "",
+                              function->line_number, function->hit_count);
+    }
+
+    return g_variant_new(COVERAGE_RECORD_FILE_DATA_TYPE, checksum,
+                         statistics->filename, &lines, &branches, &functions);
+}
+
+/**
+ * gjs_coverage_write_record:
+ * @coverage: A #GjsCoverage
+ *
+ * Like gjs_coverage_write_statistics(), but instead of appending to
+ * coverage.lcov, writes the statistics as a binary record to a file with
+ * a unique name in the output directory. This is much cheaper for large
+ * test suites running many processes; use gjs_coverage_merge_records() to
+ * combine the records into lcov format afterwards.
+ */
+void
+gjs_coverage_write_record(GjsCoverage *coverage)
+{
+    GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
+    GError *error = NULL;
+
+    JSContext *context = (JSContext *) gjs_context_get_native_context(priv->context);
+    JSAutoCompartment compartment(context, priv->coverage_statistics);
+    JSAutoRequest ar(context);
+
+    if (!ensure_output_directory(priv->output_dir))
+        return;
+
+    char **executed_coverage_files = get_covered_files(coverage);
+    if (!executed_coverage_files)
+        return;
+
+    GArray *file_statistics_array = gjs_fetch_statistics_from_js(coverage,
+                                                                 executed_coverage_files);
+    g_strfreev(executed_coverage_files);
+
+    GVariantBuilder files;
+    g_variant_builder_init(&files, G_VARIANT_TYPE("a" COVERAGE_RECORD_FILE_DATA_TYPE));
+
+    for (size_t i = 0; i < file_statistics_array->len; ++i) {
+        GjsCoverageFileStatistics *statistics = &(g_array_index(file_statistics_array, GjsCoverageFileStatistics, i));
+        GFile *source = g_file_new_for_commandline_arg(statistics->filename);
+        char *checksum = gjs_get_file_checksum(source);
+        g_object_unref(source);
+
+        g_variant_builder_add_value(&files,
+                                    file_statistics_to_variant(statistics,
+                                                               checksum ? checksum : ""));
+        g_free(checksum);
+    }
+
+    g_array_unref(file_statistics_array);
+
+    GVariant *record = g_variant_ref_sink(g_variant_new(COVERAGE_RECORD_DATA_TYPE,
+                                                        COVERAGE_RECORD_VERSION,
+                                                        &files));
+
+    char *record_name = g_strdup_printf("coverage-%u-%08x.record",
+                                        (unsigned) getpid(), g_random_int());
+    GFile *record_file = g_file_get_child(priv->output_dir, record_name);
+    g_free(record_name);
+
+    if (!g_file_replace_contents(record_file,
+                                 (const char *) g_variant_get_data(record),
+                                 g_variant_get_size(record),
+                                 NULL,
+                                 false,
+                                 G_FILE_CREATE_NONE,
+                                 NULL,
+                                 NULL,
+                                 &error)) {
+        char *path = get_file_identifier(record_file);
+        g_critical("Failed to write coverage record %s: %s", path, error->message);
+        g_free(path);
+        g_clear_error(&error);
+    }
+
+    g_object_unref(record_file);
+    g_variant_unref(record);
+
+    write_cache_if_stale(coverage);
+    report_suppressed_coverage_messages();
+}
+
+typedef struct _GjsCoverageMergedFile {
+    char                      *checksum;
+    GjsCoverageFileStatistics  statistics;
+} GjsCoverageMergedFile;
+
+static GjsCoverageMergedFile *
+merged_file_new(const char *checksum,
+                const char *filename)
+{
+    GjsCoverageMergedFile *merged = g_new0(GjsCoverageMergedFile, 1);
+    merged->checksum = g_strdup(checksum);
+    merged->statistics.filename = g_strdup(filename);
+    merged->statistics.lines = g_array_new(true, true, sizeof(int));
+    merged->statistics.functions = g_array_new(true, true, sizeof(GjsCoverageFunction));
+    g_array_set_clear_func(merged->statistics.functions, clear_coverage_function);
+    merged->statistics.branches = g_array_new(true, true, sizeof(GjsCoverageBranch));
+    g_array_set_clear_func(merged->statistics.branches, clear_coverage_branch);
+    return merged;
+}
+
+static void
+merged_file_free(gpointer data)
+{
+    GjsCoverageMergedFile *merged = (GjsCoverageMergedFile *) data;
+    g_free(merged->checksum);
+    gjs_coverage_statistics_file_statistics_clear(&merged->statistics);
+    g_free(merged);
+}
+
+static GHashTable *
+merged_files_new(void)
+{
+    return g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                 merged_file_free);
+}
+
+static void
+merge_line_hits(GArray        *lines,
+                const int32_t *hits,
+                gsize          n_hits)
+{
+    for (unsigned i = lines->len; i < n_hits; ++i) {
+        int not_executable = -1;
+        g_array_append_val(lines, not_executable);
+    }
+
+    for (gsize i = 0; i < n_hits; ++i) {
+        if (hits[i] == -1)
+            continue;
+
+        int *hit_count = &(g_array_index(lines, int, i));
+        *hit_count = (*hit_count == -1 ? 0 : *hit_count) + hits[i];
+    }
+}
+
+static GjsCoverageBranch *
+find_or_add_branch(GArray       *branches,
+                   unsigned int  point)
+{
+    for (unsigned i = 0; i < branches->len; ++i) {
+        GjsCoverageBranch *branch = &(g_array_index(branches, GjsCoverageBranch, i));
+        if (branch->point == point)
+            return branch;
+    }
+
+    GjsCoverageBranch branch;
+    init_covered_branch(&branch, point, false,
+                        g_array_new(true, true, sizeof(GjsCoverageBranchExit)));
+    g_array_append_val(branches, branch);
+    return &(g_array_index(branches, GjsCoverageBranch, branches->len - 1));
+}
+
+static void
+merge_branches(GArray   *branches,
+               GVariant *branches_value)
+{
+    GVariantIter iter;
+    guint32 point;
+    gboolean hit;
+    GVariantIter *exits_iter;
+
+    g_variant_iter_init(&iter, branches_value);
+    while (g_variant_iter_loop(&iter, "(uba(uu))", &point, &hit, &exits_iter)) {
+        GjsCoverageBranch *branch = find_or_add_branch(branches, point);
+        branch->hit = branch->hit || hit;
+
+        guint32 line, hit_count;
+        for (unsigned i = 0; g_variant_iter_next(exits_iter, "(uu)", &line, &hit_count); ++i) {
+            if (i == branch->exits->len) {
+                GjsCoverageBranchExit exit = { line, 0 };
+                g_array_append_val(branch->exits, exit);
+            }
+
+            g_array_index(branch->exits, GjsCoverageBranchExit, i).hit_count += hit_count;
+        }
+    }
+}
+
+static void
+merge_functions(GArray   *functions,
+                GVariant *functions_value)
+{
+    GVariantIter iter;
+    const char *key;
+    guint32 line, hit_count;
+
+    g_variant_iter_init(&iter, functions_value);
+    while (g_variant_iter_next(&iter, "(&suu)", &key, &line, &hit_count)) {
+        unsigned i;
+        for (i = 0; i < functions->len; ++i) {
+            GjsCoverageFunction *function = &(g_array_index(functions, GjsCoverageFunction, i));
+            if (function->line_number == line && g_strcmp0(function->key, key) == 0) {
+                function->hit_count += hit_count;
+                break;
+            }
+        }
+
+        if (i == functions->len) {
+            GjsCoverageFunction function;
+            init_covered_function(&function, g_strdup(key), line, hit_count);
+            g_array_append_val(functions, function);
+        }
+    }
+}
+
+static void
+merge_file_value(GHashTable *merged_files,
+                 GVariant   *file_value)
+{
+    const char *checksum, *filename;
+    GVariant *lines, *branches, *functions;
+
+    g_variant_get(file_value, "(&s&s@ai@a(uba(uu))@a(suu))",
+                  &checksum, &filename, &lines, &branches, &functions);
+
+    char *key = g_strconcat(checksum, ":", filename, NULL);
+    GjsCoverageMergedFile *merged =
+        (GjsCoverageMergedFile *) g_hash_table_lookup(merged_files, key);
+    if (!merged) {
+        merged = merged_file_new(checksum, filename);
+        g_hash_table_insert(merged_files, key, merged);
+    } else {
+        g_free(key);
+    }
+
+    gsize n_hits;
+    auto hits = static_cast<const int32_t *>(g_variant_get_fixed_array(lines, &n_hits,
+                                                                       sizeof(int32_t)));
+    merge_line_hits(merged->statistics.lines, hits, n_hits);
+    merge_branches(merged->statistics.branches, branches);
+    merge_functions(merged->statistics.functions, functions);
+
+    g_variant_unref(lines);
+    g_variant_unref(branches);
+    g_variant_unref(functions);
+}
+
+static bool
+merge_record_file(GHashTable *merged_files,
+                  GFile      *record_file,
+                  GError    **error)
+{
+    char *path = g_file_get_path(record_file);
+    if (!path) {
+        char *uri = g_file_get_uri(record_file);
+        g_set_error(error, GJS_ERROR, GJS_ERROR_FAILED,
+                    "Coverage record %s is not a local file", uri);
+        g_free(uri);
+        return false;
+    }
+
+    GMappedFile *mapped = g_mapped_file_new(path, false, error);
+    if (!mapped) {
+        g_free(path);
+        return false;
+    }
+
+    GBytes *bytes = g_mapped_file_get_bytes(mapped);
+    g_mapped_file_unref(mapped);
+
+    GVariant *record = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(COVERAGE_RECORD_DATA_TYPE),
+                                                                   bytes, false));
+    g_bytes_unref(bytes);
+
+    guint32 version;
+    GVariant *files;
+    g_variant_get(record, "(u@a" COVERAGE_RECORD_FILE_DATA_TYPE ")", &version, &files);
+
+    bool retval = version == COVERAGE_RECORD_VERSION;
+    if (retval) {
+        GVariantIter iter;
+        GVariant *file_value;
+
+        g_variant_iter_init(&iter, files);
+        while ((file_value = g_variant_iter_next_value(&iter))) {
+            merge_file_value(merged_files, file_value);
+            g_variant_unref(file_value);
+        }
+    } else {
+        g_set_error(error, GJS_ERROR, GJS_ERROR_FAILED,
+                    "Coverage record %s has unsupported version %u",
+                    path, version);
+    }
+
+    g_variant_unref(files);
+    g_variant_unref(record);
+    g_free(path);
+    return retval;
+}
+
+typedef struct _GjsCoverageMergeShard {
+    GFile      **records;
+    unsigned     n_records;
+    unsigned     first;
+    unsigned     stride;
+    GHashTable  *merged_files;
+    GError      *error;
+} GjsCoverageMergeShard;
+
+static gpointer
+merge_records_shard(gpointer data)
+{
+    GjsCoverageMergeShard *shard = (GjsCoverageMergeShard *) data;
+
+    for (unsigned i = shard->first; i < shard->n_records; i += shard->stride) {
+        if (!merge_record_file(shard->merged_files, shard->records[i],
+                               &shard->error))
+            break;
+    }
+
+    return NULL;
+}
+
+static int
+compare_merged_file_keys(const void *a,
+                         const void *b)
+{
+    return strcmp(*(const char **) a, *(const char **) b);
+}
+
+/**
+ * gjs_coverage_merge_records:
+ * @output_dir: A directory to write coverage.lcov and the covered source
+ * files to
+ * @records: (array length=n_records): Coverage records written by
+ * gjs_coverage_write_record()
+ * @n_records: Length of @records
+ * @error: Return location for a #GError, or %NULL
+ *
+ * Reads all the coverage records, sums their statistics and writes the
+ * result in lcov format to a new coverage.lcov in @output_dir. The records
+ * are read in parallel, using one thread per processor.
+ *
+ * Statistics recorded for a different revision of a source file than the
+ * one currently on disk are skipped with a warning.
+ *
+ * Returns: %true on success, %false if a record could not be read.
+ */
+bool
+gjs_coverage_merge_records(GFile     *output_dir,
+                           GFile    **records,
+                           unsigned   n_records,
+                           GError   **error)
+{
+    unsigned n_shards = CLAMP(g_get_num_processors(), 1u, MAX(n_records, 1u));
+    GjsCoverageMergeShard *shards = g_new0(GjsCoverageMergeShard, n_shards);
+    GThread **threads = g_new0(GThread *, n_shards);
+
+    for (unsigned i = 0; i < n_shards; ++i) {
+        shards[i].records = records;
+        shards[i].n_records = n_records;
+        shards[i].first = i;
+        shards[i].stride = n_shards;
+        shards[i].merged_files = merged_files_new();
+        if (i > 0)
+            threads[i] = g_thread_new("coverage-merge", merge_records_shard,
+                                      &shards[i]);
+    }
+
+    /* The first shard runs on this thread */
+    merge_records_shard(&shards[0]);
+    for (unsigned i = 1; i < n_shards; ++i)
+        g_thread_join(threads[i]);
+    g_free(threads);
+
+    bool retval = true;
+    GHashTable *merged_files = shards[0].merged_files;
+
+    for (unsigned i = 0; i < n_shards; ++i) {
+        if (shards[i].error) {
+            if (retval)
+                g_propagate_error(error, shards[i].error);
+            else
+                g_error_free(shards[i].error);
+            retval = false;
+        }
+
+        if (i == 0)
+            continue;
+
+        /* Fold the other shards into the first one, going through the same
+         * serialized form as the records themselves */
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, shards[i].merged_files);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            GjsCoverageMergedFile *merged = (GjsCoverageMergedFile *) value;
+            GVariant *file_value =
+                g_variant_ref_sink(file_statistics_to_variant(&merged->statistics,
+                                                              merged->checksum));
+            merge_file_value(merged_files, file_value);
+            g_variant_unref(file_value);
+        }
+        g_hash_table_unref(shards[i].merged_files);
+    }
+
+    g_free(shards);
+
+    if (!retval || !ensure_output_directory(output_dir)) {
+        g_hash_table_unref(merged_files);
+        if (retval)
+            g_set_error(error, GJS_ERROR, GJS_ERROR_FAILED,
+                        "Could not create coverage output directory");
+        return false;
+    }
+
+    GFile *output_file = g_file_get_child(output_dir, "coverage.lcov");
+    GOutputStream *ostream =
+        G_OUTPUT_STREAM(g_file_replace(output_file, NULL, false,
+                                       G_FILE_CREATE_NONE, NULL, error));
+    g_object_unref(output_file);
+    if (!ostream) {
+        g_hash_table_unref(merged_files);
+        return false;
+    }
+
+    /* Sort so that the output does not depend on the order of the records */
+    guint n_keys;
+    auto keys = (const char **) g_hash_table_get_keys_as_array(merged_files, &n_keys);
+    qsort(keys, n_keys, sizeof(const char *), compare_merged_file_keys);
+
+    for (guint i = 0; i < n_keys; ++i) {
+        GjsCoverageMergedFile *merged =
+            (GjsCoverageMergedFile *) g_hash_table_lookup(merged_files, keys[i]);
+
+        GFile *source = g_file_new_for_commandline_arg(merged->statistics.filename);
+        char *checksum = gjs_get_file_checksum(source);
+        g_object_unref(source);
+
+        if (g_strcmp0(checksum, merged->checksum) != 0)
+            g_warning("Skipping coverage statistics for %s recorded for a "
+                      "different revision of the file",
+                      merged->statistics.filename);
+        else
+            print_statistics_for_file(&merged->statistics, output_dir, ostream);
+
+        g_free(checksum);
+    }
+
+    g_free(keys);
+    g_hash_table_unref(merged_files);
+
+    retval = g_output_stream_close(ostream, NULL, error);
+    g_object_unref(ostream);
+    return retval;
+}
+
 static void
 gjs_coverage_init(GjsCoverage *self)
 {
@@ -1276,10 +1829,10 @@ static JSClass coverage_global_class = {
 };
 
 static bool
-gjs_context_eval_file_in_compartment(GjsContext      *context,
-                                     const char      *filename,
-                                     JS::HandleObject compartment_object,
-                                     GError         **error)
+eval_file_in_compartment(JSContext       *js_context,
+                         const char      *filename,
+                         JS::HandleObject compartment_object,
+                         GError         **error)
 {
     char  *script = NULL;
     gsize script_len = 0;
@@ -1302,8 +1855,6 @@ gjs_context_eval_file_in_compartment(GjsContext      *context,
     const char *stripped_script = gjs_strip_unix_shebang(script, &script_len,
                                                          &start_line_number);
 
-    JSContext *js_context = (JSContext *) gjs_context_get_native_context(context);
-
     JSAutoCompartment compartment(js_context, compartment_object);
 
     JS::CompileOptions options(js_context);
@@ -1509,6 +2060,210 @@ coverage_statistics_tracer(JSTracer *trc, void *data)
     JS_CallObjectTracer(trc, &priv->coverage_statistics, "coverage_statistics");
 }
 
+static const char *coverage_script = "resource:///org/cinnamon/cjs/modules/coverage.js";
+
+static void
+collect_files_for_prefix(GPtrArray *filenames,
+                         GFile     *file)
+{
+    GFileType type = g_file_query_file_type(file, G_FILE_QUERY_INFO_NONE, NULL);
+
+    if (type == G_FILE_TYPE_REGULAR) {
+        g_ptr_array_add(filenames, get_file_identifier(file));
+        return;
+    }
+
+    if (type != G_FILE_TYPE_DIRECTORY)
+        return;
+
+    GFileEnumerator *enumerator =
+        g_file_enumerate_children(file,
+                                  G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                  G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if (!enumerator)
+        return;
+
+    GFileInfo *info;
+    while ((info = g_file_enumerator_next_file(enumerator, NULL, NULL))) {
+        const char *name = g_file_info_get_name(info);
+
+        if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY ||
+            g_str_has_suffix(name, ".js")) {
+            GFile *child = g_file_get_child(file, name);
+            collect_files_for_prefix(filenames, child);
+            g_object_unref(child);
+        }
+
+        g_object_unref(info);
+    }
+
+    g_object_unref(enumerator);
+}
+
+typedef struct _GjsCoverageAnalysisJob {
+    char *filename;
+    char *analysis;
+} GjsCoverageAnalysisJob;
+
+typedef struct _GjsCoverageAnalysis {
+    GjsCoverageAnalysisJob *jobs;
+    unsigned                n_jobs;
+    volatile int            next_job;
+} GjsCoverageAnalysis;
+
+/* Each worker has its own runtime and a bare global with just enough of
+ * coverage.js to run analyzeFile(). Jobs are taken from a shared counter,
+ * so a few large files don't hold up the others. */
+static gpointer
+analyze_files_worker(gpointer data)
+{
+    GjsCoverageAnalysis *analysis = (GjsCoverageAnalysis *) data;
+    JSRuntime *runtime = gjs_runtime_ref();
+    JSContext *context = JS_NewContext(runtime, 8192 /* stack chunk size */);
+
+    if (!context) {
+        gjs_runtime_unref();
+        return NULL;
+    }
+
+    {
+        JSAutoRequest ar(context);
+        JS::CompartmentOptions options;
+        options.setVersion(JSVERSION_LATEST);
+        JS::RootedObject global(context,
+            JS_NewGlobalObject(context, &coverage_global_class, NULL,
+                               JS::FireOnNewGlobalHook, options));
+        GError *error = NULL;
+
+        if (!global)
+            goto out;
+
+        {
+            JSAutoCompartment compartment(context, global);
+
+            if (!JS_InitStandardClasses(context, global) ||
+                !JS_InitReflect(context, global) ||
+                !JS_DefineFunctions(context, global, &coverage_funcs[0]))
+                goto out;
+
+            if (!eval_file_in_compartment(context, coverage_script, global, &error)) {
+                g_warning("Failed to eval coverage script: %s", error->message);
+                g_clear_error(&error);
+                goto out;
+            }
+
+            JS::RootedValue rval(context);
+            int i;
+            while ((i = g_atomic_int_add(&analysis->next_job, 1)) < (int) analysis->n_jobs) {
+                GjsCoverageAnalysisJob *job = &analysis->jobs[i];
+                JS::AutoValueArray<1> args(context);
+
+                /* A file that fails to parse is left for the main thread,
+                 * which will report the error if it ever runs */
+                if (!gjs_string_from_utf8(context, job->filename, -1, args[0]) ||
+                    !JS_CallFunctionName(context, global, "analyzeFile", args, &rval) ||
+                    !gjs_string_to_utf8(context, rval, &job->analysis))
+                    JS_ClearPendingException(context);
+            }
+        }
+    }
+
+ out:
+    JS_DestroyContext(context);
+    gjs_runtime_unref();
+    return NULL;
+}
+
+/* Computes the cacheable statistics for every file under the coverage
+ * prefixes that has no fresh cache entry, in parallel, before any code runs.
+ * Otherwise each file would be parsed on the main thread the first time it
+ * is entered, which skews the timing of the code under test. */
+static void
+analyze_prefixes(GjsCoverage     *coverage,
+                 JSContext       *context,
+                 JS::HandleObject coverage_statistics)
+{
+    GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
+
+    if (!priv->prefixes)
+        return;
+
+    GPtrArray *filenames = g_ptr_array_new_with_free_func(g_free);
+    for (char **iter = priv->prefixes; *iter; ++iter) {
+        GFile *prefix = g_file_new_for_commandline_arg(*iter);
+        collect_files_for_prefix(filenames, prefix);
+        g_object_unref(prefix);
+    }
+    g_ptr_array_add(filenames, NULL);
+
+    JS::AutoValueArray<1> args(context);
+    JS::RootedValue rval(context);
+    JSObject *filenames_array = gjs_build_string_array(context, -1,
+                                                       (char **) filenames->pdata);
+    g_ptr_array_unref(filenames);
+    if (!filenames_array) {
+        gjs_log_exception(context);
+        return;
+    }
+    args[0].setObject(*filenames_array);
+
+    uint32_t n_jobs;
+    if (!JS_CallFunctionName(context, coverage_statistics, "staleFiles", args,
+                             &rval) ||
+        !rval.isObject()) {
+        gjs_log_exception(context);
+        return;
+    }
+
+    JS::RootedObject stale_files(context, &rval.toObject());
+    if (!JS_GetArrayLength(context, stale_files, &n_jobs) || n_jobs == 0)
+        return;
+
+    GjsCoverageAnalysis analysis;
+    analysis.jobs = g_new0(GjsCoverageAnalysisJob, n_jobs);
+    analysis.n_jobs = n_jobs;
+    analysis.next_job = 0;
+
+    JS::RootedValue element(context);
+    for (uint32_t i = 0; i < n_jobs; ++i) {
+        if (!JS_GetElement(context, stale_files, i, &element) ||
+            !gjs_string_to_utf8(context, element, &analysis.jobs[i].filename)) {
+            gjs_log_exception(context);
+            for (uint32_t j = 0; j < i; ++j)
+                g_free(analysis.jobs[j].filename);
+            g_free(analysis.jobs);
+            return;
+        }
+    }
+
+    unsigned n_workers = MIN(g_get_num_processors(), n_jobs);
+    GThread **workers = g_new0(GThread *, n_workers);
+    for (unsigned i = 0; i < n_workers; ++i)
+        workers[i] = g_thread_new("coverage-analysis", analyze_files_worker,
+                                  &analysis);
+    for (unsigned i = 0; i < n_workers; ++i)
+        g_thread_join(workers[i]);
+    g_free(workers);
+
+    for (unsigned i = 0; i < n_jobs; ++i) {
+        GjsCoverageAnalysisJob *job = &analysis.jobs[i];
+        JS::AutoValueArray<2> add_args(context);
+
+        if (job->analysis &&
+            (!gjs_string_from_utf8(context, job->filename, -1, add_args[0]) ||
+             !gjs_string_from_utf8(context, job->analysis, -1, add_args[1]) ||
+             !JS_CallFunctionName(context, coverage_statistics, "addAnalysis",
+                                  add_args, &rval)))
+            gjs_log_exception(context);
+
+        g_free(job->filename);
+        g_free(job->analysis);
+    }
+
+    g_free(analysis.jobs);
+}
+
 /* This function is mainly used in the tests in order to fiddle with
  * the internals of the coverage statisics collector on the coverage
  * compartment side */
@@ -1586,7 +2341,6 @@ gjs_wrap_root_importer_in_compartment(JSContext *context,
 static bool
 bootstrap_coverage(GjsCoverage *coverage)
 {
-    static const char  *coverage_script = "resource:///org/cinnamon/cjs/modules/coverage.js";
     GjsCoveragePrivate *priv = (GjsCoveragePrivate *) gjs_coverage_get_instance_private(coverage);
     GBytes             *cache_bytes = NULL;
     GError             *error = NULL;
@@ -1650,10 +2404,8 @@ bootstrap_coverage(GjsCoverage *coverage)
         if (!JS_DefineFunctions(context, debugger_compartment, &coverage_funcs[0]))
             g_error("Failed to init coverage");
 
-        if (!gjs_context_eval_file_in_compartment(priv->context,
-                                                  coverage_script,
-                                                  debugger_compartment,
-                                                  &error))
+        if (!eval_file_in_compartment(context, coverage_script,
+                                      debugger_compartment, &error))
             g_error("Failed to eval coverage script: %s\n", error->message);
 
         JS::RootedObject coverage_statistics_constructor(context);
@@ -1684,11 +2436,15 @@ bootstrap_coverage(GjsCoverage *coverage)
         /* Now create the array to pass the desired prefixes over */
         JSObject *prefixes = gjs_build_string_array(context, -1, priv->prefixes);
 
-        JS::AutoValueArray<3> coverage_statistics_constructor_args(context);
+        /* GJS_COVERAGE_FIRST_HIT_ONLY drops each line breakpoint after it
+         * fires once, trading exact hit counts for near-native speed */
+        JS::AutoValueArray<4> coverage_statistics_constructor_args(context);
         coverage_statistics_constructor_args[0].setObject(*prefixes);
         coverage_statistics_constructor_args[1].set(cache_value);
         coverage_statistics_constructor_args[2]
             .setBoolean(g_getenv("GJS_DEBUG_COVERAGE_EXECUTED_LINES"));
+        coverage_statistics_constructor_args[3]
+            .setBoolean(g_getenv("GJS_COVERAGE_FIRST_HIT_ONLY"));
 
         JSObject *coverage_statistics = JS_New(context,
                                                coverage_statistics_constructor,
@@ -1705,6 +2461,9 @@ bootstrap_coverage(GjsCoverage *coverage)
                                  coverage);
 
         priv->coverage_statistics = coverage_statistics;
+
+        JS::RootedObject rooted_coverage_statistics(context, coverage_statistics);
+        analyze_prefixes(coverage, context, rooted_coverage_statistics);
     }
 
     return true;
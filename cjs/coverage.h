@@ -34,6 +34,15 @@ G_DECLARE_FINAL_TYPE(GjsCoverage, gjs_coverage, GJS, COVERAGE, GObject);
 GJS_EXPORT
 void gjs_coverage_write_statistics(GjsCoverage *self);
 
+GJS_EXPORT
+void gjs_coverage_write_record(GjsCoverage *self);
+
+GJS_EXPORT
+bool gjs_coverage_merge_records(GFile     *output_dir,
+                                GFile    **records,
+                                unsigned   n_records,
+                                GError   **error);
+
 GJS_EXPORT
 GjsCoverage * gjs_coverage_new(const char * const *coverage_prefixes,
                                GjsContext         *coverage_context,
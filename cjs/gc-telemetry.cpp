@@ -0,0 +1,236 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "gc-telemetry.h"
+#include <util/misc.h>
+
+/* Enough history to cover a few minutes of a busy desktop session, while
+ * keeping the histograms cheap to recompute when they are read */
+#define N_RECENT_SAMPLES 256
+
+/* Most recent samples in a ring, in ms */
+struct RecentSamples {
+    float samples[N_RECENT_SAMPLES];
+    unsigned n_samples;
+    unsigned next;
+
+    void add(double ms) {
+        samples[next] = ms;
+        next = (next + 1) % N_RECENT_SAMPLES;
+        if (n_samples < N_RECENT_SAMPLES)
+            n_samples++;
+    }
+
+    void summarize(GjsGCHistogram *histogram) const;
+};
+
+struct _GjsGCTelemetry {
+    unsigned n_gcs;
+    unsigned n_slices;
+    bool record_reason;
+    char last_reason[32];
+    uint64_t heap_bytes_before;
+    uint64_t heap_bytes_after;
+
+    int64_t slice_start_us;
+    double cycle_slice_ms;  /* total of the current GC's slices so far */
+
+    RecentSamples pauses;
+    RecentSamples slices;
+    RecentSamples toggle_drains;
+
+    unsigned toggles_drained;
+    unsigned wrappers_disassociated;
+    uint64_t total_wrappers_disassociated;
+};
+
+double
+gjs_gc_histogram_bucket_limit_ms(unsigned bucket)
+{
+    g_return_val_if_fail(bucket < GJS_GC_HISTOGRAM_N_BUCKETS, 0.);
+
+    if (bucket == GJS_GC_HISTOGRAM_N_BUCKETS - 1)
+        return INFINITY;
+    return (1 << bucket) / 4.;
+}
+
+void
+RecentSamples::summarize(GjsGCHistogram *histogram) const
+{
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->n_samples = n_samples;
+    if (n_samples == 0)
+        return;
+
+    double total = 0.;
+    histogram->min_ms = G_MAXDOUBLE;
+    for (unsigned ix = 0; ix < n_samples; ix++) {
+        double ms = samples[ix];
+        total += ms;
+        histogram->min_ms = MIN(histogram->min_ms, ms);
+        histogram->max_ms = MAX(histogram->max_ms, ms);
+
+        unsigned bucket = 0;
+        while (bucket < GJS_GC_HISTOGRAM_N_BUCKETS - 1 &&
+               ms >= gjs_gc_histogram_bucket_limit_ms(bucket))
+            bucket++;
+        histogram->buckets[bucket]++;
+    }
+    histogram->mean_ms = total / n_samples;
+}
+
+GjsGCTelemetry *
+_gjs_gc_telemetry_new(void)
+{
+    GjsGCTelemetry *self = g_new0(GjsGCTelemetry, 1);
+    self->record_reason = gjs_environment_variable_is_set("GJS_GC_REASON");
+    if (self->record_reason)
+        g_strlcpy(self->last_reason, "none", sizeof(self->last_reason));
+    return self;
+}
+
+void
+_gjs_gc_telemetry_free(GjsGCTelemetry *self)
+{
+    g_free(self);
+}
+
+static uint64_t
+heap_bytes(JSRuntime *rt)
+{
+    return JS_GetGCParameter(rt, JSGC_BYTES);
+}
+
+/* SpiderMonkey doesn't pass the reason for the GC to the callback in this
+ * version, but it is part of the summary message, as "Reason: API, ".
+ * Formatting that message costs far more than the rest of the bookkeeping
+ * put together, which is why this only happens with GJS_GC_REASON set. */
+static void
+copy_reason(GjsGCTelemetry           *self,
+            JSRuntime                *rt,
+            const JS::GCDescription&  desc)
+{
+    static const char prefix[] = "Reason: ";
+    char16_t *message = desc.formatMessage(rt);
+    if (!message)
+        return;
+
+    for (char16_t *iter = message; *iter; iter++) {
+        unsigned ix;
+        for (ix = 0; prefix[ix] && iter[ix] == char16_t(prefix[ix]); ix++)
+            ;
+        if (prefix[ix])
+            continue;
+
+        iter += ix;
+        for (ix = 0; ix < sizeof(self->last_reason) - 1 && iter[ix] &&
+             iter[ix] < 0x80 && (g_ascii_isalnum(iter[ix]) || iter[ix] == '_');
+             ix++)
+            self->last_reason[ix] = char(iter[ix]);
+        self->last_reason[ix] = '\0';
+        break;
+    }
+
+    js_free(message);
+}
+
+/* The first slice of a GC is reported as GC_CYCLE_BEGIN instead of
+ * GC_SLICE_BEGIN, and the last as GC_CYCLE_END instead of GC_SLICE_END */
+void
+_gjs_gc_telemetry_gc_progress(GjsGCTelemetry           *self,
+                              JSRuntime                *rt,
+                              JS::GCProgress            progress,
+                              const JS::GCDescription&  desc)
+{
+    switch (progress) {
+    case JS::GC_CYCLE_BEGIN:
+        self->heap_bytes_before = heap_bytes(rt);
+        self->cycle_slice_ms = 0.;
+        self->wrappers_disassociated = 0;
+        /* fall through */
+    case JS::GC_SLICE_BEGIN:
+        self->slice_start_us = g_get_monotonic_time();
+        break;
+
+    case JS::GC_SLICE_END:
+    case JS::GC_CYCLE_END: {
+        double ms = (g_get_monotonic_time() - self->slice_start_us) / 1000.;
+        self->n_slices++;
+        self->slices.add(ms);
+        self->cycle_slice_ms += ms;
+
+        if (progress == JS::GC_CYCLE_END) {
+            self->n_gcs++;
+            self->pauses.add(self->cycle_slice_ms);
+            self->heap_bytes_after = heap_bytes(rt);
+            if (self->record_reason)
+                copy_reason(self, rt, desc);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void
+_gjs_gc_telemetry_toggles_drained(GjsGCTelemetry *self,
+                                  unsigned        n_toggles,
+                                  int64_t         elapsed_us)
+{
+    self->toggles_drained = n_toggles;
+    self->toggle_drains.add(elapsed_us / 1000.);
+}
+
+void
+_gjs_gc_telemetry_wrappers_disassociated(GjsGCTelemetry *self,
+                                         unsigned        n_wrappers)
+{
+    self->wrappers_disassociated += n_wrappers;
+    self->total_wrappers_disassociated += n_wrappers;
+}
+
+/* Fills in everything but toggle_queue_high_water, which belongs to the
+ * toggle queue */
+void
+_gjs_gc_telemetry_get_stats(GjsGCTelemetry *self,
+                            GjsGCStats     *stats)
+{
+    stats->n_gcs = self->n_gcs;
+    stats->n_slices = self->n_slices;
+    g_strlcpy(stats->last_reason, self->last_reason, sizeof(stats->last_reason));
+    stats->heap_bytes_before = self->heap_bytes_before;
+    stats->heap_bytes_after = self->heap_bytes_after;
+    self->pauses.summarize(&stats->pauses);
+    self->slices.summarize(&stats->slices);
+    self->toggle_drains.summarize(&stats->toggle_drains);
+    stats->toggles_drained = self->toggles_drained;
+    stats->wrappers_disassociated = self->wrappers_disassociated;
+    stats->total_wrappers_disassociated = self->total_wrappers_disassociated;
+}
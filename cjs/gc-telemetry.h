@@ -0,0 +1,58 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_GC_TELEMETRY_H
+#define GJS_GC_TELEMETRY_H
+
+#include <stdint.h>
+
+#include "context.h"
+#include "jsapi-wrapper.h"
+
+G_BEGIN_DECLS
+
+/* Per-runtime record of GC activity, kept cheap enough to always be on: a
+ * few timestamps per slice and a fixed-size ring of recent samples. The
+ * runtime owns one; see gjs_runtime_get_gc_telemetry(). */
+typedef struct _GjsGCTelemetry GjsGCTelemetry;
+
+GjsGCTelemetry *_gjs_gc_telemetry_new(void);
+void _gjs_gc_telemetry_free(GjsGCTelemetry *self);
+
+/* Called from the GC slice callback */
+void _gjs_gc_telemetry_gc_progress(GjsGCTelemetry           *self,
+                                   JSRuntime                *rt,
+                                   JS::GCProgress            progress,
+                                   const JS::GCDescription&  desc);
+
+void _gjs_gc_telemetry_toggles_drained(GjsGCTelemetry *self,
+                                       unsigned        n_toggles,
+                                       int64_t         elapsed_us);
+
+void _gjs_gc_telemetry_wrappers_disassociated(GjsGCTelemetry *self,
+                                              unsigned        n_wrappers);
+
+void _gjs_gc_telemetry_get_stats(GjsGCTelemetry *self,
+                                 GjsGCStats     *stats);
+
+G_END_DECLS
+
+#endif /* GJS_GC_TELEMETRY_H */
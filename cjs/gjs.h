@@ -27,6 +27,7 @@
 #include <cjs/macros.h>
 #include <cjs/context.h>
 #include <cjs/coverage.h>
+#include <cjs/profiler.h>
 #include <util/error.h>
 
 #endif /* __GJS_GJS_H__ */
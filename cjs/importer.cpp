@@ -31,6 +31,7 @@
 #include "jsapi-wrapper.h"
 #include "mem.h"
 #include "native.h"
+#include "gi/gjs_gi_trace.h"
 
 #include <gio/gio.h>
 
@@ -358,11 +359,10 @@ import_file(JSContext       *context,
 
     full_path = g_file_get_parse_name (file);
 
-    if (!gjs_eval_with_scope(context, module_obj, script, script_len,
-                             full_path, &ignored))
-        goto out;
-
-    ret = true;
+    TRACE(GJS_IMPORT_START((char *) name, full_path));
+    ret = gjs_eval_with_scope(context, module_obj, script, script_len,
+                              full_path, &ignored);
+    TRACE(GJS_IMPORT_END((char *) name, full_path, ret));
 
  out:
     g_free(script);
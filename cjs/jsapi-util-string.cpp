@@ -64,6 +64,55 @@ gjs_string_to_utf8 (JSContext      *context,
     return true;
 }
 
+/**
+ * gjs_string_to_utf8_in_buffer:
+ * @cx: the current #JSContext
+ * @value: a JS::Value holding a string
+ * @buffer: caller-owned storage to encode into
+ * @buffer_size: size of @buffer in bytes
+ * @len_p: (out) (optional): place to store the encoded length, not including
+ *   the terminating NUL byte
+ *
+ * Like gjs_string_to_utf8(), but encodes into caller-provided storage instead
+ * of allocating. This is meant for short-lived conversions such as in
+ * arguments to C functions, where the malloc/free pair would otherwise cost
+ * more than the conversion itself.
+ *
+ * Returns: %true if @value was encoded into @buffer, %false if it does not fit
+ * (in which case the caller should fall back to gjs_string_to_utf8()). No
+ * exception is ever left pending.
+ */
+bool
+gjs_string_to_utf8_in_buffer(JSContext      *cx,
+                             JS::HandleValue value,
+                             char           *buffer,
+                             size_t          buffer_size,
+                             size_t         *len_p)
+{
+    if (!value.isString() || buffer_size == 0)
+        return false;
+
+    JSAutoRequest ar(cx);
+
+    JSFlatString *flat = JS_FlattenString(cx, value.toString());
+    if (flat == NULL) {
+        JS_ClearPendingException(cx);
+        return false;
+    }
+
+    size_t len = JS::GetDeflatedUTF8StringLength(flat);
+    if (len >= buffer_size)
+        return false;
+
+    JS::DeflateStringToUTF8Buffer(flat,
+                                  mozilla::RangedPtr<char>(buffer, len));
+    buffer[len] = '\0';
+
+    if (len_p)
+        *len_p = len;
+    return true;
+}
+
 bool
 gjs_string_from_utf8(JSContext             *context,
                      const char            *utf8_string,
@@ -185,6 +185,11 @@ void        gjs_error_reporter               (JSContext       *context,
 bool        gjs_string_to_utf8               (JSContext       *context,
                                               const JS::Value  string_val,
                                               char           **utf8_string_p);
+bool gjs_string_to_utf8_in_buffer(JSContext      *cx,
+                                  JS::HandleValue value,
+                                  char           *buffer,
+                                  size_t          buffer_size,
+                                  size_t         *len_p);
 bool gjs_string_from_utf8(JSContext             *context,
                           const char            *utf8_string,
                           ssize_t                n_bytes,
@@ -250,12 +255,12 @@ typedef enum {
   GJS_STRING_SEARCH_PATH,
   GJS_STRING_KEEP_ALIVE_MARKER,
   GJS_STRING_PRIVATE_NS_MARKER,
+  GJS_STRING_DBUS_OBJECT,
   GJS_STRING_GI_MODULE,
   GJS_STRING_GI_VERSIONS,
   GJS_STRING_GI_OVERRIDES,
   GJS_STRING_GOBJECT_INIT,
   GJS_STRING_INSTANCE_INIT,
-  GJS_STRING_NEW_INTERNAL,
   GJS_STRING_NEW,
   GJS_STRING_MESSAGE,
   GJS_STRING_CODE,
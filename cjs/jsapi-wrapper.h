@@ -37,6 +37,7 @@
 #endif
 #include <mozilla/Maybe.h>
 #include <jsapi.h>
+#include <jsfriendapi.h>  /* For typed arrays */
 #include <js/Conversions.h>
 #include <js/Proxy.h>  /* For jsapi-constructor-proxy */
 
@@ -23,6 +23,8 @@
 
 #include <config.h>
 
+#include <string.h>
+
 #include "mem.h"
 #include <util/log.h>
 
@@ -106,7 +108,158 @@ gjs_memory_report(const char *where,
                   counters[i]->value);
     }
 
+    unsigned n_types;
+    GjsTypeCounter **types = gjs_type_counters_list(&n_types);
+    for (unsigned ix = 0; ix < n_types; ix++) {
+        if (types[ix]->live == 0)
+            continue;
+        gjs_debug(GJS_DEBUG_MEMORY, "    %12s %s = %d",
+                  gjs_type_counter_kind_name(types[ix]->kind),
+                  types[ix]->name, types[ix]->live);
+    }
+    g_free(types);
+
     if (die_if_leaks && GJS_GET_COUNTER(everything) > 0) {
         g_error("%s: JavaScript objects were leaked.", where);
     }
 }
+
+/* Type counters are looked up rarely (once per class, or once per signal
+ * connection) and incremented often, so the tables are behind a lock and
+ * the counts themselves are atomic. */
+static GMutex type_counters_lock;
+static GHashTable *type_counters[GJS_TYPE_COUNTER_N_KINDS];
+static GHashTable *signal_counters;  /* signal ID -> GjsTypeCounter */
+
+static const char *type_counter_kind_names[] = {
+    "object",
+    "boxed",
+    "fundamental",
+    "union",
+    "signal",
+};
+
+G_STATIC_ASSERT(G_N_ELEMENTS(type_counter_kind_names) == GJS_TYPE_COUNTER_N_KINDS);
+
+const char *
+gjs_type_counter_kind_name(GjsTypeCounterKind kind)
+{
+    g_return_val_if_fail(kind < GJS_TYPE_COUNTER_N_KINDS, NULL);
+    return type_counter_kind_names[kind];
+}
+
+static GjsTypeCounter *
+type_counter_get_unlocked(GjsTypeCounterKind  kind,
+                          const char         *name)
+{
+    if (!type_counters[kind])
+        type_counters[kind] = g_hash_table_new(g_str_hash, g_str_equal);
+
+    auto counter = static_cast<GjsTypeCounter *>(
+        g_hash_table_lookup(type_counters[kind], name));
+    if (!counter) {
+        counter = g_new0(GjsTypeCounter, 1);
+        counter->kind = kind;
+        counter->name = g_intern_string(name);
+        g_hash_table_insert(type_counters[kind], (char *) counter->name, counter);
+    }
+    return counter;
+}
+
+GjsTypeCounter *
+gjs_type_counter_get(GjsTypeCounterKind  kind,
+                     const char         *name)
+{
+    g_return_val_if_fail(kind < GJS_TYPE_COUNTER_N_KINDS, NULL);
+    g_return_val_if_fail(name, NULL);
+
+    g_mutex_lock(&type_counters_lock);
+    GjsTypeCounter *counter = type_counter_get_unlocked(kind, name);
+    g_mutex_unlock(&type_counters_lock);
+    return counter;
+}
+
+GjsTypeCounter *
+gjs_type_counter_get_for_gtype(GjsTypeCounterKind kind,
+                               GType              gtype)
+{
+    return gjs_type_counter_get(kind, g_type_name(gtype));
+}
+
+GjsTypeCounter *
+gjs_type_counter_get_for_signal(unsigned signal_id)
+{
+    g_mutex_lock(&type_counters_lock);
+
+    if (!signal_counters)
+        signal_counters = g_hash_table_new(NULL, NULL);
+
+    auto counter = static_cast<GjsTypeCounter *>(
+        g_hash_table_lookup(signal_counters, GUINT_TO_POINTER(signal_id)));
+    if (!counter) {
+        GSignalQuery query;
+        g_signal_query(signal_id, &query);
+
+        char *name = g_strdup_printf("%s::%s", g_type_name(query.itype),
+                                     query.signal_name);
+        counter = type_counter_get_unlocked(GJS_TYPE_COUNTER_SIGNAL, name);
+        g_free(name);
+        g_hash_table_insert(signal_counters, GUINT_TO_POINTER(signal_id),
+                            counter);
+    }
+
+    g_mutex_unlock(&type_counters_lock);
+    return counter;
+}
+
+void
+gjs_type_counter_inc(GjsTypeCounter *counter)
+{
+    int live = g_atomic_int_add(&counter->live, 1) + 1;
+    g_atomic_int_inc(&counter->total);
+
+    int peak = g_atomic_int_get(&counter->peak);
+    while (live > peak &&
+           !g_atomic_int_compare_and_exchange(&counter->peak, peak, live))
+        peak = g_atomic_int_get(&counter->peak);
+}
+
+void
+gjs_type_counter_dec(GjsTypeCounter *counter)
+{
+    g_atomic_int_add(&counter->live, -1);
+}
+
+/* Returns a snapshot of all counters, most live instances first; free the
+ * array, but not the counters, with g_free() */
+GjsTypeCounter **
+gjs_type_counters_list(unsigned *n_counters)
+{
+    GPtrArray *list = g_ptr_array_new();
+
+    g_mutex_lock(&type_counters_lock);
+    for (unsigned kind = 0; kind < GJS_TYPE_COUNTER_N_KINDS; kind++) {
+        if (!type_counters[kind])
+            continue;
+
+        GHashTableIter iter;
+        void *counter;
+        g_hash_table_iter_init(&iter, type_counters[kind]);
+        while (g_hash_table_iter_next(&iter, NULL, &counter))
+            g_ptr_array_add(list, counter);
+    }
+    g_mutex_unlock(&type_counters_lock);
+
+    g_ptr_array_sort(list, [](const void *a, const void *b) -> int {
+        auto ca = *static_cast<GjsTypeCounter * const *>(a);
+        auto cb = *static_cast<GjsTypeCounter * const *>(b);
+        if (ca->live != cb->live)
+            return cb->live - ca->live;
+        if (ca->total != cb->total)
+            return cb->total - ca->total;
+        return strcmp(ca->name, cb->name);
+    });
+
+    *n_counters = list->len;
+    return reinterpret_cast<GjsTypeCounter **>(g_ptr_array_free(list, false));
+}
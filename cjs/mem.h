@@ -25,7 +25,7 @@
 #define __GJS_MEM_H__
 
 #include <stdbool.h>
-#include <glib.h>
+#include <glib-object.h>
 #include "cjs/jsapi-util.h"
 
 G_BEGIN_DECLS
@@ -74,6 +74,44 @@ GJS_DECLARE_COUNTER(constructor_proxy)
 void gjs_memory_report(const char *where,
                        bool        die_if_leaks);
 
+/* Per-type counters for wrapper objects, so that leaks and churn can be
+ * pinned on a particular class rather than on "boxed" or "object" as a
+ * whole. Counters are created on demand and live as long as the process.
+ * Callers look up the counter once, e.g. when defining the class, and keep
+ * the pointer. */
+typedef enum {
+    GJS_TYPE_COUNTER_OBJECT,
+    GJS_TYPE_COUNTER_BOXED,
+    GJS_TYPE_COUNTER_FUNDAMENTAL,
+    GJS_TYPE_COUNTER_UNION,
+    GJS_TYPE_COUNTER_SIGNAL,  /* closures connected to a signal */
+    GJS_TYPE_COUNTER_N_KINDS
+} GjsTypeCounterKind;
+
+typedef struct {
+    GjsTypeCounterKind kind;
+    const char *name;
+    volatile int live;
+    volatile int total;
+    volatile int peak;
+} GjsTypeCounter;
+
+GjsTypeCounter *gjs_type_counter_get(GjsTypeCounterKind  kind,
+                                     const char         *name);
+
+GjsTypeCounter *gjs_type_counter_get_for_gtype(GjsTypeCounterKind kind,
+                                               GType              gtype);
+
+GjsTypeCounter *gjs_type_counter_get_for_signal(unsigned signal_id);
+
+const char *gjs_type_counter_kind_name(GjsTypeCounterKind kind);
+
+void gjs_type_counter_inc(GjsTypeCounter *counter);
+
+void gjs_type_counter_dec(GjsTypeCounter *counter);
+
+GjsTypeCounter **gjs_type_counters_list(unsigned *n_counters);
+
 G_END_DECLS
 
 #endif  /* __GJS_MEM_H__ */
@@ -0,0 +1,46 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_PROFILER_PRIVATE_H
+#define GJS_PROFILER_PRIVATE_H
+
+#include "context.h"
+#include "jsapi-wrapper.h"
+#include "profiler.h"
+
+G_BEGIN_DECLS
+
+GjsProfiler *_gjs_profiler_new(GjsContext *context);
+void _gjs_profiler_free(GjsProfiler *self);
+
+/* Returns the profiler sampling @cx's runtime, or NULL if none is running.
+ * Cheap enough to call on every native function call. */
+GjsProfiler *_gjs_profiler_get_sampling(JSContext *cx);
+
+/* Labels a native call in the samples. @label must stay valid until the
+ * matching pop. */
+void _gjs_profiler_push_native_frame(GjsProfiler *self,
+                                     const char  *label);
+void _gjs_profiler_pop_native_frame(GjsProfiler *self);
+
+G_END_DECLS
+
+#endif /* GJS_PROFILER_PRIVATE_H */
@@ -0,0 +1,648 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <atomic>
+#include <errno.h>
+#include <string.h>
+
+#include <gio/gio.h>
+
+#ifdef G_OS_WIN32
+# include <process.h>
+#else
+# include <unistd.h>
+#endif
+
+#ifdef ENABLE_PROFILER
+# include <signal.h>
+# include <sys/syscall.h>
+# include <time.h>
+#endif
+
+#include "jsapi-wrapper.h"
+#include <js/ProfilingStack.h>
+
+#include "context.h"
+#include "profiler-private.h"
+#include "runtime.h"
+
+#include <util/log.h>
+
+/*
+ * The profiler samples the JS stack from a SIGPROF handler, driven by a
+ * timer that only interrupts the thread running the GjsContext.
+ *
+ * SpiderMonkey keeps a "profiling stack" of labels for the JS frames
+ * currently executing, in memory that we provide. Native GI calls push
+ * their own labels onto the same stack (see gjs_invoke_c_function()), so
+ * the samples show which C functions the time is spent in.
+ *
+ * Nothing in the signal handler may allocate or take locks, so it only
+ * copies the labels into a preallocated buffer. The buffer is drained into
+ * a tree of stack frames from the main loop, and whenever the profiler is
+ * stopped; samples that arrive while the buffer is full are dropped.
+ *
+ * When the profiler stops, the samples are written to the output file,
+ * either as collapsed stacks (one "outer;inner count" line per distinct
+ * stack, as consumed by flamegraph.pl) or, if the filename ends in ".json",
+ * in the Chrome trace event format.
+ */
+
+#define GJS_PROFILER_DEFAULT_FREQUENCY 1000  /* Hz */
+#define GJS_PROFILER_MAX_DEPTH 512
+#define GJS_PROFILER_MAX_LABEL 255
+#define GJS_PROFILER_BUFFER_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+    gint64   timestamp;  /* µs since the profiler started */
+    uint16_t n_frames;
+    /* followed by n_frames NUL-terminated labels, outermost first */
+} GjsProfilerSampleHeader;
+
+typedef struct {
+    unsigned  parent;
+    char     *label;
+} GjsProfilerNode;
+
+/* The profiling stack is registered with the runtime, which all contexts on
+ * the thread share, so it belongs to the runtime rather than to any one
+ * profiler. It stays installed until the runtime is destroyed: JS frames that
+ * were entered while it was installed pop their entries off it on exit. */
+typedef struct {
+    JSRuntime *runtime;
+    js::ProfileEntry entries[GJS_PROFILER_MAX_DEPTH];
+    uint32_t depth;
+} GjsProfilerStack;
+
+static const char profiler_stack_key[] = "gjs-profiler-stack";
+
+typedef struct {
+    gint64   timestamp;
+    unsigned node;
+} GjsProfilerSample;
+
+struct _GjsProfiler {
+    GjsContext *gjs_context;
+    JSRuntime *runtime;
+
+    char *filename;
+    unsigned frequency;
+    bool running;
+
+    GjsProfilerStack *stack;
+
+    /* Written by the signal handler, read back by drain_samples() */
+    char *buffer;
+    size_t buffer_used;
+    unsigned n_dropped;
+
+    /* Node 0 is the root; the key of the index is "parent:label" */
+    GArray *nodes;
+    GHashTable *node_index;
+    GArray *samples;
+
+    gint64 start_time;
+    guint drain_source_id;
+
+#ifdef ENABLE_PROFILER
+    timer_t timer;
+    pid_t tid;
+    struct sigaction old_sigprof;
+#endif
+};
+
+/* Only one profiler can own the SIGPROF handler at a time */
+static GjsProfiler *sampling_profiler = NULL;
+
+static void
+free_node(gpointer data)
+{
+    GjsProfilerNode *node = (GjsProfilerNode *) data;
+    g_free(node->label);
+}
+
+static void
+profiler_stack_free(void *data)
+{
+    auto stack = static_cast<GjsProfilerStack *>(data);
+    js::SetRuntimeProfilingStack(stack->runtime, NULL, NULL, 0);
+    g_free(stack);
+}
+
+static GjsProfilerStack *
+profiler_stack_for_runtime(JSRuntime *rt)
+{
+    auto stack = static_cast<GjsProfilerStack *>(
+        gjs_runtime_get_data(rt, profiler_stack_key));
+    if (stack)
+        return stack;
+
+    stack = g_new0(GjsProfilerStack, 1);
+    stack->runtime = rt;
+    js::SetRuntimeProfilingStack(rt, stack->entries, &stack->depth,
+                                 GJS_PROFILER_MAX_DEPTH);
+    gjs_runtime_set_data(rt, profiler_stack_key, stack, profiler_stack_free);
+    return stack;
+}
+
+GjsProfiler *
+_gjs_profiler_new(GjsContext *context)
+{
+    GjsProfiler *self = g_new0(GjsProfiler, 1);
+    JSContext *cx = (JSContext *) gjs_context_get_native_context(context);
+
+    self->gjs_context = context;
+    self->runtime = JS_GetRuntime(cx);
+    self->frequency = GJS_PROFILER_DEFAULT_FREQUENCY;
+
+    self->stack = profiler_stack_for_runtime(self->runtime);
+
+    return self;
+}
+
+void
+_gjs_profiler_free(GjsProfiler *self)
+{
+    if (!self)
+        return;
+
+    if (self->running)
+        gjs_profiler_stop(self);
+
+    g_free(self->filename);
+    g_free(self);
+}
+
+/**
+ * gjs_profiler_set_filename:
+ * @self: A #GjsProfiler
+ * @filename: The file to write the profile to when the profiler stops
+ *
+ * If @filename ends in ".json" the profile is written in the Chrome trace
+ * event format, otherwise as collapsed stacks for flamegraph.pl. The
+ * default is "cjs-PID.collapsed" in the current directory.
+ */
+void
+gjs_profiler_set_filename(GjsProfiler *self,
+                          const char  *filename)
+{
+    g_return_if_fail(self);
+    g_return_if_fail(!self->running);
+
+    g_free(self->filename);
+    self->filename = g_strdup(filename);
+}
+
+/**
+ * gjs_profiler_set_frequency:
+ * @self: A #GjsProfiler
+ * @frequency: Samples per second
+ *
+ * Sets how often the stack is sampled. Takes effect the next time the
+ * profiler is started.
+ */
+void
+gjs_profiler_set_frequency(GjsProfiler *self,
+                           unsigned     frequency)
+{
+    g_return_if_fail(self);
+    g_return_if_fail(frequency > 0 && frequency <= 1000000);
+
+    self->frequency = frequency;
+}
+
+bool
+gjs_profiler_is_running(GjsProfiler *self)
+{
+    g_return_val_if_fail(self, false);
+
+    return self->running;
+}
+
+GjsProfiler *
+_gjs_profiler_get_sampling(JSContext *cx)
+{
+    GjsProfiler *self = sampling_profiler;
+
+    if (G_LIKELY(!self) || self->runtime != JS_GetRuntime(cx))
+        return NULL;
+    return self;
+}
+
+/* Same protocol as SpiderMonkey's own pushes: the depth is bumped even past
+ * the end of the stack, so that pushes and pops stay balanced */
+void
+_gjs_profiler_push_native_frame(GjsProfiler *self,
+                                const char  *label)
+{
+    GjsProfilerStack *stack = self->stack;
+    uint32_t depth = stack->depth;
+
+    if (depth < GJS_PROFILER_MAX_DEPTH) {
+        stack->entries[depth].setLabel(label);
+        stack->entries[depth].setCppFrame(&stack->entries[depth], 0);
+    }
+
+    /* The entry must be complete before the signal handler can see it */
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    stack->depth = depth + 1;
+}
+
+void
+_gjs_profiler_pop_native_frame(GjsProfiler *self)
+{
+    self->stack->depth--;
+}
+
+static unsigned
+intern_node(GjsProfiler *self,
+            unsigned     parent,
+            const char  *label)
+{
+    char *key = g_strdup_printf("%u:%s", parent, label);
+    gpointer index;
+
+    if (g_hash_table_lookup_extended(self->node_index, key, NULL, &index)) {
+        g_free(key);
+        return GPOINTER_TO_UINT(index);
+    }
+
+    GjsProfilerNode node = { parent, g_strdup(label) };
+    g_array_append_val(self->nodes, node);
+
+    unsigned id = self->nodes->len - 1;
+    g_hash_table_insert(self->node_index, key, GUINT_TO_POINTER(id));
+    return id;
+}
+
+#ifdef ENABLE_PROFILER
+
+static void
+gjs_profiler_sigprof(int        signum,
+                     siginfo_t *info,
+                     void      *unused)
+{
+    GjsProfiler *self = sampling_profiler;
+
+    if (!self || !self->running)
+        return;
+
+    uint32_t depth = MIN(self->stack->depth, GJS_PROFILER_MAX_DEPTH);
+
+    /* Nothing is running; the main loop is idle */
+    if (depth == 0)
+        return;
+
+    size_t needed = sizeof(GjsProfilerSampleHeader) +
+        depth * (GJS_PROFILER_MAX_LABEL + 1);
+    if (self->buffer_used + needed > GJS_PROFILER_BUFFER_SIZE) {
+        self->n_dropped++;
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    char *pos = self->buffer + self->buffer_used;
+    GjsProfilerSampleHeader header;
+    header.timestamp = (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000 -
+        self->start_time;
+    header.n_frames = depth;
+    memcpy(pos, &header, sizeof(header));
+    pos += sizeof(header);
+
+    for (uint32_t i = 0; i < depth; i++) {
+        const char *label = self->stack->entries[i].label();
+        if (!label)
+            label = "(unknown)";
+
+        size_t len = 0;
+        while (len < GJS_PROFILER_MAX_LABEL && label[len] != '\0') {
+            pos[len] = label[len];
+            len++;
+        }
+        pos[len] = '\0';
+        pos += len + 1;
+    }
+
+    self->buffer_used = pos - self->buffer;
+}
+
+static sigset_t
+profiler_signal_set(void)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    return set;
+}
+
+#endif  /* ENABLE_PROFILER */
+
+/* Moves the samples out of the signal handler's buffer into the tree of
+ * frames; must be called on the thread that is being sampled */
+static void
+drain_samples(GjsProfiler *self)
+{
+#ifdef ENABLE_PROFILER
+    sigset_t set = profiler_signal_set(), old_set;
+    pthread_sigmask(SIG_BLOCK, &set, &old_set);
+
+    const char *pos = self->buffer;
+    const char *end = self->buffer + self->buffer_used;
+
+    while (pos < end) {
+        GjsProfilerSampleHeader header;
+        memcpy(&header, pos, sizeof(header));
+        pos += sizeof(header);
+
+        unsigned node = 0;
+        for (uint16_t i = 0; i < header.n_frames; i++) {
+            node = intern_node(self, node, pos);
+            pos += strlen(pos) + 1;
+        }
+
+        GjsProfilerSample sample = { header.timestamp, node };
+        g_array_append_val(self->samples, sample);
+    }
+
+    self->buffer_used = 0;
+
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+#endif
+}
+
+static gboolean
+drain_samples_idle(gpointer data)
+{
+    drain_samples((GjsProfiler *) data);
+    return G_SOURCE_CONTINUE;
+}
+
+/* Labels are escaped for both output formats: collapsed stacks use ';' as
+ * the frame separator and JSON needs quotes and control characters escaped */
+static void
+append_escaped_label(GString    *out,
+                     const char *label,
+                     bool        json)
+{
+    for (const char *c = label; *c; c++) {
+        if (json && (*c == '"' || *c == '\\'))
+            g_string_append_printf(out, "\\%c", *c);
+        else if (json && (unsigned char) *c < 0x20)
+            g_string_append_printf(out, "\\u%04x", *c);
+        else if (!json && *c == ';')
+            g_string_append_c(out, ':');
+        else if (!json && *c == '\n')
+            g_string_append_c(out, ' ');
+        else
+            g_string_append_c(out, *c);
+    }
+}
+
+static void
+append_collapsed_stack(GjsProfiler *self,
+                       GString     *out,
+                       unsigned     node)
+{
+    GjsProfilerNode *n = &g_array_index(self->nodes, GjsProfilerNode, node);
+
+    if (n->parent != 0) {
+        append_collapsed_stack(self, out, n->parent);
+        g_string_append_c(out, ';');
+    }
+    append_escaped_label(out, n->label, false);
+}
+
+static GString *
+format_collapsed(GjsProfiler *self)
+{
+    GString *out = g_string_new(NULL);
+    unsigned *counts = g_new0(unsigned, self->nodes->len);
+
+    for (unsigned i = 0; i < self->samples->len; i++)
+        counts[g_array_index(self->samples, GjsProfilerSample, i).node]++;
+
+    for (unsigned node = 1; node < self->nodes->len; node++) {
+        if (counts[node] == 0)
+            continue;
+
+        append_collapsed_stack(self, out, node);
+        g_string_append_printf(out, " %u\n", counts[node]);
+    }
+
+    g_free(counts);
+    return out;
+}
+
+static GString *
+format_chrome_trace(GjsProfiler *self)
+{
+    GString *out = g_string_new("{\"traceEvents\":[],\"stackFrames\":{");
+    unsigned pid = 0, tid = 0;
+
+#ifdef ENABLE_PROFILER
+    pid = getpid();
+    tid = self->tid;
+#endif
+
+    for (unsigned node = 1; node < self->nodes->len; node++) {
+        GjsProfilerNode *n = &g_array_index(self->nodes, GjsProfilerNode, node);
+
+        g_string_append_printf(out, "%s\"%u\":{\"category\":\"cjs\",\"name\":\"",
+                               node > 1 ? "," : "", node);
+        append_escaped_label(out, n->label, true);
+        g_string_append_c(out, '"');
+        if (n->parent != 0)
+            g_string_append_printf(out, ",\"parent\":\"%u\"", n->parent);
+        g_string_append_c(out, '}');
+    }
+
+    g_string_append(out, "},\"samples\":[");
+
+    for (unsigned i = 0; i < self->samples->len; i++) {
+        GjsProfilerSample *sample = &g_array_index(self->samples, GjsProfilerSample, i);
+        g_string_append_printf(out,
+                               "%s{\"cpu\":0,\"pid\":%u,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT
+                               ",\"name\":\"cjs\",\"sf\":\"%u\",\"weight\":1}",
+                               i > 0 ? "," : "", pid, tid, sample->timestamp,
+                               sample->node);
+    }
+
+    g_string_append(out, "]}\n");
+    return out;
+}
+
+static void
+write_profile(GjsProfiler *self)
+{
+    char *filename = self->filename ?
+        g_strdup(self->filename) :
+        g_strdup_printf("cjs-%u.collapsed", (unsigned) getpid());
+
+    GString *out = g_str_has_suffix(filename, ".json") ?
+        format_chrome_trace(self) : format_collapsed(self);
+
+    GError *error = NULL;
+    if (!g_file_set_contents(filename, out->str, out->len, &error)) {
+        g_warning("Failed to write profile to %s: %s", filename, error->message);
+        g_clear_error(&error);
+    } else {
+        gjs_debug(GJS_DEBUG_CONTEXT, "Wrote %u samples to %s",
+                  self->samples->len, filename);
+    }
+
+    if (self->n_dropped > 0)
+        g_warning("Profiler dropped %u samples because its buffer was full; "
+                  "try a lower sampling frequency", self->n_dropped);
+
+    g_string_free(out, true);
+    g_free(filename);
+}
+
+/**
+ * gjs_profiler_start:
+ * @self: A #GjsProfiler
+ *
+ * Starts sampling the JS stack of the profiler's context. Must be called on
+ * the thread that owns the context. The samples are written out when the
+ * profiler is stopped.
+ */
+void
+gjs_profiler_start(GjsProfiler *self)
+{
+    g_return_if_fail(self);
+
+    if (self->running)
+        return;
+
+#ifdef ENABLE_PROFILER
+    if (sampling_profiler) {
+        g_warning("Only one profiler can run at a time");
+        return;
+    }
+
+    self->buffer = (char *) g_malloc(GJS_PROFILER_BUFFER_SIZE);
+    self->buffer_used = 0;
+    self->n_dropped = 0;
+    self->nodes = g_array_new(false, false, sizeof(GjsProfilerNode));
+    g_array_set_clear_func(self->nodes, free_node);
+    GjsProfilerNode root = { 0, g_strdup("(root)") };
+    g_array_append_val(self->nodes, root);
+    self->node_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                             g_free, NULL);
+    self->samples = g_array_new(false, false, sizeof(GjsProfilerSample));
+    self->start_time = g_get_monotonic_time();
+    self->tid = (pid_t) syscall(__NR_gettid);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = gjs_profiler_sigprof;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &self->old_sigprof) == -1) {
+        g_warning("Failed to install profiler signal handler: %s",
+                  g_strerror(errno));
+        goto fail;
+    }
+
+    /* Deliver the signal to this thread only, since that is the one whose
+     * profiling stack we read */
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev._sigev_un._tid = self->tid;
+
+    if (timer_create(CLOCK_MONOTONIC, &sev, &self->timer) == -1) {
+        g_warning("Failed to create profiler timer: %s", g_strerror(errno));
+        sigaction(SIGPROF, &self->old_sigprof, NULL);
+        goto fail;
+    }
+
+    sampling_profiler = self;
+    js::EnableRuntimeProfilingStack(self->runtime, true);
+    self->running = true;
+
+    struct itimerspec its;
+    guint64 period_ns = G_GUINT64_CONSTANT(1000000000) / self->frequency;
+    its.it_interval.tv_sec = period_ns / 1000000000;
+    its.it_interval.tv_nsec = period_ns % 1000000000;
+    its.it_value = its.it_interval;
+    if (timer_settime(self->timer, 0, &its, NULL) == -1) {
+        g_warning("Failed to start profiler timer: %s", g_strerror(errno));
+        gjs_profiler_stop(self);
+        return;
+    }
+
+    self->drain_source_id = g_timeout_add_seconds(1, drain_samples_idle, self);
+    g_source_set_name_by_id(self->drain_source_id, "[cjs] profiler drain");
+    return;
+
+ fail:
+    g_clear_pointer(&self->buffer, g_free);
+    g_clear_pointer(&self->nodes, g_array_unref);
+    g_clear_pointer(&self->node_index, g_hash_table_unref);
+    g_clear_pointer(&self->samples, g_array_unref);
+#else
+    g_warning("The profiler is not supported on this platform");
+#endif
+}
+
+/**
+ * gjs_profiler_stop:
+ * @self: A #GjsProfiler
+ *
+ * Stops sampling, and writes the profile to the file set with
+ * gjs_profiler_set_filename().
+ */
+void
+gjs_profiler_stop(GjsProfiler *self)
+{
+    g_return_if_fail(self);
+
+    if (!self->running)
+        return;
+
+#ifdef ENABLE_PROFILER
+    timer_delete(self->timer);
+    sigaction(SIGPROF, &self->old_sigprof, NULL);
+#endif
+
+    js::EnableRuntimeProfilingStack(self->runtime, false);
+    self->running = false;
+    sampling_profiler = NULL;
+
+    if (self->drain_source_id) {
+        g_source_remove(self->drain_source_id);
+        self->drain_source_id = 0;
+    }
+
+    drain_samples(self);
+    write_profile(self);
+
+    g_clear_pointer(&self->buffer, g_free);
+    g_clear_pointer(&self->nodes, g_array_unref);
+    g_clear_pointer(&self->node_index, g_hash_table_unref);
+    g_clear_pointer(&self->samples, g_array_unref);
+}
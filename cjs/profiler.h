@@ -0,0 +1,57 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GJS_PROFILER_H
+#define GJS_PROFILER_H
+
+#if !defined (__GJS_GJS_H__) && !defined (GJS_COMPILATION)
+#error "Only <gjs/gjs.h> can be included directly."
+#endif
+
+#include <stdbool.h>
+#include <glib.h>
+
+#include <cjs/macros.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GjsProfiler GjsProfiler;
+
+GJS_EXPORT
+void gjs_profiler_set_filename(GjsProfiler *self,
+                               const char  *filename);
+
+GJS_EXPORT
+void gjs_profiler_set_frequency(GjsProfiler *self,
+                                unsigned     frequency);
+
+GJS_EXPORT
+void gjs_profiler_start(GjsProfiler *self);
+
+GJS_EXPORT
+void gjs_profiler_stop(GjsProfiler *self);
+
+GJS_EXPORT
+bool gjs_profiler_is_running(GjsProfiler *self);
+
+G_END_DECLS
+
+#endif /* GJS_PROFILER_H */
@@ -35,6 +35,8 @@
 struct RuntimeData {
   unsigned refcount;
   bool in_gc_sweep;
+  GjsGCTelemetry *gc_telemetry;
+  GData *data_list;
 };
 
 bool
@@ -45,6 +47,35 @@ gjs_runtime_is_sweeping (JSRuntime *runtime)
   return data->in_gc_sweep;
 }
 
+GjsGCTelemetry *
+gjs_runtime_get_gc_telemetry(JSRuntime *runtime)
+{
+    RuntimeData *data = static_cast<RuntimeData *>(JS_GetRuntimePrivate(runtime));
+    return data->gc_telemetry;
+}
+
+/* Per-runtime storage for modules that keep caches shared by all contexts on
+ * the thread. The destroy notifications run just before the runtime itself is
+ * destroyed, so they may still call into the JSAPI. Only to be used from the
+ * runtime's own thread. */
+void
+gjs_runtime_set_data(JSRuntime     *runtime,
+                     const char    *key,
+                     void          *data,
+                     GDestroyNotify destroy)
+{
+    RuntimeData *rtdata = static_cast<RuntimeData *>(JS_GetRuntimePrivate(runtime));
+    g_datalist_set_data_full(&rtdata->data_list, key, data, destroy);
+}
+
+void *
+gjs_runtime_get_data(JSRuntime  *runtime,
+                     const char *key)
+{
+    RuntimeData *rtdata = static_cast<RuntimeData *>(JS_GetRuntimePrivate(runtime));
+    return g_datalist_get_data(&rtdata->data_list, key);
+}
+
 /* Implementations of locale-specific operations; these are used
  * in the implementation of String.localeCompare(), Date.toLocaleDateString(),
  * and so forth. We take the straight-forward approach of converting
@@ -157,7 +188,9 @@ destroy_runtime(gpointer data)
     JSRuntime *runtime = (JSRuntime *) data;
     RuntimeData *rtdata = (RuntimeData *) JS_GetRuntimePrivate(runtime);
 
+    g_datalist_clear(&rtdata->data_list);
     JS_DestroyRuntime(runtime);
+    _gjs_gc_telemetry_free(rtdata->gc_telemetry);
     g_free(rtdata);
 }
 
@@ -297,6 +330,7 @@ gjs_runtime_for_current_thread(void)
             g_error("Failed to create javascript runtime");
 
         data = g_new0(RuntimeData, 1);
+        data->gc_telemetry = _gjs_gc_telemetry_new();
         JS_SetRuntimePrivate(runtime, data);
 
         // commented are defaults in moz-24
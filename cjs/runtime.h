@@ -26,9 +26,20 @@
 
 #include <stdbool.h>
 
+#include "gc-telemetry.h"
+
 JSRuntime *gjs_runtime_ref(void);
 void gjs_runtime_unref(void);
 
 bool        gjs_runtime_is_sweeping        (JSRuntime *runtime);
 
+GjsGCTelemetry *gjs_runtime_get_gc_telemetry(JSRuntime *runtime);
+
+void  gjs_runtime_set_data(JSRuntime     *runtime,
+                           const char    *key,
+                           void          *data,
+                           GDestroyNotify destroy);
+void *gjs_runtime_get_data(JSRuntime  *runtime,
+                           const char *key);
+
 #endif /* __GJS_RUNTIME_H__ */
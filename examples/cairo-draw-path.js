@@ -0,0 +1,47 @@
+// Compares drawing a long polyline with one Context method call per segment
+// against replaying the same segments with Context.drawPath().
+
+const Cairo = imports.cairo;
+const GLib = imports.gi.GLib;
+
+const N_SEGMENTS = 10000;
+const N_ROUNDS = 20;
+
+let surface = new Cairo.ImageSurface(Cairo.Format.ARGB32, 1000, 500);
+let cr = new Cairo.Context(surface);
+
+let points = [];
+for (let i = 0; i <= N_SEGMENTS; i++)
+    points.push([i * 1000 / N_SEGMENTS, 250 + 200 * Math.sin(i / 50)]);
+
+function perCall() {
+    cr.moveTo(points[0][0], points[0][1]);
+    for (let i = 1; i < points.length; i++)
+        cr.lineTo(points[i][0], points[i][1]);
+    cr.stroke();
+}
+
+let ops = new Float64Array(points.length * 3);
+for (let i = 0; i < points.length; i++) {
+    ops[i * 3] = i === 0 ? Cairo.PathOp.MOVE_TO : Cairo.PathOp.LINE_TO;
+    ops[i * 3 + 1] = points[i][0];
+    ops[i * 3 + 2] = points[i][1];
+}
+
+function batched() {
+    cr.drawPath(ops);
+    cr.stroke();
+}
+
+function time(name, func) {
+    func();  // warm up
+    let start = GLib.get_monotonic_time();
+    for (let i = 0; i < N_ROUNDS; i++)
+        func();
+    let usec = (GLib.get_monotonic_time() - start) / N_ROUNDS;
+    print(name + ': ' + (usec / 1000).toFixed(2) + ' ms per ' + N_SEGMENTS +
+        '-segment polyline');
+}
+
+time('per-call', perCall);
+time('drawPath', batched);
@@ -2346,13 +2346,32 @@ gjs_value_from_explicit_array(JSContext             *context,
                               JS::MutableHandleValue value_p,
                               GITypeInfo            *type_info,
                               GIArgument            *arg,
-                              int                    length)
+                              int                    length,
+                              GITransfer             transfer)
 {
     GITypeInfo *param_info;
     bool res;
 
     param_info = g_type_info_get_param_type(type_info, 0);
 
+    /* A byte array we own is handed over to the ByteArray rather than
+     * copied; arg is cleared so that releasing it afterwards is a no-op */
+    if (transfer != GI_TRANSFER_NOTHING && arg->v_pointer != NULL &&
+        g_type_info_get_tag(param_info) == GI_TYPE_TAG_UINT8) {
+        g_base_info_unref((GIBaseInfo*)param_info);
+
+        GBytes *bytes = g_bytes_new_take(arg->v_pointer, length);
+        arg->v_pointer = NULL;
+
+        JSObject *obj = gjs_byte_array_from_bytes(context, bytes);
+        g_bytes_unref(bytes);
+        if (obj == NULL)
+            return false;
+
+        value_p.setObject(*obj);
+        return true;
+    }
+
     res = gjs_array_from_carray_internal(context, value_p, param_info, length, arg->v_pointer);
 
     g_base_info_unref((GIBaseInfo*)param_info);
@@ -2828,7 +2847,8 @@ gjs_value_from_g_argument (JSContext             *context,
                 goto out;
             } else if (interface_type == GI_INFO_TYPE_UNION) {
                 JSObject *obj;
-                obj = gjs_union_from_c_union(context, (GIUnionInfo *)interface_info, arg->v_pointer);
+                obj = gjs_union_from_c_union(context, (GIUnionInfo *)interface_info, arg->v_pointer,
+                                             copy_structs ? GJS_BOXED_CREATION_NONE : GJS_BOXED_CREATION_NO_COPY);
                 if (obj)
                         value = JS::ObjectValue(*obj);
 
@@ -77,7 +77,8 @@ bool gjs_value_from_explicit_array(JSContext             *context,
                                    JS::MutableHandleValue value_p,
                                    GITypeInfo            *type_info,
                                    GIArgument            *arg,
-                                   int                    length);
+                                   int                    length,
+                                   GITransfer             transfer = GI_TRANSFER_NOTHING);
 
 bool gjs_g_argument_release    (JSContext  *context,
                                 GITransfer  transfer,
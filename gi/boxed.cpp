@@ -35,6 +35,8 @@
 #include "proxyutils.h"
 #include "function.h"
 #include "gtype.h"
+#include "variant.h"
+#include "gjs_gi_trace.h"
 
 #include <util/log.h>
 
@@ -42,7 +44,22 @@
 
 /* Reserved slots of JSNative accessor wrappers */
 enum {
-    SLOT_PROP_NAME,
+    SLOT_FIELD,
+    SLOT_PROTO,  /* keeps the prototype, which owns the field, alive */
+};
+
+/* Everything the field accessors need, worked out once when the prototype
+ * is defined rather than on every access. Fields of a scalar type are read
+ * and written directly at their offset. */
+struct BoxedField {
+    GIStructInfo *owner;  /* the struct this is a field of */
+    GIFieldInfo *info;
+    GITypeInfo *type_info;
+    GIBaseInfo *nested_info;  /* if the field is a struct stored inline */
+    int offset;
+    GITypeTag direct_tag;  /* GI_TYPE_TAG_VOID if not accessed directly */
+    guint readable : 1;
+    guint writable : 1;
 };
 
 struct Boxed {
@@ -53,19 +70,98 @@ struct Boxed {
     JS::Heap<jsid> zero_args_constructor_name;
     gint default_constructor; /* -1 if none */
     JS::Heap<jsid> default_constructor_name;
+    GjsTypeCounter *type_counter;
 
     /* instance info */
+    GjsTypeCounter *counted_in;
     void *gboxed; /* NULL if we are the prototype and not an instance */
     GHashTable *field_map;
+    BoxedField *fields;  /* prototype only */
+    int n_fields;
+    unsigned inline_size;  /* 0 if instances are never stored inline */
 
     guint can_allocate_directly : 1;
     guint allocated_directly : 1;
     guint not_owning_gboxed : 1; /* if set, the JS wrapper does not own
                                     the reference to the C gboxed */
+    guint has_inline_storage : 1;
 };
 
+/* Small plain-old-data structs, such as rectangles, points and colors, are
+ * stored right after their wrapper's Boxed, in the same allocation. These
+ * wrappers borrow the prototype's info rather than taking a reference,
+ * since the prototype outlives them. */
+#define BOXED_INLINE_MAX_SIZE 64
+#define BOXED_INLINE_OFFSET ((sizeof(Boxed) + 15) & ~(size_t) 15)
+
 static bool struct_is_simple(GIStructInfo *info);
 
+static void *
+boxed_inline_storage(Boxed *priv)
+{
+    return reinterpret_cast<char *>(priv) + BOXED_INLINE_OFFSET;
+}
+
+static bool
+boxed_is_inline(Boxed *priv)
+{
+    return priv->has_inline_storage && priv->gboxed == boxed_inline_storage(priv);
+}
+
+static Boxed *
+boxed_new_instance_priv(Boxed *proto_priv)
+{
+    Boxed *priv;
+
+    if (proto_priv->inline_size > 0) {
+        priv = static_cast<Boxed *>(g_slice_alloc0(BOXED_INLINE_OFFSET +
+                                                   proto_priv->inline_size));
+        new (priv) Boxed();
+        *priv = *proto_priv;
+        priv->has_inline_storage = true;
+    } else {
+        priv = g_slice_new0(Boxed);
+        new (priv) Boxed();
+        *priv = *proto_priv;
+        g_base_info_ref( (GIBaseInfo*) priv->info);
+    }
+
+    priv->fields = NULL;
+    priv->n_fields = 0;
+
+    priv->counted_in = proto_priv->type_counter;
+    gjs_type_counter_inc(priv->counted_in);
+
+    return priv;
+}
+
+static void
+boxed_free_priv(Boxed *priv)
+{
+    gsize size = sizeof(Boxed);
+    if (priv->has_inline_storage)
+        size = BOXED_INLINE_OFFSET + priv->inline_size;
+
+    priv->~Boxed();
+    g_slice_free1(size, priv);
+}
+
+/* Plain C structs have no GType, so they are counted by their
+ * introspected name instead */
+static GjsTypeCounter *
+boxed_type_counter_get(Boxed *priv)
+{
+    if (priv->gtype != G_TYPE_NONE)
+        return gjs_type_counter_get_for_gtype(GJS_TYPE_COUNTER_BOXED, priv->gtype);
+
+    char *name = g_strdup_printf("%s.%s",
+                                 g_base_info_get_namespace((GIBaseInfo *) priv->info),
+                                 g_base_info_get_name((GIBaseInfo *) priv->info));
+    GjsTypeCounter *counter = gjs_type_counter_get(GJS_TYPE_COUNTER_BOXED, name);
+    g_free(name);
+    return counter;
+}
+
 static bool boxed_set_field_from_value(JSContext      *context,
                                        Boxed          *priv,
                                        GIFieldInfo    *field_info,
@@ -220,6 +316,12 @@ boxed_new_direct(Boxed       *priv)
 {
     g_assert(priv->can_allocate_directly);
 
+    if (priv->has_inline_storage) {
+        /* Already zeroed along with the rest of the allocation */
+        priv->gboxed = boxed_inline_storage(priv);
+        return;
+    }
+
     priv->gboxed = g_slice_alloc0(g_struct_info_get_size (priv->info));
     priv->allocated_directly = true;
 
@@ -345,11 +447,19 @@ boxed_new(JSContext             *context,
           JS::CallArgs&          args)
 {
     if (priv->gtype == G_TYPE_VARIANT) {
-        /* Short-circuit construction for GVariants by calling into the JS packing
-           function */
-        JS::HandleId constructor_name =
-            gjs_context_get_const_string(context, GJS_STRING_NEW_INTERNAL);
-        return boxed_invoke_constructor(context, obj, constructor_name, args);
+        /* Short-circuit construction for GVariants by packing the value
+           natively; see variant.cpp */
+        char *signature;
+        if (!gjs_string_to_utf8(context, args.get(0), &signature))
+            return false;
+
+        GVariant *variant = gjs_variant_pack(context, signature, args.get(1));
+        g_free(signature);
+        if (!variant)
+            return false;
+
+        priv->gboxed = g_variant_ref_sink(variant);
+        return true;
     }
 
     /* If the structure is registered as a boxed, we can create a new instance by
@@ -425,18 +535,6 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
 
     GJS_NATIVE_CONSTRUCTOR_PRELUDE(boxed);
 
-    priv = g_slice_new0(Boxed);
-    new (priv) Boxed();
-
-    GJS_INC_COUNTER(boxed);
-
-    g_assert(priv_from_js(context, object) == NULL);
-    JS_SetPrivate(object, priv);
-
-    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
-                        "boxed constructor, obj %p priv %p",
-                        object.get(), priv);
-
     JS_GetPrototype(context, object, &proto);
     gjs_debug_lifecycle(GJS_DEBUG_GBOXED, "boxed instance __proto__ is %p",
                         proto.get());
@@ -451,14 +549,31 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(boxed)
         return false;
     }
 
-    *priv = *proto_priv;
-    g_base_info_ref( (GIBaseInfo*) priv->info);
+    priv = boxed_new_instance_priv(proto_priv);
+
+    GJS_INC_COUNTER(boxed);
+
+    g_assert(priv_from_js(context, object) == NULL);
+    JS_SetPrivate(object, priv);
+
+    gjs_debug_lifecycle(GJS_DEBUG_GBOXED,
+                        "boxed constructor, obj %p priv %p",
+                        object.get(), priv);
+
+    TRACE(GJS_BOXED_PROXY_NEW(priv, (char *) g_base_info_get_namespace((GIBaseInfo*) priv->info),
+                              (char *) g_base_info_get_name((GIBaseInfo*) priv->info)));
 
     /* Short-circuit copy-construction in the case where we can use g_boxed_copy or memcpy */
     if (argc == 1 &&
         boxed_get_copy_source(context, priv, argv[0], &source_priv)) {
 
-        if (g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
+        if (priv->has_inline_storage) {
+            boxed_new_direct(priv);
+            memcpy(priv->gboxed, source_priv->gboxed, priv->inline_size);
+
+            GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
+            return true;
+        } else if (g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
             priv->gboxed = g_boxed_copy(priv->gtype, source_priv->gboxed);
 
             GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
@@ -498,7 +613,18 @@ boxed_finalize(JSFreeOp *fop,
     if (priv == NULL)
         return; /* wrong class? */
 
-    if (priv->gboxed && !priv->not_owning_gboxed) {
+    /* Prototypes have no gboxed and were never reported as created. The
+     * borrowed info of inline wrappers may already be gone, so they are
+     * reported under their type counter's name. */
+    if (priv->gboxed && priv->has_inline_storage) {
+        TRACE(GJS_BOXED_PROXY_FINALIZE(priv, (char *) "",
+                                       (char *) priv->counted_in->name));
+    } else if (priv->gboxed) {
+        TRACE(GJS_BOXED_PROXY_FINALIZE(priv, (char *) g_base_info_get_namespace((GIBaseInfo*) priv->info),
+                                       (char *) g_base_info_get_name((GIBaseInfo*) priv->info)));
+    }
+
+    if (priv->gboxed && !priv->not_owning_gboxed && !boxed_is_inline(priv)) {
         if (priv->allocated_directly) {
             g_slice_free1(g_struct_info_get_size (priv->info), priv->gboxed);
         } else {
@@ -513,33 +639,28 @@ boxed_finalize(JSFreeOp *fop,
         priv->gboxed = NULL;
     }
 
-    if (priv->info) {
+    if (priv->info && !priv->has_inline_storage)
         g_base_info_unref( (GIBaseInfo*) priv->info);
-        priv->info = NULL;
-    }
+    priv->info = NULL;
 
     if (priv->field_map) {
         g_hash_table_destroy(priv->field_map);
     }
 
-    GJS_DEC_COUNTER(boxed);
-    priv->~Boxed();
-    g_slice_free(Boxed, priv);
-}
-
-static GIFieldInfo *
-get_field_info(JSContext *cx,
-               Boxed     *priv,
-               uint32_t   id)
-{
-    GIFieldInfo *field_info = g_struct_info_get_field(priv->info, id);
-    if (field_info == NULL) {
-        gjs_throw(cx, "No field %d on boxed type %s",
-                  id, g_base_info_get_name((GIBaseInfo *)priv->info));
-        return NULL;
+    for (int i = 0; i < priv->n_fields; i++) {
+        BoxedField *field = &priv->fields[i];
+        g_base_info_unref(field->info);
+        g_base_info_unref(field->type_info);
+        if (field->nested_info)
+            g_base_info_unref(field->nested_info);
     }
+    g_free(priv->fields);
+
+    if (priv->counted_in)
+        gjs_type_counter_dec(priv->counted_in);
 
-    return field_info;
+    GJS_DEC_COUNTER(boxed);
+    boxed_free_priv(priv);
 }
 
 static bool
@@ -584,6 +705,8 @@ get_nested_interface_object(JSContext             *context,
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gtype = g_registered_type_info_get_g_type ((GIRegisteredTypeInfo*) interface_info);
     priv->can_allocate_directly = proto_priv->can_allocate_directly;
+    priv->counted_in = proto_priv->type_counter;
+    gjs_type_counter_inc(priv->counted_in);
 
     /* A structure nested inside a parent object; doesn't have an independent allocation */
     priv->gboxed = ((char *)parent_priv->gboxed) + offset;
@@ -599,11 +722,12 @@ get_nested_interface_object(JSContext             *context,
 }
 
 static JSObject *
-define_native_accessor_wrapper(JSContext  *cx,
-                               JSNative    call,
-                               unsigned    nargs,
-                               const char *func_name,
-                               uint32_t    id)
+define_native_accessor_wrapper(JSContext       *cx,
+                               JSNative         call,
+                               unsigned         nargs,
+                               const char      *func_name,
+                               JS::HandleObject proto,
+                               BoxedField      *field)
 {
     JSFunction *func = js::NewFunctionWithReserved(cx, call, nargs, 0,
                                                    NULL, func_name);
@@ -611,16 +735,194 @@ define_native_accessor_wrapper(JSContext  *cx,
         return NULL;
 
     JSObject *func_obj = JS_GetFunctionObject(func);
-    js::SetFunctionNativeReserved(func_obj, SLOT_PROP_NAME,
-                                  JS::PrivateUint32Value(id));
+    js::SetFunctionNativeReserved(func_obj, SLOT_FIELD,
+                                  JS::PrivateValue(field));
+    js::SetFunctionNativeReserved(func_obj, SLOT_PROTO, JS::ObjectValue(*proto));
     return func_obj;
 }
 
-static uint32_t
-native_accessor_slot(JSObject *func_obj)
+static BoxedField *
+native_accessor_field(JSObject *func_obj)
 {
-    return js::GetFunctionNativeReserved(func_obj, SLOT_PROP_NAME)
-        .toPrivateUint32();
+    return static_cast<BoxedField *>(js::GetFunctionNativeReserved(func_obj, SLOT_FIELD)
+        .toPrivate());
+}
+
+/* The same scalar types as g_field_info_get_field() handles, apart from
+ * enums and flags */
+static GITypeTag
+field_direct_tag(GIFieldInfo *field_info,
+                 GITypeInfo  *type_info)
+{
+    if (g_type_info_is_pointer(type_info) || g_field_info_get_size(field_info) != 0)
+        return GI_TYPE_TAG_VOID;
+
+    GITypeTag tag = g_type_info_get_tag(type_info);
+    switch (tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+    case GI_TYPE_TAG_GTYPE:
+    case GI_TYPE_TAG_UNICHAR:
+        return tag;
+    default:
+        return GI_TYPE_TAG_VOID;
+    }
+}
+
+static void
+boxed_field_init(BoxedField   *field,
+                 GIStructInfo *owner,
+                 GIFieldInfo  *field_info)
+{
+    field->owner = owner;
+    field->info = field_info;
+    field->type_info = g_field_info_get_type(field_info);
+    field->offset = g_field_info_get_offset(field_info);
+    field->direct_tag = field_direct_tag(field_info, field->type_info);
+    field->nested_info = NULL;
+
+    GIFieldInfoFlags flags = g_field_info_get_flags(field_info);
+    field->readable = (flags & GI_FIELD_IS_READABLE) != 0;
+    field->writable = (flags & GI_FIELD_IS_WRITABLE) != 0;
+
+    if (!g_type_info_is_pointer(field->type_info) &&
+        g_type_info_get_tag(field->type_info) == GI_TYPE_TAG_INTERFACE) {
+        GIBaseInfo *interface_info = g_type_info_get_interface(field->type_info);
+        GIInfoType info_type = g_base_info_get_type(interface_info);
+
+        if (info_type == GI_INFO_TYPE_STRUCT || info_type == GI_INFO_TYPE_BOXED)
+            field->nested_info = interface_info;
+        else
+            g_base_info_unref(interface_info);
+    }
+}
+
+static void
+boxed_field_load(BoxedField *field,
+                 void       *gboxed,
+                 GIArgument *arg)
+{
+    void *mem = static_cast<char *>(gboxed) + field->offset;
+
+    switch (field->direct_tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+        arg->v_boolean = *static_cast<gboolean *>(mem);
+        break;
+    case GI_TYPE_TAG_INT8:
+        arg->v_int8 = *static_cast<gint8 *>(mem);
+        break;
+    case GI_TYPE_TAG_UINT8:
+        arg->v_uint8 = *static_cast<guint8 *>(mem);
+        break;
+    case GI_TYPE_TAG_INT16:
+        arg->v_int16 = *static_cast<gint16 *>(mem);
+        break;
+    case GI_TYPE_TAG_UINT16:
+        arg->v_uint16 = *static_cast<guint16 *>(mem);
+        break;
+    case GI_TYPE_TAG_INT32:
+        arg->v_int32 = *static_cast<gint32 *>(mem);
+        break;
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_UNICHAR:
+        arg->v_uint32 = *static_cast<guint32 *>(mem);
+        break;
+    case GI_TYPE_TAG_INT64:
+        arg->v_int64 = *static_cast<gint64 *>(mem);
+        break;
+    case GI_TYPE_TAG_UINT64:
+        arg->v_uint64 = *static_cast<guint64 *>(mem);
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        arg->v_float = *static_cast<float *>(mem);
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        arg->v_double = *static_cast<double *>(mem);
+        break;
+    case GI_TYPE_TAG_GTYPE:
+        arg->v_ssize = *static_cast<GType *>(mem);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static void
+boxed_field_store(BoxedField *field,
+                  void       *gboxed,
+                  GIArgument *arg)
+{
+    void *mem = static_cast<char *>(gboxed) + field->offset;
+
+    switch (field->direct_tag) {
+    case GI_TYPE_TAG_BOOLEAN:
+        *static_cast<gboolean *>(mem) = arg->v_boolean;
+        break;
+    case GI_TYPE_TAG_INT8:
+        *static_cast<gint8 *>(mem) = arg->v_int8;
+        break;
+    case GI_TYPE_TAG_UINT8:
+        *static_cast<guint8 *>(mem) = arg->v_uint8;
+        break;
+    case GI_TYPE_TAG_INT16:
+        *static_cast<gint16 *>(mem) = arg->v_int16;
+        break;
+    case GI_TYPE_TAG_UINT16:
+        *static_cast<guint16 *>(mem) = arg->v_uint16;
+        break;
+    case GI_TYPE_TAG_INT32:
+        *static_cast<gint32 *>(mem) = arg->v_int32;
+        break;
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_UNICHAR:
+        *static_cast<guint32 *>(mem) = arg->v_uint32;
+        break;
+    case GI_TYPE_TAG_INT64:
+        *static_cast<gint64 *>(mem) = arg->v_int64;
+        break;
+    case GI_TYPE_TAG_UINT64:
+        *static_cast<guint64 *>(mem) = arg->v_uint64;
+        break;
+    case GI_TYPE_TAG_FLOAT:
+        *static_cast<float *>(mem) = arg->v_float;
+        break;
+    case GI_TYPE_TAG_DOUBLE:
+        *static_cast<double *>(mem) = arg->v_double;
+        break;
+    case GI_TYPE_TAG_GTYPE:
+        *static_cast<GType *>(mem) = arg->v_ssize;
+        break;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* Every boxed type shares gjs_boxed_class, so an accessor taken from one
+ * prototype could be called with .call() on a struct of another type, and
+ * read or write past its end */
+static bool
+boxed_field_check_owner(JSContext  *context,
+                        Boxed      *priv,
+                        BoxedField *field)
+{
+    if (priv->info == field->owner ||
+        g_base_info_equal((GIBaseInfo *) priv->info, (GIBaseInfo *) field->owner))
+        return true;
+
+    gjs_throw(context, "Field %s.%s can't be accessed on an object of type %s",
+              g_base_info_get_name((GIBaseInfo *) field->owner),
+              g_base_info_get_name((GIBaseInfo *) field->info),
+              g_base_info_get_name((GIBaseInfo *) priv->info));
+    return false;
 }
 
 static bool
@@ -629,63 +931,35 @@ boxed_field_getter(JSContext *context,
                    JS::Value *vp)
 {
     GJS_GET_PRIV(context, argc, vp, args, obj, Boxed, priv);
-    GIFieldInfo *field_info;
-    GITypeInfo *type_info;
+    BoxedField *field = native_accessor_field(&args.callee());
     GArgument arg;
-    bool success = false;
 
-    field_info = get_field_info(context, priv,
-                                native_accessor_slot(&args.callee()));
-    if (!field_info)
+    if (!boxed_field_check_owner(context, priv, field))
         return false;
 
-    type_info = g_field_info_get_type (field_info);
-
     if (priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(context, "Can't get field %s.%s from a prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  g_base_info_get_name ((GIBaseInfo *)field->info));
+        return false;
     }
 
-    if (!g_type_info_is_pointer (type_info) &&
-        g_type_info_get_tag (type_info) == GI_TYPE_TAG_INTERFACE) {
-
-        GIBaseInfo *interface_info = g_type_info_get_interface(type_info);
-
-        if (g_base_info_get_type (interface_info) == GI_INFO_TYPE_STRUCT ||
-            g_base_info_get_type (interface_info) == GI_INFO_TYPE_BOXED) {
-
-            success = get_nested_interface_object (context, obj, priv,
-                                                   field_info, type_info, interface_info,
-                                                   args.rval());
+    if (field->nested_info)
+        return get_nested_interface_object (context, obj, priv,
+                                            field->info, field->type_info,
+                                            field->nested_info, args.rval());
 
-            g_base_info_unref ((GIBaseInfo *)interface_info);
-
-            goto out;
-        }
-
-        g_base_info_unref ((GIBaseInfo *)interface_info);
-    }
-
-    if (!g_field_info_get_field (field_info, priv->gboxed, &arg)) {
+    if (field->direct_tag != GI_TYPE_TAG_VOID && field->readable) {
+        boxed_field_load(field, priv->gboxed, &arg);
+    } else if (!g_field_info_get_field (field->info, priv->gboxed, &arg)) {
         gjs_throw(context, "Reading field %s.%s is not supported",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  g_base_info_get_name ((GIBaseInfo *)field->info));
+        return false;
     }
 
-    if (!gjs_value_from_g_argument(context, args.rval(), type_info,
-                                   &arg, true))
-        goto out;
-
-    success = true;
-
-out:
-    g_base_info_unref ((GIBaseInfo *)field_info);
-    g_base_info_unref ((GIBaseInfo *)type_info);
-
-    return success;
+    return gjs_value_from_g_argument(context, args.rval(), field->type_info,
+                                     &arg, true);
 }
 
 static bool
@@ -807,31 +1081,34 @@ boxed_field_setter(JSContext *cx,
                    JS::Value *vp)
 {
     GJS_GET_PRIV(cx, argc, vp, args, obj, Boxed, priv);
-    GIFieldInfo *field_info;
-    bool success = false;
+    BoxedField *field = native_accessor_field(&args.callee());
 
-    field_info = get_field_info(cx, priv,
-                                native_accessor_slot(&args.callee()));
-    if (!field_info)
+    if (!boxed_field_check_owner(cx, priv, field))
         return false;
 
     if (priv->gboxed == NULL) { /* direct access to proto field */
         gjs_throw(cx, "Can't set field %s.%s on prototype",
                   g_base_info_get_name ((GIBaseInfo *)priv->info),
-                  g_base_info_get_name ((GIBaseInfo *)field_info));
-        goto out;
+                  g_base_info_get_name ((GIBaseInfo *)field->info));
+        return false;
     }
 
-    if (!boxed_set_field_from_value(cx, priv, field_info, args[0]))
-        goto out;
-
-    args.rval().setUndefined();  /* No stored value */
-    success = true;
+    if (field->direct_tag != GI_TYPE_TAG_VOID && field->writable) {
+        /* Scalars need no releasing after conversion */
+        GArgument arg;
+        if (!gjs_value_to_g_argument(cx, args[0], field->type_info,
+                                     g_base_info_get_name ((GIBaseInfo *)field->info),
+                                     GJS_ARGUMENT_FIELD, GI_TRANSFER_NOTHING,
+                                     true, &arg))
+            return false;
 
-out:
-    g_base_info_unref ((GIBaseInfo *)field_info);
+        boxed_field_store(field, priv->gboxed, &arg);
+    } else if (!boxed_set_field_from_value(cx, priv, field->info, args[0])) {
+        return false;
+    }
 
-    return success;
+    args.rval().setUndefined();  /* No stored value */
+    return true;
 }
 
 static bool
@@ -863,27 +1140,34 @@ define_boxed_class_fields(JSContext       *cx,
         n_fields = 256;
     }
 
+    /* The accessors point into this array, which lives as long as the
+     * prototype */
+    priv->fields = g_new0(BoxedField, n_fields);
+    priv->n_fields = n_fields;
+
     for (i = 0; i < n_fields; i++) {
-        GIFieldInfo *field = g_struct_info_get_field (priv->info, i);
-        const char *field_name = g_base_info_get_name ((GIBaseInfo *)field);
+        BoxedField *field = &priv->fields[i];
+        boxed_field_init(field, priv->info,
+                         g_struct_info_get_field (priv->info, i));
+
+        const char *field_name = g_base_info_get_name ((GIBaseInfo *)field->info);
         GjsAutoChar getter_name = g_strconcat("boxed_field_get::",
                                               field_name, NULL);
         GjsAutoChar setter_name = g_strconcat("boxed_field_set::",
                                               field_name, NULL);
-        g_base_info_unref ((GIBaseInfo *)field);
 
         /* In order to have one getter and setter for all the properties
-         * we define, we must provide the property index in a "reserved
-         * slot" for which we must unfortunately use the jsfriendapi. */
+         * we define, we must provide the field in a "reserved slot" for
+         * which we must unfortunately use the jsfriendapi. */
         JS::RootedObject getter(cx,
             define_native_accessor_wrapper(cx, boxed_field_getter, 0,
-                                           getter_name, i));
+                                           getter_name, proto, field));
         if (!getter)
             return false;
 
         JS::RootedObject setter(cx,
             define_native_accessor_wrapper(cx, boxed_field_setter, 1,
-                                           setter_name, i));
+                                           setter_name, proto, field));
         if (!setter)
             return false;
 
@@ -1075,6 +1359,121 @@ struct_is_simple(GIStructInfo *info)
     return is_simple;
 }
 
+static bool struct_fields_are_plain_old_data(GIStructInfo *info);
+
+/* Unlike type_can_be_allocated_directly(), this rejects all pointers, even
+ * to arrays of simple types, since the copy function may duplicate what
+ * they point to */
+static bool
+type_is_plain_old_data(GITypeInfo *type_info)
+{
+    if (g_type_info_is_pointer(type_info))
+        return false;
+
+    switch (g_type_info_get_tag(type_info)) {
+    case GI_TYPE_TAG_INTERFACE:
+        {
+            GIBaseInfo *interface = g_type_info_get_interface(type_info);
+            bool is_plain = false;
+
+            switch (g_base_info_get_type(interface)) {
+            case GI_INFO_TYPE_BOXED:
+            case GI_INFO_TYPE_STRUCT:
+                is_plain = struct_fields_are_plain_old_data((GIStructInfo *) interface);
+                break;
+            case GI_INFO_TYPE_ENUM:
+            case GI_INFO_TYPE_FLAGS:
+                is_plain = true;
+                break;
+            default:
+                break;
+            }
+
+            g_base_info_unref(interface);
+            return is_plain;
+        }
+    case GI_TYPE_TAG_ARRAY:
+        {
+            if (g_type_info_get_array_type(type_info) != GI_ARRAY_TYPE_C ||
+                g_type_info_get_array_fixed_size(type_info) < 0)
+                return false;
+
+            GITypeInfo *param_info = g_type_info_get_param_type(type_info, 0);
+            bool is_plain = type_is_plain_old_data(param_info);
+            g_base_info_unref(param_info);
+            return is_plain;
+        }
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INT64:
+    case GI_TYPE_TAG_UINT64:
+    case GI_TYPE_TAG_FLOAT:
+    case GI_TYPE_TAG_DOUBLE:
+    case GI_TYPE_TAG_UNICHAR:
+    case GI_TYPE_TAG_GTYPE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+struct_fields_are_plain_old_data(GIStructInfo *info)
+{
+    int n_fields = g_struct_info_get_n_fields(info);
+
+    if (n_fields == 0)
+        return false;
+
+    for (int i = 0; i < n_fields; i++) {
+        GIFieldInfo *field_info = g_struct_info_get_field(info, i);
+        GIFieldInfoFlags flags = g_field_info_get_flags(field_info);
+        GITypeInfo *type_info = g_field_info_get_type(field_info);
+
+        bool is_plain = (flags & GI_FIELD_IS_READABLE) &&
+            (flags & GI_FIELD_IS_WRITABLE) &&
+            type_is_plain_old_data(type_info);
+
+        g_base_info_unref(type_info);
+        g_base_info_unref(field_info);
+        if (!is_plain)
+            return false;
+    }
+
+    return true;
+}
+
+/* A boxed type's copy function may do more than copy the bytes, for
+ * example take a reference or duplicate what a field points to, so only
+ * trust structs that are small, have no ref method and whose fields are
+ * all public scalars, stored in place */
+static bool
+struct_is_plain_old_data(Boxed *priv)
+{
+    if (!priv->can_allocate_directly)
+        return false;
+
+    if (priv->gtype != G_TYPE_NONE && !g_type_is_a(priv->gtype, G_TYPE_BOXED))
+        return false;
+
+    gsize size = g_struct_info_get_size(priv->info);
+    if (size == 0 || size > BOXED_INLINE_MAX_SIZE)
+        return false;
+
+    GIFunctionInfo *ref_info = g_struct_info_find_method(priv->info, "ref");
+    if (ref_info) {
+        g_base_info_unref(ref_info);
+        return false;
+    }
+
+    return struct_fields_are_plain_old_data(priv->info);
+}
+
 static void
 boxed_fill_prototype_info(JSContext *context,
                           Boxed     *priv)
@@ -1187,6 +1586,7 @@ gjs_define_boxed_class(JSContext       *context,
 
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gtype = g_registered_type_info_get_g_type ((GIRegisteredTypeInfo*) priv->info);
+    priv->type_counter = boxed_type_counter_get(priv);
     JS_SetPrivate(prototype, priv);
 
     gjs_debug(GJS_DEBUG_GBOXED, "Defined class %s prototype is %p class %p in object %p",
@@ -1194,6 +1594,8 @@ gjs_define_boxed_class(JSContext       *context,
               in_object.get());
 
     priv->can_allocate_directly = struct_is_simple (priv->info);
+    if (struct_is_plain_old_data(priv))
+        priv->inline_size = g_struct_info_get_size (priv->info);
 
     define_boxed_class_fields (context, priv, prototype);
     gjs_define_static_methods (context, constructor, priv->gtype, priv->info);
@@ -1227,14 +1629,12 @@ gjs_boxed_from_c_struct(JSContext             *context,
     obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
 
     GJS_INC_COUNTER(boxed);
-    priv = g_slice_new0(Boxed);
-    new (priv) Boxed();
-
-    *priv = *proto_priv;
-    g_base_info_ref( (GIBaseInfo*) priv->info);
-
+    priv = boxed_new_instance_priv(proto_priv);
     JS_SetPrivate(obj, priv);
 
+    TRACE(GJS_BOXED_PROXY_NEW(priv, (char *) g_base_info_get_namespace((GIBaseInfo*) priv->info),
+                              (char *) g_base_info_get_name((GIBaseInfo*) priv->info)));
+
     if ((flags & GJS_BOXED_CREATION_NO_COPY) != 0) {
         /* we need to create a JS Boxed which references the
          * original C struct, not a copy of it. Used for
@@ -1243,7 +1643,10 @@ gjs_boxed_from_c_struct(JSContext             *context,
         priv->gboxed = gboxed;
         priv->not_owning_gboxed = true;
     } else {
-        if (priv->gtype != G_TYPE_NONE && g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
+        if (priv->has_inline_storage) {
+            boxed_new_direct(priv);
+            memcpy(priv->gboxed, gboxed, priv->inline_size);
+        } else if (priv->gtype != G_TYPE_NONE && g_type_is_a (priv->gtype, G_TYPE_BOXED)) {
             priv->gboxed = g_boxed_copy(priv->gtype, gboxed);
         } else if (priv->gtype == G_TYPE_VARIANT) {
             priv->gboxed = g_variant_ref_sink ((GVariant *) gboxed);
@@ -28,6 +28,7 @@
 #include <util/log.h>
 
 #include "closure.h"
+#include "gjs_gi_trace.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cjs/mem.h"
@@ -206,6 +207,7 @@ gjs_closure_invoke(GClosure                   *closure,
 {
     Closure *c;
     JSContext *context;
+    bool ok;
 
     c = &((GjsClosure*) closure)->priv;
 
@@ -226,10 +228,14 @@ gjs_closure_invoke(GClosure                   *closure,
     }
 
     JS::RootedValue v_closure(context, JS::ObjectValue(*c->obj));
-    if (!gjs_call_function_value(context,
+    TRACE(GJS_CLOSURE_INVOKE_ENTRY(closure, c->obj.get()));
+    ok = gjs_call_function_value(context,
                                  /* "this" object; null is some kind of default presumably */
                                  JS::NullPtr(),
-                                 v_closure, args, retval)) {
+                                 v_closure, args, retval);
+    TRACE(GJS_CLOSURE_INVOKE_RETURN(closure, c->obj.get()));
+
+    if (!ok) {
         /* Exception thrown... */
         gjs_debug_closure("Closure invocation failed (exception should "
                           "have been thrown) closure %p callable %p",
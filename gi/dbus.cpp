@@ -0,0 +1,662 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "boxed.h"
+#include "closure.h"
+#include "dbus.h"
+#include "gerror.h"
+#include "object.h"
+#include "variant.h"
+#include "cjs/context-private.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-wrapper.h"
+#include "libgjs-private/gjs-gdbus-wrapper.h"
+
+/*
+ * D-Bus proxy methods used to be JS closures that rebuilt the input
+ * signature and packed a GVariant for every call. Here, the input type of
+ * each method is computed once per GDBusMethodInfo and shared by every
+ * proxy using that interface; the arguments are packed from the JS values
+ * and the reply unpacked straight into JS.
+ *
+ * Likewise, exported objects used to receive method calls through a GObject
+ * signal on their GjsDBusImplementation and a JS handler that looked up the
+ * method's output signature on each call. Here, the implementation calls
+ * straight into the JS object's methods, with the output types computed
+ * when the object is exported.
+ */
+
+typedef struct {
+    unsigned         ref_count;
+    GDBusMethodInfo *info;
+    GVariantType    *in_type;
+    unsigned         n_in_args;
+} ProxyMethod;
+
+/* Main thread only; entries remove themselves when the last function
+ * object using them is finalized */
+static GHashTable *proxy_methods;
+
+static ProxyMethod *
+proxy_method_lookup(GDBusMethodInfo *info)
+{
+    ProxyMethod *method;
+
+    if (!proxy_methods)
+        proxy_methods = g_hash_table_new(NULL, NULL);
+
+    method = (ProxyMethod *) g_hash_table_lookup(proxy_methods, info);
+    if (method) {
+        method->ref_count++;
+        return method;
+    }
+
+    GString *signature = g_string_new("(");
+    unsigned n_in_args = 0;
+    if (info->in_args) {
+        for (; info->in_args[n_in_args]; n_in_args++)
+            g_string_append(signature, info->in_args[n_in_args]->signature);
+    }
+    g_string_append_c(signature, ')');
+
+    method = g_slice_new(ProxyMethod);
+    method->ref_count = 1;
+    method->info = g_dbus_method_info_ref(info);
+    method->in_type = g_variant_type_new(signature->str);
+    method->n_in_args = n_in_args;
+    g_string_free(signature, true);
+
+    g_hash_table_insert(proxy_methods, info, method);
+    return method;
+}
+
+static void
+proxy_method_unref(ProxyMethod *method)
+{
+    if (--method->ref_count > 0)
+        return;
+
+    g_hash_table_remove(proxy_methods, method->info);
+    g_dbus_method_info_unref(method->info);
+    g_variant_type_free(method->in_type);
+    g_slice_free(ProxyMethod, method);
+}
+
+/* Reserved slots of the methodNameRemote() and methodNameSync() functions.
+ * Functions can't have finalizers, so the ProxyMethod is owned by a small
+ * holder object in the first slot. */
+#define SLOT_METHOD 0
+#define SLOT_SYNC 1
+
+static void proxy_method_finalize(JSFreeOp *fop, JSObject *obj);
+
+static struct JSClass gjs_dbus_proxy_method_class = {
+    "GjsDBusProxyMethod",
+    JSCLASS_HAS_PRIVATE,
+    NULL,  /* addProperty */
+    NULL,  /* deleteProperty */
+    NULL,  /* getProperty */
+    NULL,  /* setProperty */
+    NULL,  /* enumerate */
+    NULL,  /* resolve */
+    NULL,  /* convert */
+    proxy_method_finalize
+};
+
+static void
+proxy_method_finalize(JSFreeOp *fop,
+                      JSObject *obj)
+{
+    auto method = static_cast<ProxyMethod *>(JS_GetPrivate(obj));
+    if (method)
+        proxy_method_unref(method);
+}
+
+/* Without a callback, errors from asynchronous calls are only logged, in
+ * the same words as log(exc.toString()) */
+static void
+log_ignored_error(GError *error)
+{
+    GjsContext *gjs_context = gjs_context_get_current();
+    char *message = NULL;
+
+    if (gjs_context && !_gjs_context_destroying(gjs_context)) {
+        auto cx = static_cast<JSContext *>(gjs_context_get_native_context(gjs_context));
+        JSAutoRequest ar(cx);
+        JSAutoCompartment ac(cx, gjs_get_import_global(cx));
+
+        JS::RootedValue exc(cx);
+        JSObject *exc_obj = gjs_error_from_gerror(cx, error, false);
+        if (exc_obj) {
+            exc.setObject(*exc_obj);
+            JS::RootedString str(cx, JS::ToString(cx, exc));
+            if (!str || !gjs_string_to_utf8(cx, JS::StringValue(str), &message))
+                message = NULL;
+        }
+        JS_ClearPendingException(cx);
+    }
+
+    g_message("JS LOG: Ignored exception from dbus method: %s",
+              message ? message : error->message);
+    g_free(message);
+}
+
+static void
+proxy_call_done(GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+    GClosure *callback = (GClosure *) user_data;
+    GError *error = NULL;
+    GVariant *reply = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), result,
+                                               &error);
+
+    if (!callback) {
+        if (error)
+            log_ignored_error(error);
+    } else if (gjs_closure_is_valid(callback)) {
+        JSContext *cx = gjs_closure_get_context(callback);
+        JSAutoRequest ar(cx);
+        JSAutoCompartment ac(cx, gjs_closure_get_callable(callback));
+        JS::AutoValueArray<2> args(cx);
+        bool ok;
+
+        if (reply) {
+            ok = gjs_variant_unpack(cx, reply, true, args[0]);
+            args[1].setNull();
+        } else {
+            JSObject *empty = JS_NewArrayObject(cx, 0);
+            JSObject *exc = empty ? gjs_error_from_gerror(cx, error, true) : NULL;
+            ok = exc != NULL;
+            if (ok) {
+                args[0].setObject(*empty);
+                args[1].setObject(*exc);
+            }
+        }
+
+        if (ok) {
+            JS::RootedValue ignored(cx);
+            gjs_closure_invoke(callback, args, &ignored);
+        } else {
+            gjs_log_exception(cx);
+        }
+    }
+
+    if (callback) {
+        g_closure_invalidate(callback);
+        g_closure_unref(callback);
+    }
+    g_clear_error(&error);
+    if (reply)
+        g_variant_unref(reply);
+}
+
+/* Called as proxy.MethodRemote(args..., [callback], [flags], [cancellable])
+ * or proxy.MethodSync(args..., [flags], [cancellable]) */
+static bool
+proxy_method_call(JSContext *cx,
+                  unsigned   argc,
+                  JS::Value *vp)
+{
+    GJS_GET_THIS(cx, argc, vp, argv, this_obj);
+    JSObject *callee = &argv.callee();
+    JSObject *holder = &js::GetFunctionNativeReserved(callee, SLOT_METHOD).toObject();
+
+    auto method = static_cast<ProxyMethod *>(JS_GetPrivate(holder));
+    bool sync = js::GetFunctionNativeReserved(callee, SLOT_SYNC).toBoolean();
+    const char *name = method->info->name;
+
+    if (!gjs_typecheck_object(cx, this_obj, G_TYPE_DBUS_PROXY, true))
+        return false;
+    GDBusProxy *proxy = G_DBUS_PROXY(gjs_g_object_from_object(cx, this_obj));
+
+    if (argc < method->n_in_args) {
+        gjs_throw(cx, "Not enough arguments passed for method: %s. Expected %u, got %u",
+                  name, method->n_in_args, argc);
+        return false;
+    }
+    if (argc > method->n_in_args + 3) {
+        gjs_throw(cx, "Too many arguments passed for method: %s. Maximum is %u + one callback and/or flags",
+                  name, method->n_in_args + 3);
+        return false;
+    }
+
+    /* Scan from the end, so that the first of two callbacks wins as before */
+    JS::RootedObject callback(cx), cancellable_obj(cx);
+    GDBusCallFlags flags = G_DBUS_CALL_FLAGS_NONE;
+    for (unsigned i = argc; i-- > method->n_in_args; ) {
+        JS::HandleValue arg = argv[i];
+
+        if (!sync && arg.isObject() && JS::IsCallable(&arg.toObject())) {
+            callback = &arg.toObject();
+            continue;
+        }
+        if (arg.isNumber()) {
+            flags = (GDBusCallFlags) arg.toNumber();
+            continue;
+        }
+        if (arg.isObject()) {
+            JS::RootedObject obj(cx, &arg.toObject());
+            if (gjs_typecheck_object(cx, obj, G_TYPE_CANCELLABLE, false)) {
+                cancellable_obj = obj;
+                continue;
+            }
+        }
+
+        gjs_throw(cx, "Argument %u of method %s is %s. It should be a callback, flags or a Gio.Cancellable",
+                  i, name, JS_GetTypeName(cx, JS_TypeOfValue(cx, arg)));
+        return false;
+    }
+
+    GCancellable *cancellable = NULL;
+    if (cancellable_obj)
+        cancellable = G_CANCELLABLE(gjs_g_object_from_object(cx, cancellable_obj));
+
+    GVariant *parameters = gjs_variant_pack_args(cx, method->in_type, argv);
+    if (!parameters)
+        return false;
+
+    if (sync) {
+        GError *error = NULL;
+        GVariant *reply = g_dbus_proxy_call_sync(proxy, name, parameters,
+                                                 flags, -1, cancellable,
+                                                 &error);
+        if (!reply) {
+            gjs_throw_g_error(cx, error);
+            return false;
+        }
+
+        bool ok = gjs_variant_unpack(cx, reply, true, argv.rval());
+        g_variant_unref(reply);
+        return ok;
+    }
+
+    GClosure *closure = NULL;
+    if (callback) {
+        closure = gjs_closure_new(cx, callback, "D-Bus reply callback", true);
+        g_closure_ref(closure);
+        g_closure_sink(closure);
+    }
+
+    g_dbus_proxy_call(proxy, name, parameters, flags, -1, cancellable,
+                      proxy_call_done, closure);
+    argv.rval().setUndefined();
+    return true;
+}
+
+bool
+gjs_dbus_make_proxy_method_func(JSContext *cx,
+                                unsigned   argc,
+                                JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject info_obj(cx);
+    bool sync;
+
+    if (!gjs_parse_call_args(cx, "make_proxy_method", argv, "ob",
+                             "methodInfo", &info_obj,
+                             "sync", &sync))
+        return false;
+
+    if (!gjs_typecheck_boxed(cx, info_obj, NULL, G_TYPE_DBUS_METHOD_INFO, true))
+        return false;
+
+    auto info = static_cast<GDBusMethodInfo *>(gjs_c_struct_from_boxed(cx, info_obj));
+
+    JS::RootedObject holder(cx, JS_NewObject(cx, &gjs_dbus_proxy_method_class));
+    if (!holder)
+        return false;
+    ProxyMethod *method = proxy_method_lookup(info);
+    JS_SetPrivate(holder, method);
+
+    char *func_name = g_strconcat(info->name, sync ? "Sync" : "Remote", NULL);
+    JSFunction *func = js::NewFunctionWithReserved(cx, proxy_method_call,
+                                                   method->n_in_args, 0,
+                                                   NULL, func_name);
+    g_free(func_name);
+    if (!func)
+        return false;
+
+    JSObject *func_obj = JS_GetFunctionObject(func);
+    js::SetFunctionNativeReserved(func_obj, SLOT_METHOD, JS::ObjectValue(*holder));
+    js::SetFunctionNativeReserved(func_obj, SLOT_SYNC, JS::BooleanValue(sync));
+
+    argv.rval().setObject(*func_obj);
+    return true;
+}
+
+typedef struct {
+    GVariantType *out_type;
+    unsigned      n_out_args;
+    char         *async_name;
+} ServiceMethod;
+
+typedef struct {
+    JSContext          *cx;  /* NULL once the context is destroyed */
+    GjsContext         *gjs_context;
+    GHashTable         *methods;
+} ServiceDispatch;
+
+static void
+service_method_free(void *data)
+{
+    auto method = static_cast<ServiceMethod *>(data);
+    g_variant_type_free(method->out_type);
+    g_free(method->async_name);
+    g_slice_free(ServiceMethod, method);
+}
+
+static void
+service_context_destroyed(void    *data,
+                          GObject *where_the_object_was)
+{
+    auto dispatch = static_cast<ServiceDispatch *>(data);
+    dispatch->cx = NULL;
+    dispatch->gjs_context = NULL;
+}
+
+static void
+service_dispatch_free(void *data)
+{
+    auto dispatch = static_cast<ServiceDispatch *>(data);
+    if (dispatch->gjs_context)
+        g_object_weak_unref(G_OBJECT(dispatch->gjs_context),
+                            service_context_destroyed, dispatch);
+    g_hash_table_destroy(dispatch->methods);
+    g_slice_free(ServiceDispatch, dispatch);
+}
+
+static ServiceDispatch *
+service_dispatch_new(JSContext          *cx,
+                     GDBusInterfaceInfo *info)
+{
+    ServiceDispatch *dispatch = g_slice_new(ServiceDispatch);
+    dispatch->cx = cx;
+    dispatch->gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(cx));
+    g_object_weak_ref(G_OBJECT(dispatch->gjs_context),
+                      service_context_destroyed, dispatch);
+
+    dispatch->methods = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, service_method_free);
+
+    for (GDBusMethodInfo **m = info->methods; m && *m; m++) {
+        ServiceMethod *method = g_slice_new(ServiceMethod);
+        GString *signature = g_string_new("(");
+
+        method->n_out_args = 0;
+        if ((*m)->out_args) {
+            for (; (*m)->out_args[method->n_out_args]; method->n_out_args++)
+                g_string_append(signature,
+                                (*m)->out_args[method->n_out_args]->signature);
+        }
+        g_string_append_c(signature, ')');
+
+        method->out_type = g_variant_type_new(signature->str);
+        method->async_name = g_strconcat((*m)->name, "Async", NULL);
+        g_string_free(signature, true);
+
+        g_hash_table_insert(dispatch->methods, g_strdup((*m)->name), method);
+    }
+
+    return dispatch;
+}
+
+/* JS errors become D-Bus errors named org.gnome.gjs.JSError.<name>, unless
+ * their name already looks like a D-Bus error name */
+static void
+service_return_exception(JSContext             *cx,
+                         const char            *method_name,
+                         GDBusMethodInvocation *invocation)
+{
+    JS::RootedValue exc(cx);
+    if (!JS_GetPendingException(cx, &exc)) {
+        g_dbus_method_invocation_return_dbus_error(invocation,
+            "org.gnome.gjs.JSError.Error", "Method call failed");
+        return;
+    }
+    JS_ClearPendingException(cx);
+
+    if (exc.isObject()) {
+        JS::RootedObject exc_obj(cx, &exc.toObject());
+        if (gjs_typecheck_gerror(cx, exc_obj, false)) {
+            g_dbus_method_invocation_return_gerror(invocation,
+                                                   gjs_gerror_from_error(cx, exc_obj));
+            return;
+        }
+    }
+
+    char *log_message = g_strdup_printf("Exception in method call: %s",
+                                        method_name);
+    JS::RootedString log_str(cx, JS_NewStringCopyZ(cx, log_message));
+    g_free(log_message);
+    gjs_log_exception_full(cx, exc, log_str);
+
+    char *name = NULL, *message = NULL;
+    JS::RootedValue v(cx);
+    if (exc.isObject()) {
+        JS::RootedObject exc_obj(cx, &exc.toObject());
+        if (gjs_object_get_property(cx, exc_obj, GJS_STRING_NAME, &v) &&
+            v.isString())
+            gjs_string_to_utf8(cx, v, &name);
+        if (gjs_object_get_property(cx, exc_obj, GJS_STRING_MESSAGE, &v) &&
+            v.isString())
+            gjs_string_to_utf8(cx, v, &message);
+    }
+    JS_ClearPendingException(cx);
+
+    char *error_name;
+    if (!name)
+        error_name = g_strdup("org.gnome.gjs.JSError.Error");
+    else if (!strchr(name, '.'))
+        error_name = g_strconcat("org.gnome.gjs.JSError.", name, NULL);
+    else
+        error_name = g_strdup(name);
+
+    g_dbus_method_invocation_return_dbus_error(invocation, error_name,
+                                               message ? message : "");
+    g_free(error_name);
+    g_free(name);
+    g_free(message);
+}
+
+static void
+service_call_sync(JSContext             *cx,
+                  JS::HandleObject       obj,
+                  JS::HandleValue        func,
+                  ServiceMethod         *method,
+                  const char            *method_name,
+                  GVariant              *parameters,
+                  GDBusMethodInvocation *invocation)
+{
+    size_t n_args = g_variant_n_children(parameters);
+    JS::AutoValueVector args(cx);
+    JS::RootedValue arg(cx);
+
+    for (size_t i = 0; i < n_args; i++) {
+        GVariant *child = g_variant_get_child_value(parameters, i);
+        bool ok = gjs_variant_unpack(cx, child, true, &arg) && args.append(arg);
+        g_variant_unref(child);
+        if (!ok) {
+            service_return_exception(cx, method_name, invocation);
+            return;
+        }
+    }
+
+    JS::RootedValue retval(cx);
+    if (!gjs_call_function_value(cx, obj, func, args, &retval)) {
+        service_return_exception(cx, method_name, invocation);
+        return;
+    }
+
+    GVariant *reply = NULL;
+    if (retval.isUndefined()) {
+        /* no return value is the empty tuple */
+        reply = g_variant_new_tuple(NULL, 0);
+    } else if (retval.isObject()) {
+        JS::RootedObject retval_obj(cx, &retval.toObject());
+        if (gjs_typecheck_boxed(cx, retval_obj, NULL, G_TYPE_VARIANT, false))
+            reply = (GVariant *) gjs_c_struct_from_boxed(cx, retval_obj);
+    }
+
+    if (!reply) {
+        /* With one out argument, the handler doesn't have to wrap its return
+         * value in an array */
+        if (method->n_out_args == 1)
+            reply = gjs_variant_pack_args(cx, method->out_type,
+                                          JS::HandleValueArray(retval));
+        else
+            reply = gjs_variant_pack_type(cx, method->out_type, retval);
+    }
+
+    if (!reply) {
+        /* if we don't do this, the other side will never see a reply */
+        JS_ClearPendingException(cx);
+        g_dbus_method_invocation_return_dbus_error(invocation,
+            "org.gnome.gjs.JSError.ValueError",
+            "Service implementation returned an incorrect value type");
+        return;
+    }
+
+    g_dbus_method_invocation_return_value(invocation, reply);
+}
+
+static void
+service_method_call(GjsDBusImplementation *impl,
+                    const char            *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    void                  *user_data)
+{
+    auto dispatch = static_cast<ServiceDispatch *>(user_data);
+    JSContext *cx = dispatch->cx;
+    auto method = static_cast<ServiceMethod *>(g_hash_table_lookup(dispatch->methods,
+                                                                   method_name));
+
+    /* GDBus only lets through methods that are in the interface info */
+    g_assert(method);
+
+    if (!cx) {
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Method %s called after the JS context was destroyed",
+                                              method_name);
+        return;
+    }
+
+    JSAutoRequest ar(cx);
+    JSAutoCompartment ac(cx, gjs_get_import_global(cx));
+
+    JS::RootedObject impl_obj(cx, gjs_object_from_g_object(cx, G_OBJECT(impl)));
+    JS::RootedValue v_obj(cx), func(cx);
+    if (!impl_obj ||
+        !gjs_object_get_property(cx, impl_obj, GJS_STRING_DBUS_OBJECT, &v_obj) ||
+        !v_obj.isObject()) {
+        gjs_log_exception(cx);
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "No JS object is exported for method %s",
+                                              method_name);
+        return;
+    }
+
+    /* The methods are looked up on each call, so that they can be replaced
+     * after the object is exported */
+    JS::RootedObject obj(cx, &v_obj.toObject());
+    if (!JS_GetProperty(cx, obj, method_name, &func)) {
+        service_return_exception(cx, method_name, invocation);
+        return;
+    }
+
+    if (func.isObject() && JS::IsCallable(&func.toObject())) {
+        service_call_sync(cx, obj, func, method, method_name, parameters,
+                          invocation);
+        return;
+    }
+
+    if (!JS_GetProperty(cx, obj, method->async_name, &func)) {
+        service_return_exception(cx, method_name, invocation);
+        return;
+    }
+
+    if (func.isObject() && JS::IsCallable(&func.toObject())) {
+        JS::AutoValueArray<2> args(cx);
+        JS::RootedValue ignored(cx);
+        JSObject *invocation_obj;
+
+        if (!gjs_variant_unpack(cx, parameters, true, args[0]) ||
+            !(invocation_obj = gjs_object_from_g_object(cx, G_OBJECT(invocation)))) {
+            service_return_exception(cx, method_name, invocation);
+            return;
+        }
+        args[1].setObject(*invocation_obj);
+
+        /* The handler is responsible for replying, even if it throws */
+        if (!gjs_call_function_value(cx, obj, func, args, &ignored))
+            gjs_log_exception(cx);
+        return;
+    }
+
+    g_message("JS LOG: Missing handler for DBus method %s", method_name);
+    g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                                          G_DBUS_ERROR_UNKNOWN_METHOD,
+                                          "Method %s is not implemented",
+                                          method_name);
+}
+
+bool
+gjs_dbus_export_object_func(JSContext *cx,
+                            unsigned   argc,
+                            JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject impl_obj(cx), obj(cx);
+
+    if (!gjs_parse_call_args(cx, "export_dbus_object", argv, "oo",
+                             "impl", &impl_obj,
+                             "object", &obj))
+        return false;
+
+    if (!gjs_typecheck_object(cx, impl_obj, GJS_TYPE_DBUS_IMPLEMENTATION, true))
+        return false;
+
+    auto impl = GJS_DBUS_IMPLEMENTATION(gjs_g_object_from_object(cx, impl_obj));
+    GDBusInterfaceInfo *info =
+        g_dbus_interface_skeleton_get_info(G_DBUS_INTERFACE_SKELETON(impl));
+
+    /* The object is kept alive by the implementation's wrapper, rather than
+     * rooted, so that the two can be collected together */
+    if (!gjs_object_define_property(cx, impl_obj, GJS_STRING_DBUS_OBJECT, obj,
+                                    JSPROP_PERMANENT | JSPROP_READONLY))
+        return false;
+
+    gjs_dbus_implementation_set_method_handler(impl, service_method_call,
+                                               service_dispatch_new(cx, info),
+                                               service_dispatch_free);
+
+    argv.rval().setUndefined();
+    return true;
+}
@@ -0,0 +1,47 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef __GJS_DBUS_H__
+#define __GJS_DBUS_H__
+
+#include <stdbool.h>
+#include <glib.h>
+#include "cjs/jsapi-util.h"
+
+G_BEGIN_DECLS
+
+/* make_proxy_method(methodInfo, sync) in the private _gi module; returns a
+ * function to be installed on a Gio.DBusProxy as methodNameRemote() or
+ * methodNameSync() */
+bool gjs_dbus_make_proxy_method_func(JSContext *cx,
+                                     unsigned   argc,
+                                     JS::Value *vp);
+
+/* export_dbus_object(impl, object) in the private _gi module; makes the
+ * CjsPrivate.DBusImplementation @impl call the methods of @object directly
+ * for incoming method calls */
+bool gjs_dbus_export_object_func(JSContext *cx,
+                                 unsigned   argc,
+                                 JS::Value *vp);
+
+G_END_DECLS
+
+#endif  /* __GJS_DBUS_H__ */
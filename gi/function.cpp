@@ -33,16 +33,20 @@
 #include "closure.h"
 #include "gtype.h"
 #include "param.h"
+#include "gjs_gi_trace.h"
+#include "cjs/byteArray.h"
 #include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-private.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cjs/mem.h"
+#include "cjs/profiler-private.h"
 
 #include <util/log.h>
 
 #include <girepository.h>
 
+#include <chrono>
 #include <errno.h>
 #include <string.h>
 
@@ -51,6 +55,18 @@
  */
 #define GJS_ARG_INDEX_INVALID G_MAXUINT8
 
+/* Stack space shared by all string in-arguments of one C call. Strings
+ * passed with transfer none (set_text(), add_style_class_name(), ...) are
+ * encoded here instead of being g_malloc'd and then g_free'd right after the
+ * call; anything that doesn't fit falls back to the heap.
+ */
+#define GJS_ARG_STRING_SCRATCH_SIZE 1024
+
+typedef struct {
+    char  *data;
+    gsize  used;
+} GjsStringScratch;
+
 typedef struct {
     GIFunctionInfo *info;
 
@@ -59,8 +75,18 @@ typedef struct {
     guint8 expected_js_argc;
     guint8 js_out_argc;
     GIFunctionInvoker invoker;
+
+    /* Label for the profiler and call statistics, built on first use */
+    char *profile_label;
+    GjsFunctionStats *stats;
 } Function;
 
+/* Set around the C call when collecting statistics */
+typedef struct {
+    gint64 call_start;
+    gint64 call_end;
+} GjsCallTiming;
+
 extern struct JSClass gjs_function_class;
 
 /* Because we can't free the mmap'd data for a callback
@@ -69,6 +95,13 @@ extern struct JSClass gjs_function_class;
  */
 static GSList *completed_trampolines = NULL;  /* GjsCallbackTrampoline */
 
+/* Call statistics are kept per thread, keyed by the function's profile
+ * label, so that all the wrappers of one C function share a record that
+ * outlives them. Only the owning thread touches a table, so the counters
+ * need no locking. */
+static bool function_stats_enabled = false;
+static GPrivate thread_function_stats = G_PRIVATE_INIT((GDestroyNotify) g_hash_table_unref);
+
 GJS_DEFINE_PRIV_FROM_JS(Function, gjs_function_class)
 
 void
@@ -690,6 +723,254 @@ format_function_name(Function *function,
                            g_base_info_get_name(baseinfo));
 }
 
+/* Frame label for the profiler, e.g. "Gtk.Widget.show". Return value must
+ * be freed */
+static char *
+format_profile_label(Function *function,
+                     bool      is_method)
+{
+    auto baseinfo = static_cast<GIBaseInfo *>(function->info);
+    GIBaseInfo *container = g_base_info_get_container(baseinfo);
+    if (is_method || container)
+        return g_strdup_printf("%s.%s.%s",
+                               g_base_info_get_namespace(baseinfo),
+                               g_base_info_get_name(container),
+                               g_base_info_get_name(baseinfo));
+    return g_strdup_printf("%s.%s",
+                           g_base_info_get_namespace(baseinfo),
+                           g_base_info_get_name(baseinfo));
+}
+
+static gint64
+stats_now_ns(void)
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void
+free_function_stats(gpointer data)
+{
+    auto stats = static_cast<GjsFunctionStats *>(data);
+    g_free(stats->name);
+    g_slice_free(GjsFunctionStats, stats);
+}
+
+static GHashTable *
+get_thread_function_stats(void)
+{
+    auto table = static_cast<GHashTable *>(g_private_get(&thread_function_stats));
+
+    if (!table) {
+        table = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      NULL, free_function_stats);
+        g_private_set(&thread_function_stats, table);
+    }
+    return table;
+}
+
+static GjsFunctionStats *
+lookup_function_stats(Function *function)
+{
+    if (!function->profile_label)
+        function->profile_label =
+            format_profile_label(function, g_callable_info_is_method(function->info));
+
+    GHashTable *table = get_thread_function_stats();
+    auto stats = static_cast<GjsFunctionStats *>(g_hash_table_lookup(table,
+        function->profile_label));
+
+    if (!stats) {
+        stats = g_slice_new0(GjsFunctionStats);
+        stats->name = g_strdup(function->profile_label);
+        g_hash_table_insert(table, stats->name, stats);
+    }
+    return stats;
+}
+
+void
+gjs_function_stats_set_enabled(bool enabled)
+{
+    function_stats_enabled = enabled;
+}
+
+bool
+gjs_function_stats_get_enabled(void)
+{
+    return function_stats_enabled;
+}
+
+static gint
+compare_stats_by_total_time(gconstpointer a,
+                            gconstpointer b)
+{
+    auto stats_a = *static_cast<const GjsFunctionStats * const *>(a);
+    auto stats_b = *static_cast<const GjsFunctionStats * const *>(b);
+    guint64 total_a = stats_a->call_ns + stats_a->marshal_ns;
+    guint64 total_b = stats_b->call_ns + stats_b->marshal_ns;
+
+    if (total_a != total_b)
+        return total_a > total_b ? -1 : 1;
+    return g_strcmp0(stats_a->name, stats_b->name);
+}
+
+/* Returns at most @max_entries of this thread's statistics, hottest first.
+ * The elements belong to the statistics table; free the array with
+ * g_ptr_array_unref(). */
+GPtrArray *
+gjs_function_stats_get_top(unsigned max_entries)
+{
+    GHashTable *table = get_thread_function_stats();
+    GPtrArray *top = g_ptr_array_sized_new(g_hash_table_size(table));
+    GHashTableIter iter;
+    gpointer stats;
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, NULL, &stats))
+        g_ptr_array_add(top, stats);
+
+    g_ptr_array_sort(top, compare_stats_by_total_time);
+    if (top->len > max_entries)
+        g_ptr_array_set_size(top, max_entries);
+    return top;
+}
+
+/* Formats a table of the @max_entries hottest functions. Return value must
+ * be freed */
+char *
+gjs_function_stats_format(unsigned max_entries)
+{
+    GPtrArray *top = gjs_function_stats_get_top(max_entries);
+    GString *out = g_string_new(NULL);
+
+    g_string_append_printf(out, "%-48s %10s %12s %12s %10s %9s\n",
+                           "Function", "Calls", "Call (ms)", "Marshal (ms)",
+                           "Exceptions", "Marshal %");
+
+    for (unsigned i = 0; i < top->len; i++) {
+        auto stats = static_cast<GjsFunctionStats *>(g_ptr_array_index(top, i));
+        guint64 total = stats->call_ns + stats->marshal_ns;
+
+        g_string_append_printf(out, "%-48s %10" G_GUINT64_FORMAT " %12.3f %12.3f %10"
+                               G_GUINT64_FORMAT " %8.1f%%\n",
+                               stats->name, stats->calls,
+                               stats->call_ns / 1e6, stats->marshal_ns / 1e6,
+                               stats->exceptions,
+                               total ? 100.0 * stats->marshal_ns / total : 0.0);
+    }
+
+    g_ptr_array_unref(top);
+    return g_string_free(out, false);
+}
+
+static bool
+scratch_owns_string_arg(const GjsStringScratch *scratch,
+                        GITypeInfo             *type_info,
+                        GArgument              *arg)
+{
+    GITypeTag type_tag = g_type_info_get_tag(type_info);
+    const char *str = (const char *) arg->v_pointer;
+
+    if (type_tag != GI_TYPE_TAG_UTF8 && type_tag != GI_TYPE_TAG_FILENAME)
+        return false;
+
+    return str >= scratch->data &&
+        str < scratch->data + GJS_ARG_STRING_SCRATCH_SIZE;
+}
+
+/* Tries to convert a transfer-none utf8 or filename in-argument into the
+ * per-call scratch buffer. Returns false if the argument doesn't qualify or
+ * doesn't fit, in which case the caller should convert it normally.
+ */
+static bool
+string_in_arg_to_scratch(JSContext        *context,
+                         JS::HandleValue   value,
+                         GIArgInfo        *arg_info,
+                         GITypeInfo       *type_info,
+                         GjsStringScratch *scratch,
+                         GArgument        *arg)
+{
+    GITypeTag type_tag;
+    size_t len;
+
+    if (!value.isString() ||
+        g_arg_info_get_direction(arg_info) != GI_DIRECTION_IN ||
+        g_arg_info_get_ownership_transfer(arg_info) != GI_TRANSFER_NOTHING)
+        return false;
+
+    type_tag = g_type_info_get_tag(type_info);
+    if (type_tag == GI_TYPE_TAG_FILENAME) {
+        /* Only an identity conversion can skip g_filename_from_utf8() */
+        if (!g_get_filename_charsets(NULL))
+            return false;
+    } else if (type_tag != GI_TYPE_TAG_UTF8) {
+        return false;
+    }
+
+    if (!gjs_string_to_utf8_in_buffer(context, value,
+                                      scratch->data + scratch->used,
+                                      GJS_ARG_STRING_SCRATCH_SIZE - scratch->used,
+                                      &len))
+        return false;
+
+    arg->v_pointer = scratch->data + scratch->used;
+    scratch->used += len + 1;
+    return true;
+}
+
+/* Passes a ByteArray given for a transfer-none byte array in-argument as a
+ * pointer to its own data instead of a copy. The ByteArray is appended to
+ * @borrowed and can't be resized until it is given back after the call.
+ * Returns false if the argument doesn't qualify, e.g. because the ByteArray
+ * is backed by a read-only GBytes, in which case the caller should convert
+ * it normally.
+ */
+static bool
+byte_array_in_arg_borrow(JSContext           *context,
+                         JS::HandleValue      value,
+                         GIArgInfo           *arg_info,
+                         GITypeInfo          *type_info,
+                         GArgument           *arg,
+                         gsize               *length,
+                         JS::AutoObjectVector& borrowed)
+{
+    if (!value.isObject() ||
+        g_arg_info_get_direction(arg_info) != GI_DIRECTION_IN ||
+        g_arg_info_get_ownership_transfer(arg_info) != GI_TRANSFER_NOTHING ||
+        g_type_info_get_array_type(type_info) != GI_ARRAY_TYPE_C ||
+        g_type_info_is_zero_terminated(type_info))
+        return false;
+
+    GITypeInfo *param_info = g_type_info_get_param_type(type_info, 0);
+    GITypeTag element_type = g_type_info_get_tag(param_info);
+    g_base_info_unref(param_info);
+    if (element_type != GI_TYPE_TAG_UINT8 && element_type != GI_TYPE_TAG_INT8)
+        return false;
+
+    JS::RootedObject obj(context, &value.toObject());
+    if (!gjs_typecheck_bytearray(context, obj, false))
+        return false;
+
+    if (!borrowed.reserve(borrowed.length() + 1))
+        return false;
+
+    guint8 *data;
+    if (!gjs_byte_array_borrow_data(context, obj, &data, length))
+        return false;
+
+    borrowed.infallibleAppend(obj);
+    arg->v_pointer = data;
+    return true;
+}
+
+static bool
+arg_is_borrowed(guint64 borrowed_args,
+                guint8  gi_arg_pos)
+{
+    return gi_arg_pos < 64 &&
+        (borrowed_args & (G_GUINT64_CONSTANT(1) << gi_arg_pos)) != 0;
+}
+
 /*
  * This function can be called in 2 different ways. You can either use
  * it to create javascript objects by providing a @js_rval argument or
@@ -697,12 +978,13 @@ format_function_name(Function *function,
  * providing a @r_value argument.
  */
 static bool
-gjs_invoke_c_function(JSContext                             *context,
-                      Function                              *function,
-                      JS::HandleObject                       obj, /* "this" object */
-                      const JS::HandleValueArray&            args,
-                      mozilla::Maybe<JS::MutableHandleValue> js_rval,
-                      GIArgument                            *r_value)
+invoke_c_function(JSContext                             *context,
+                  Function                              *function,
+                  JS::HandleObject                       obj, /* "this" object */
+                  const JS::HandleValueArray&            args,
+                  mozilla::Maybe<JS::MutableHandleValue> js_rval,
+                  GIArgument                            *r_value,
+                  GjsCallTiming                         *timing)
 {
     /* These first four are arrays which hold argument pointers.
      * @in_arg_cvalues: C values which are passed on input (in or inout)
@@ -722,6 +1004,9 @@ gjs_invoke_c_function(JSContext                             *context,
     GIFFIReturnValue return_value;
     gpointer return_value_p; /* Will point inside the union return_value */
     GArgument return_gargument;
+    char string_scratch_data[GJS_ARG_STRING_SCRATCH_SIZE];
+    GjsStringScratch string_scratch = { string_scratch_data, 0 };
+    guint64 borrowed_args = 0;  /* bit per gi_arg_pos, need no release */
 
     guint8 processed_c_args = 0;
     guint8 gi_argc, gi_arg_pos;
@@ -736,8 +1021,10 @@ gjs_invoke_c_function(JSContext                             *context,
     GITypeInfo return_info;
     GITypeTag return_tag;
     JS::AutoValueVector return_values(context);
+    JS::AutoObjectVector borrowed_arrays(context);
     guint8 next_rval = 0; /* index into return_values */
     GSList *iter;
+    GjsProfiler *profiler;
 
     /* Because we can't free a closure while we're in it, we defer
      * freeing until the next time a C function is invoked.  What
@@ -928,8 +1215,14 @@ gjs_invoke_c_function(JSContext                             *context,
                 gint array_length_pos = g_type_info_get_array_length(&ainfo);
                 gsize length;
 
-                if (!gjs_value_to_explicit_array(context, args[js_arg_pos],
-                                                 &arg_info, in_value, &length)) {
+                if (gi_arg_pos < 64 &&
+                    byte_array_in_arg_borrow(context, args[js_arg_pos],
+                                             &arg_info, &ainfo, in_value,
+                                             &length, borrowed_arrays)) {
+                    borrowed_args |= G_GUINT64_CONSTANT(1) << gi_arg_pos;
+                } else if (!gjs_value_to_explicit_array(context, args[js_arg_pos],
+                                                        &arg_info, in_value,
+                                                        &length)) {
                     failed = true;
                     break;
                 }
@@ -963,6 +1256,11 @@ gjs_invoke_c_function(JSContext                             *context,
             case PARAM_NORMAL: {
                 /* Ok, now just convert argument normally */
                 g_assert_cmpuint(js_arg_pos, <, args.length());
+                if (string_in_arg_to_scratch(context, args[js_arg_pos],
+                                             &arg_info, &ainfo,
+                                             &string_scratch, in_value))
+                    break;
+
                 if (!gjs_value_to_arg(context, args[js_arg_pos], &arg_info,
                                       in_value))
                     failed = true;
@@ -1023,8 +1321,25 @@ gjs_invoke_c_function(JSContext                             *context,
         return_value_p = &return_value.v_uint64;
     else
         return_value_p = &return_value.v_long;
+
+    profiler = _gjs_profiler_get_sampling(context);
+    if (G_UNLIKELY(profiler)) {
+        if (!function->profile_label)
+            function->profile_label = format_profile_label(function, is_method);
+        _gjs_profiler_push_native_frame(profiler, function->profile_label);
+    }
+
+    if (timing)
+        timing->call_start = stats_now_ns();
+
     ffi_call(&(function->invoker.cif), FFI_FN(function->invoker.native_address), return_value_p, ffi_arg_pointers);
 
+    if (timing)
+        timing->call_end = stats_now_ns();
+
+    if (G_UNLIKELY(profiler))
+        _gjs_profiler_pop_native_frame(profiler);
+
     /* Return value and out arguments are valid only if invocation doesn't
      * return error. In arguments need to be released always.
      */
@@ -1069,7 +1384,8 @@ gjs_invoke_c_function(JSContext                             *context,
                                                                 return_values[next_rval],
                                                                 &return_info,
                                                                 &return_gargument,
-                                                                length.toInt32());
+                                                                length.toInt32(),
+                                                                transfer);
                 }
                 if (!arg_failed &&
                     !r_value &&
@@ -1102,6 +1418,9 @@ gjs_invoke_c_function(JSContext                             *context,
     }
 
 release:
+    for (size_t ix = 0; ix < borrowed_arrays.length(); ix++)
+        gjs_byte_array_return_data(context, borrowed_arrays[ix]);
+
     /* We walk over all args, release in args (if allocated) and convert
      * all out args to JS
      */
@@ -1144,7 +1463,8 @@ release:
                     gjs_callback_trampoline_unref(trampoline);
                     arg->v_pointer = NULL;
                 }
-            } else if (param_type == PARAM_ARRAY) {
+            } else if (param_type == PARAM_ARRAY &&
+                       !arg_is_borrowed(borrowed_args, gi_arg_pos)) {
                 gsize length;
                 GIArgInfo array_length_arg;
                 GITypeInfo array_length_type;
@@ -1168,7 +1488,10 @@ release:
                     postinvoke_release_failed = true;
                 }
             } else if (param_type == PARAM_NORMAL) {
-                if (!gjs_g_argument_release_in_arg(context,
+                /* Strings converted into the scratch buffer need no release */
+                if (!(direction == GI_DIRECTION_IN &&
+                      scratch_owns_string_arg(&string_scratch, &arg_type_info, arg)) &&
+                    !gjs_g_argument_release_in_arg(context,
                                                    transfer,
                                                    &arg_type_info,
                                                    arg)) {
@@ -1214,7 +1537,8 @@ release:
                                                                     return_values[next_rval],
                                                                     &arg_type_info,
                                                                     arg,
-                                                                    array_length.toInt32());
+                                                                    array_length.toInt32(),
+                                                                    g_arg_info_get_ownership_transfer(&arg_info));
                     }
                 } else {
                     arg_failed = !gjs_value_from_g_argument(context,
@@ -1320,6 +1644,60 @@ release:
     }
 }
 
+/* When statistics are enabled, counts the call, and splits its duration
+ * into time spent in the C function and time spent marshalling arguments
+ * around it. The C time includes any JS callbacks it runs. Also fires the
+ * function__call probes if anything is attached to them. */
+static bool
+gjs_invoke_c_function(JSContext                             *context,
+                      Function                              *function,
+                      JS::HandleObject                       obj, /* "this" object */
+                      const JS::HandleValueArray&            args,
+                      mozilla::Maybe<JS::MutableHandleValue> js_rval,
+                      GIArgument                            *r_value)
+{
+    bool traced = TRACE_ENABLED(GJS_FUNCTION_CALL_ENTRY) ||
+        TRACE_ENABLED(GJS_FUNCTION_CALL_RETURN);
+
+    if (G_LIKELY(!function_stats_enabled && !traced))
+        return invoke_c_function(context, function, obj, args, js_rval,
+                                 r_value, NULL);
+
+    TRACE(GJS_FUNCTION_CALL_ENTRY((char *) g_base_info_get_namespace(function->info),
+                                  (char *) g_base_info_get_name(function->info)));
+
+    if (!function_stats_enabled) {
+        bool retval = invoke_c_function(context, function, obj, args, js_rval,
+                                        r_value, NULL);
+        TRACE(GJS_FUNCTION_CALL_RETURN((char *) g_base_info_get_namespace(function->info),
+                                       (char *) g_base_info_get_name(function->info),
+                                       retval));
+        return retval;
+    }
+
+    if (!function->stats)
+        function->stats = lookup_function_stats(function);
+
+    GjsCallTiming timing = { 0, 0 };
+    gint64 start = stats_now_ns();
+    bool retval = invoke_c_function(context, function, obj, args, js_rval,
+                                    r_value, &timing);
+    gint64 elapsed = stats_now_ns() - start;
+    gint64 in_call = timing.call_end - timing.call_start;
+
+    GjsFunctionStats *stats = function->stats;
+    stats->calls++;
+    stats->call_ns += in_call;
+    stats->marshal_ns += elapsed - in_call;
+    if (!retval)
+        stats->exceptions++;
+
+    TRACE(GJS_FUNCTION_CALL_RETURN((char *) g_base_info_get_namespace(function->info),
+                                   (char *) g_base_info_get_name(function->info),
+                                   retval));
+    return retval;
+}
+
 static bool
 function_call(JSContext *context,
               unsigned   js_argc,
@@ -1361,6 +1739,7 @@ uninit_cached_function_data (Function *function)
         g_base_info_unref( (GIBaseInfo*) function->info);
     if (function->param_types)
         g_free(function->param_types);
+    g_free(function->profile_label);
 
     g_function_invoker_destroy(&function->invoker);
 }
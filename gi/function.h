@@ -82,6 +82,20 @@ bool gjs_invoke_constructor_from_c(JSContext                  *context,
                                    const JS::HandleValueArray& args,
                                    GIArgument                 *rvalue);
 
+typedef struct {
+    char    *name;
+    guint64  calls;
+    guint64  call_ns;
+    guint64  marshal_ns;
+    guint64  exceptions;
+} GjsFunctionStats;
+
+void gjs_function_stats_set_enabled(bool enabled);
+bool gjs_function_stats_get_enabled(void);
+
+GPtrArray *gjs_function_stats_get_top(unsigned max_entries);
+char *gjs_function_stats_format(unsigned max_entries);
+
 G_END_DECLS
 
 #endif  /* __GJS_FUNCTION_H__ */
@@ -31,13 +31,14 @@
 #include "boxed.h"
 #include "function.h"
 #include "gtype.h"
+#include "gjs_gi_trace.h"
 #include "proxyutils.h"
 #include "repo.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cjs/mem.h"
 
-#include <cjs/context.h>
 #include <util/log.h>
 #include <girepository.h>
 
@@ -59,6 +60,7 @@ struct Fundamental {
 
     JS::Heap<jsid>                constructor_name;
     GICallableInfo               *constructor_info;
+    GjsTypeCounter               *type_counter;
 };
 
 /*
@@ -73,38 +75,10 @@ extern struct JSClass gjs_fundamental_instance_class;
 
 GJS_DEFINE_PRIV_FROM_JS(FundamentalInstance, gjs_fundamental_instance_class)
 
-static GQuark
-gjs_fundamental_table_quark (void)
-{
-    static GQuark val = 0;
-    if (!val)
-        val = g_quark_from_static_string("gjs::fundamental-table");
-
-    return val;
-}
-
-static GHashTable *
-_ensure_mapping_table(GjsContext *context)
-{
-    GHashTable *table =
-        (GHashTable *) g_object_get_qdata ((GObject *) context,
-                                           gjs_fundamental_table_quark());
-
-    if (G_UNLIKELY(table == NULL)) {
-        table = g_hash_table_new(NULL, NULL);
-        g_object_set_qdata_full((GObject *) context,
-                                gjs_fundamental_table_quark(),
-                                table,
-                                (GDestroyNotify) g_hash_table_unref);
-    }
-
-    return table;
-}
-
 static void
 _fundamental_add_object(void *native_object, JSObject *js_object)
 {
-    GHashTable *table = _ensure_mapping_table(gjs_context_get_current());
+    GHashTable *table = _gjs_context_get_fundamental_table(gjs_context_get_current());
 
     g_hash_table_insert(table, native_object, js_object);
 }
@@ -112,7 +86,7 @@ _fundamental_add_object(void *native_object, JSObject *js_object)
 static void
 _fundamental_remove_object(void *native_object)
 {
-    GHashTable *table = _ensure_mapping_table(gjs_context_get_current());
+    GHashTable *table = _gjs_context_get_fundamental_table(gjs_context_get_current());
 
     g_hash_table_remove(table, native_object);
 }
@@ -120,7 +94,7 @@ _fundamental_remove_object(void *native_object)
 static JSObject *
 _fundamental_lookup_object(void *native_object)
 {
-    GHashTable *table = _ensure_mapping_table(gjs_context_get_current());
+    GHashTable *table = _gjs_context_get_fundamental_table(gjs_context_get_current());
 
     return (JSObject *) g_hash_table_lookup(table, native_object);
 }
@@ -172,6 +146,10 @@ init_fundamental_instance(JSContext       *context,
     g_assert(proto_priv != NULL);
 
     priv->prototype = proto_priv;
+    gjs_type_counter_inc(proto_priv->type_counter);
+
+    TRACE(GJS_FUNDAMENTAL_PROXY_NEW(priv, (char *) g_base_info_get_namespace((GIBaseInfo*) proto_priv->info),
+                                    (char *) g_base_info_get_name((GIBaseInfo*) proto_priv->info)));
 
     JS_EndRequest(context);
 
@@ -477,12 +455,17 @@ fundamental_finalize(JSFreeOp  *fop,
         return; /* wrong class? */
 
     if (!fundamental_is_prototype(priv)) {
+        TRACE(GJS_FUNDAMENTAL_PROXY_FINALIZE(priv,
+                                             (char *) g_base_info_get_namespace((GIBaseInfo*) priv->prototype->info),
+                                             (char *) g_base_info_get_name((GIBaseInfo*) priv->prototype->info)));
+
         if (priv->gfundamental) {
             _fundamental_remove_object(priv->gfundamental);
             priv->prototype->unref_function(priv->gfundamental);
             priv->gfundamental = NULL;
         }
 
+        gjs_type_counter_dec(priv->prototype->type_counter);
         g_slice_free(FundamentalInstance, priv);
         GJS_DEC_COUNTER(fundamental);
     } else {
@@ -727,6 +710,7 @@ gjs_define_fundamental_class(JSContext              *context,
     g_assert(priv->set_value_function != NULL);
     priv->get_value_function = g_object_info_get_get_value_function_pointer(info);
     g_assert(priv->get_value_function != NULL);
+    priv->type_counter = gjs_type_counter_get_for_gtype(GJS_TYPE_COUNTER_FUNDAMENTAL, gtype);
     JS_SetPrivate(prototype, priv);
 
     gjs_debug(GJS_DEBUG_GFUNDAMENTAL,
@@ -27,6 +27,7 @@
 
 #include "boxed.h"
 #include "enumeration.h"
+#include "cjs/context-private.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cjs/mem.h"
@@ -43,9 +44,14 @@ typedef struct {
     GError *gerror; /* NULL if we are the prototype and not an instance */
 } Error;
 
+/* Reserved slots of instances */
+enum {
+    SLOT_STACK,  /* SavedFrame captured when the error was created */
+};
+
 extern struct JSClass gjs_error_class;
 
-static void define_error_properties(JSContext *, JS::HandleObject);
+static void capture_error_stack(JSContext *, JS::HandleObject);
 
 GJS_DEFINE_PRIV_FROM_JS(Error, gjs_error_class)
 
@@ -112,7 +118,7 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(error)
     JS_free(context, message);
 
     /* We assume this error will be thrown in the same line as the constructor */
-    define_error_properties(context, object);
+    capture_error_stack(context, object);
 
     GJS_NATIVE_CONSTRUCTOR_FINISH(boxed);
 
@@ -195,6 +201,110 @@ error_get_code(JSContext *context,
     return true;
 }
 
+/* The stack is only turned into the fileName, lineNumber and stack
+ * properties that JS Error() exposes when one of them is first used. Errors
+ * that are caught and examined by domain and code never pay for it. */
+static bool
+define_error_properties(JSContext       *context,
+                        JS::HandleObject obj)
+{
+    JS::Value slot = JS_GetReservedSlot(obj, SLOT_STACK);
+    if (slot.isUndefined())
+        return true;  /* no stack was captured, or already defined */
+
+    JS::RootedObject frame(context, slot.toObjectOrNull());
+    JS::RootedValue stack(context, JS_GetEmptyStringValue(context)),
+        fileName(context, JS_GetEmptyStringValue(context)),
+        lineNumber(context, JS::Int32Value(0));
+
+    if (frame) {
+        JS::RootedValue frame_val(context, JS::ObjectValue(*frame));
+        JS::RootedString stack_str(context, JS::ToString(context, frame_val));
+        if (!stack_str ||
+            !JS_GetProperty(context, frame, "source", &fileName) ||
+            !JS_GetProperty(context, frame, "line", &lineNumber))
+            return false;
+        stack.setString(stack_str);
+    }
+
+    JS_SetReservedSlot(obj, SLOT_STACK, JS::UndefinedValue());
+
+    return gjs_object_define_property(context, obj, GJS_STRING_STACK, stack,
+                                      JSPROP_ENUMERATE) &&
+        gjs_object_define_property(context, obj, GJS_STRING_FILENAME,
+                                   fileName, JSPROP_ENUMERATE) &&
+        gjs_object_define_property(context, obj, GJS_STRING_LINE_NUMBER,
+                                   lineNumber, JSPROP_ENUMERATE);
+}
+
+static bool
+error_get_frame_info(JSContext     *context,
+                     unsigned       argc,
+                     JS::Value     *vp,
+                     GjsConstString name)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Error, priv);
+
+    if (priv == NULL)
+        return false;
+
+    /* Not thrown, e.g. passed to a callback, or the prototype */
+    if (JS_GetReservedSlot(obj, SLOT_STACK).isUndefined()) {
+        args.rval().setUndefined();
+        return true;
+    }
+
+    return define_error_properties(context, obj) &&
+        gjs_object_get_property(context, obj, name, args.rval());
+}
+
+static bool
+error_set_frame_info(JSContext     *context,
+                     unsigned       argc,
+                     JS::Value     *vp,
+                     GjsConstString name)
+{
+    GJS_GET_PRIV(context, argc, vp, args, obj, Error, priv);
+
+    if (priv == NULL)
+        return false;
+
+    if (priv->gerror == NULL) {
+        gjs_throw(context, "Can't set a field on a GError prototype");
+        return false;
+    }
+
+    args.rval().setUndefined();
+    return define_error_properties(context, obj) &&
+        gjs_object_define_property(context, obj, name, args[0],
+                                   JSPROP_ENUMERATE);
+}
+
+#define GJS_DEFINE_FRAME_INFO_ACCESSORS(cname, const_string)   \
+static bool                                                    \
+error_get_##cname(JSContext *context,                          \
+                  unsigned   argc,                             \
+                  JS::Value *vp)                               \
+{                                                              \
+    return error_get_frame_info(context, argc, vp,             \
+                                const_string);                 \
+}                                                              \
+                                                               \
+static bool                                                    \
+error_set_##cname(JSContext *context,                          \
+                  unsigned   argc,                             \
+                  JS::Value *vp)                               \
+{                                                              \
+    return error_set_frame_info(context, argc, vp,             \
+                                const_string);                 \
+}
+
+GJS_DEFINE_FRAME_INFO_ACCESSORS(stack, GJS_STRING_STACK)
+GJS_DEFINE_FRAME_INFO_ACCESSORS(file_name, GJS_STRING_FILENAME)
+GJS_DEFINE_FRAME_INFO_ACCESSORS(line_number, GJS_STRING_LINE_NUMBER)
+
+#undef GJS_DEFINE_FRAME_INFO_ACCESSORS
+
 static bool
 error_to_string(JSContext *context,
                 unsigned   argc,
@@ -272,6 +382,7 @@ error_constructor_value_of(JSContext *context,
 struct JSClass gjs_error_class = {
     "GLib_Error",
     JSCLASS_HAS_PRIVATE |
+    JSCLASS_HAS_RESERVED_SLOTS(1) |
     JSCLASS_BACKGROUND_FINALIZE |
     JSCLASS_IMPLEMENTS_BARRIERS,
     NULL,  /* addProperty */
@@ -290,6 +401,11 @@ JSPropertySpec gjs_error_proto_props[] = {
     JS_PSG("domain", error_get_domain, GJS_MODULE_PROP_FLAGS),
     JS_PSG("code", error_get_code, GJS_MODULE_PROP_FLAGS),
     JS_PSG("message", error_get_message, GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("stack", error_get_stack, error_set_stack, GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("fileName", error_get_file_name, error_set_file_name,
+            GJS_MODULE_PROP_FLAGS),
+    JS_PSGS("lineNumber", error_get_line_number, error_set_line_number,
+            GJS_MODULE_PROP_FLAGS),
     JS_PS_END
 };
 
@@ -303,6 +419,17 @@ static JSFunctionSpec gjs_error_constructor_funcs[] = {
     JS_FS_END
 };
 
+/* Remembers the prototype of each error domain, so that wrapping a GError
+ * does not have to look its domain up in the repository and the importer */
+static void
+remember_error_proto(JSContext       *cx,
+                     GQuark           domain,
+                     JS::HandleObject proto)
+{
+    auto gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(cx));
+    _gjs_context_remember_error_proto(gjs_context, domain, proto);
+}
+
 void
 gjs_define_error_class(JSContext       *context,
                        JS::HandleObject in_object,
@@ -353,6 +480,7 @@ gjs_define_error_class(JSContext       *context,
     priv->domain = g_quark_from_string (g_enum_info_get_error_domain(priv->info));
 
     JS_SetPrivate(prototype, priv);
+    remember_error_proto(context, priv->domain, prototype);
 
     gjs_debug(GJS_DEBUG_GBOXED, "Defined class %s prototype is %p class %p in object %p",
               constructor_name, prototype.get(), JS_GetClass(prototype),
@@ -388,29 +516,43 @@ find_error_domain_info(GQuark domain)
     return info;
 }
 
-/* define properties that JS Error() expose, such as
-   fileName, lineNumber and stack
-*/
+/* The stack is captured as a chain of SavedFrame objects, which is much
+ * cheaper than creating a JS Error and formatting its stack right away */
 static void
-define_error_properties(JSContext       *context,
-                        JS::HandleObject obj)
+capture_error_stack(JSContext       *context,
+                    JS::HandleObject obj)
 {
-    JS::RootedValue stack(context), fileName(context), lineNumber(context);
+    JS::RootedObject frame(context);
 
-    if (!gjs_context_get_frame_info(context,
-                                    mozilla::Some<JS::MutableHandleValue>(&stack),
-                                    mozilla::Some<JS::MutableHandleValue>(&fileName),
-                                    mozilla::Some<JS::MutableHandleValue>(&lineNumber)))
+    if (!JS::CaptureCurrentStack(context, &frame)) {
+        JS_ClearPendingException(context);
         return;
+    }
 
-    gjs_object_define_property(context, obj, GJS_STRING_STACK, stack,
-                               JSPROP_ENUMERATE);
+    JS_SetReservedSlot(obj, SLOT_STACK, JS::ObjectOrNullValue(frame));
+}
 
-    gjs_object_define_property(context, obj, GJS_STRING_FILENAME,
-                               fileName, JSPROP_ENUMERATE);
+/* Sets proto to NULL if the domain has no introspection metadata */
+static bool
+lookup_error_prototype(JSContext              *context,
+                       GQuark                  domain,
+                       JS::MutableHandleObject proto)
+{
+    auto gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    proto.set(_gjs_context_lookup_error_proto(gjs_context, domain));
+    if (proto)
+        return true;
+
+    GIEnumInfo *info = find_error_domain_info(domain);
+    if (!info) {
+        proto.set(NULL);
+        return true;
+    }
 
-    gjs_object_define_property(context, obj, GJS_STRING_LINE_NUMBER,
-                               lineNumber, JSPROP_ENUMERATE);
+    /* Defines the class on first use, which remembers the prototype */
+    proto.set(gjs_lookup_generic_prototype(context, info));
+    g_base_info_unref(info);
+    return proto != NULL;
 }
 
 JSObject*
@@ -420,14 +562,15 @@ gjs_error_from_gerror(JSContext             *context,
 {
     Error *priv;
     Error *proto_priv;
-    GIEnumInfo *info;
 
     if (gerror == NULL)
         return NULL;
 
-    info = find_error_domain_info(gerror->domain);
+    JS::RootedObject proto(context);
+    if (!lookup_error_prototype(context, gerror->domain, &proto))
+        return NULL;
 
-    if (!info) {
+    if (!proto) {
         /* We don't have error domain metadata */
         /* Marshal the error as a plain GError */
         GIBaseInfo *glib_boxed;
@@ -440,12 +583,11 @@ gjs_error_from_gerror(JSContext             *context,
         return retval;
     }
 
+    proto_priv = priv_from_js(context, proto);
+
     gjs_debug_marshal(GJS_DEBUG_GBOXED,
                       "Wrapping struct %s with JSObject",
-                      g_base_info_get_name((GIBaseInfo *)info));
-
-    JS::RootedObject proto(context, gjs_lookup_generic_prototype(context, info));
-    proto_priv = priv_from_js(context, proto);
+                      g_base_info_get_name((GIBaseInfo *)proto_priv->info));
 
     JS::RootedObject obj(context,
         JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto));
@@ -453,13 +595,13 @@ gjs_error_from_gerror(JSContext             *context,
     GJS_INC_COUNTER(gerror);
     priv = g_slice_new0(Error);
     JS_SetPrivate(obj, priv);
-    priv->info = info;
+    priv->info = proto_priv->info;
     priv->domain = proto_priv->domain;
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gerror = g_error_copy(gerror);
 
     if (add_stack)
-        define_error_properties(context, obj);
+        capture_error_stack(context, obj);
 
     return obj;
 }
@@ -36,11 +36,15 @@
 /* include the generated probes header and put markers in code */
 #include "gjs_gi_probes.h"
 #define TRACE(probe) probe
+#define TRACE_ENABLED(probe) probe##_ENABLED()
 
 #else
 
-/* Wrap the probe to allow it to be removed when no systemtap available */
+/* Wrap the probe to allow it to be removed when no systemtap available.
+ * Use TRACE_ENABLED() to skip computing arguments when nothing is
+ * attached to a probe. */
 #define TRACE(probe)
+#define TRACE_ENABLED(probe) (0)
 
 #endif
 
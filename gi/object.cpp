@@ -43,13 +43,16 @@
 #include "param.h"
 #include "toggle.h"
 #include "value.h"
+#include "variant.h"
 #include "closure.h"
+#include "dbus.h"
 #include "gjs_gi_trace.h"
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cjs/context-private.h"
 #include "cjs/mem.h"
+#include "cjs/runtime.h"
 
 #include <util/log.h>
 #include <util/hash-x32.h>
@@ -71,6 +74,11 @@ struct ObjectInstance {
     /* A list of all vfunc trampolines, used when tracing */
     std::deque<GjsCallbackTrampoline *> vfuncs;
 
+    /* for prototypes, the counter that instances are counted in; for
+     * instances, the counter to decrement when finalized */
+    GjsTypeCounter *type_counter;
+    GjsTypeCounter *counted_in;
+
     unsigned js_object_finalized : 1;
 };
 
@@ -78,6 +86,7 @@ typedef struct {
     ObjectInstance *obj;
     GList *link;
     GClosure *closure;
+    GjsTypeCounter *counter;
 } ConnectData;
 
 static std::stack<JS::PersistentRootedObject> object_init_list;
@@ -935,6 +944,8 @@ handle_toggle_down(GObject *gobj)
 {
     ObjectInstance *priv = get_object_qdata(gobj);
 
+    TRACE(GJS_TOGGLE_HANDLE(gobj, 0));
+
     gjs_debug_lifecycle(GJS_DEBUG_GOBJECT,
                         "Toggle notify gobj %p obj %p is_last_ref true",
                         gobj, priv->keep_alive.get());
@@ -954,6 +965,8 @@ handle_toggle_up(GObject   *gobj)
 {
     ObjectInstance *priv = get_object_qdata(gobj);
 
+    TRACE(GJS_TOGGLE_HANDLE(gobj, 1));
+
     /* We need to root the JSObject associated with the passed in GObject so it
      * doesn't get garbage collected (and lose any associated javascript state
      * such as custom properties).
@@ -1060,6 +1073,7 @@ wrapped_gobj_toggle_notify(gpointer      data,
 
             handle_toggle_down(gobj);
         } else {
+            TRACE(GJS_TOGGLE_QUEUE(gobj, 0));
             toggle_queue.enqueue(gobj, ToggleQueue::DOWN, toggle_handler);
         }
     } else {
@@ -1075,6 +1089,7 @@ wrapped_gobj_toggle_notify(gpointer      data,
             }
             handle_toggle_up(gobj);
         } else {
+            TRACE(GJS_TOGGLE_QUEUE(gobj, 1));
             toggle_queue.enqueue(gobj, ToggleQueue::UP, toggle_handler);
         }
     }
@@ -1089,14 +1104,16 @@ release_native_object (ObjectInstance *priv)
 }
 
 /* At shutdown, we need to ensure we've cleared the context of any
- * pending toggle references.
+ * pending toggle references. Returns the number of toggles handled.
  */
-void
+unsigned
 gjs_object_clear_toggles(void)
 {
     auto& toggle_queue = ToggleQueue::get_default();
+    unsigned n_toggles = 0;
     while (toggle_queue.handle_toggle(toggle_handler))
-        ;
+        n_toggles++;
+    return n_toggles;
 }
 
 void
@@ -1115,6 +1132,28 @@ gjs_object_prepare_shutdown (JSContext *context)
     dissociate_list.clear();
 }
 
+/* Writes one line per GObject wrapper, for the "# GI wrappers." section of
+ * a heap dump: the wrapper's address, as in the rest of the dump, then the
+ * GObject, its type, refcount, whether the wrapper is kept alive by the
+ * GObject, and how many signal handlers it has connected. */
+void
+gjs_object_dump_wrappers(FILE *fp)
+{
+    std::set<ObjectInstance *> wrappers(weak_pointer_list);
+    wrappers.insert(dissociate_list.begin(), dissociate_list.end());
+
+    for (ObjectInstance *priv : wrappers) {
+        if (!priv->gobj || !priv->keep_alive)
+            continue;
+
+        fprintf(fp, "%p gobject %p %s refcount=%u %s signals=%u\n",
+                priv->keep_alive.get(), priv->gobj,
+                G_OBJECT_TYPE_NAME(priv->gobj), priv->gobj->ref_count,
+                priv->keep_alive.rooted() ? "rooted" : "weak",
+                g_list_length(priv->signals));
+    }
+}
+
 static ObjectInstance *
 init_object_private (JSContext       *context,
                      JS::HandleObject object)
@@ -1144,6 +1183,9 @@ init_object_private (JSContext       *context,
     if (priv->info)
         g_base_info_ref( (GIBaseInfo*) priv->info);
 
+    priv->counted_in = proto_priv->type_counter;
+    gjs_type_counter_inc(priv->counted_in);
+
     JS_EndRequest(context);
     return priv;
 }
@@ -1172,6 +1214,9 @@ update_heap_wrapper_weak_pointers(JSRuntime *rt,
 
     for (GObject *gobj : to_be_disassociated)
         disassociate_js_gobject(gobj);
+
+    _gjs_gc_telemetry_wrappers_disassociated(gjs_runtime_get_gc_telemetry(rt),
+                                             to_be_disassociated.size());
 }
 
 static void
@@ -1485,6 +1530,9 @@ object_instance_finalize(JSFreeOp  *fop,
         priv->klass = NULL;
     }
 
+    if (priv->counted_in)
+        gjs_type_counter_dec(priv->counted_in);
+
     GJS_DEC_COUNTER(object);
     priv->~ObjectInstance();
     g_slice_free(ObjectInstance, priv);
@@ -1588,6 +1636,7 @@ static void
 signal_connection_invalidated(void     *data,
                               GClosure *closure)
 {
+    gjs_type_counter_dec(((ConnectData *) data)->counter);
     g_idle_add(signal_connection_invalidate_idle, data);
 }
 
@@ -1649,6 +1698,8 @@ real_connect_func(JSContext *context,
     connect_data->link = priv->signals;
     /* This is a weak reference, and will be cleared when the closure is invalidated */
     connect_data->closure = closure;
+    connect_data->counter = gjs_type_counter_get_for_signal(signal_id);
+    gjs_type_counter_inc(connect_data->counter);
     g_closure_add_invalidate_notifier(closure, connect_data, signal_connection_invalidated);
 
     id = g_signal_connect_closure_by_id(priv->gobj,
@@ -2006,6 +2057,7 @@ gjs_define_object_class(JSContext              *context,
         g_base_info_ref((GIBaseInfo*) info);
     priv->gtype = gtype;
     priv->klass = (GTypeClass*) g_type_class_ref (gtype);
+    priv->type_counter = gjs_type_counter_get_for_gtype(GJS_TYPE_COUNTER_OBJECT, gtype);
     JS_SetPrivate(prototype, priv);
 
     gjs_debug(GJS_DEBUG_GOBJECT, "Defined class %s prototype %p class %p in object %p",
@@ -2987,6 +3039,9 @@ static JSFunctionSpec module_funcs[] = {
     JS_FS("register_type", gjs_register_type, 4, GJS_MODULE_PROP_FLAGS),
     JS_FS("hook_up_vfunc", gjs_hook_up_vfunc, 3, GJS_MODULE_PROP_FLAGS),
     JS_FS("signal_new", gjs_signal_new, 6, GJS_MODULE_PROP_FLAGS),
+    JS_FS("unpack_variant", gjs_variant_unpack_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FS("make_proxy_method", gjs_dbus_make_proxy_method_func, 2, GJS_MODULE_PROP_FLAGS),
+    JS_FS("export_dbus_object", gjs_dbus_export_object_func, 2, GJS_MODULE_PROP_FLAGS),
     JS_FS_END,
 };
 
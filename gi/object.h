@@ -25,6 +25,7 @@
 #define __GJS_OBJECT_H__
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <glib.h>
 #include <girepository.h>
 #include "cjs/jsapi-util.h"
@@ -58,7 +59,9 @@ bool      gjs_typecheck_is_object(JSContext       *context,
 
 void      gjs_object_prepare_shutdown   (JSContext     *context);
 
-void gjs_object_clear_toggles(void);
+unsigned gjs_object_clear_toggles(void);
+
+void gjs_object_dump_wrappers(FILE *fp);
 
 void gjs_object_define_static_methods(JSContext       *context,
                                       JS::HandleObject constructor,
@@ -70,6 +70,13 @@ ToggleQueue::idle_destroy_notify(void *data)
     self->m_toggle_handler = nullptr;
 }
 
+size_t
+ToggleQueue::high_water_mark(void)
+{
+    std::lock_guard<std::mutex> hold(lock);
+    return m_high_water;
+}
+
 std::pair<bool, bool>
 ToggleQueue::is_queued(GObject *gobj)
 {
@@ -134,6 +141,8 @@ ToggleQueue::enqueue(GObject               *gobj,
 
     std::lock_guard<std::mutex> hold(lock);
     q.push_back(item);
+    if (q.size() > m_high_water)
+        m_high_water = q.size();
     
     if (m_idle_id) {
         g_assert(((void) "Should always enqueue with the same handler",
@@ -51,6 +51,7 @@ private:
 
     std::mutex lock;
     std::deque<Item> q;
+    size_t m_high_water;
     unsigned m_idle_id;
     Handler m_toggle_handler;
 
@@ -78,6 +79,9 @@ public:
                  Direction direction,
                  Handler   handler);
 
+    /* The longest the queue has been */
+    size_t high_water_mark(void);
+
     static ToggleQueue&
     get_default(void) {
         static ToggleQueue the_singleton;
@@ -44,6 +44,10 @@ typedef struct {
     GIUnionInfo *info;
     void *gboxed; /* NULL if we are the prototype and not an instance */
     GType gtype;
+    GjsTypeCounter *type_counter; /* prototype: counter for its instances */
+    GjsTypeCounter *counted_in; /* instance: counter to decrement */
+    guint not_owning_gboxed : 1; /* if set, the JS wrapper does not own
+                                    the reference to the C gboxed */
 } Union;
 
 extern struct JSClass gjs_union_class;
@@ -223,6 +227,8 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(union)
     priv->info = proto_priv->info;
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gtype = proto_priv->gtype;
+    priv->counted_in = proto_priv->type_counter;
+    gjs_type_counter_inc(priv->counted_in);
 
     /* union_new happens to be implemented by calling
      * gjs_invoke_c_function(), which returns a JS::Value.
@@ -262,17 +268,20 @@ union_finalize(JSFreeOp *fop,
     if (priv == NULL)
         return; /* wrong class? */
 
-    if (priv->gboxed) {
+    if (priv->gboxed && !priv->not_owning_gboxed) {
         g_boxed_free(g_registered_type_info_get_g_type( (GIRegisteredTypeInfo*) priv->info),
                      priv->gboxed);
-        priv->gboxed = NULL;
     }
+    priv->gboxed = NULL;
 
     if (priv->info) {
         g_base_info_unref( (GIBaseInfo*) priv->info);
         priv->info = NULL;
     }
 
+    if (priv->counted_in)
+        gjs_type_counter_dec(priv->counted_in);
+
     GJS_DEC_COUNTER(boxed);
     g_slice_free(Union, priv);
 }
@@ -365,6 +374,7 @@ gjs_define_union_class(JSContext       *context,
     priv->info = info;
     g_base_info_ref( (GIBaseInfo*) priv->info);
     priv->gtype = gtype;
+    priv->type_counter = gjs_type_counter_get_for_gtype(GJS_TYPE_COUNTER_UNION, gtype);
     JS_SetPrivate(prototype, priv);
 
     gjs_debug(GJS_DEBUG_GBOXED, "Defined class %s prototype is %p class %p in object %p",
@@ -379,9 +389,10 @@ gjs_define_union_class(JSContext       *context,
 }
 
 JSObject*
-gjs_union_from_c_union(JSContext    *context,
-                       GIUnionInfo  *info,
-                       void         *gboxed)
+gjs_union_from_c_union(JSContext             *context,
+                       GIUnionInfo           *info,
+                       void                  *gboxed,
+                       GjsBoxedCreationFlags  flags)
 {
     JSObject *obj;
     Union *priv;
@@ -405,6 +416,7 @@ gjs_union_from_c_union(JSContext    *context,
 
     JS::RootedObject proto(context,
         gjs_lookup_generic_prototype(context, (GIUnionInfo*) info));
+    Union *proto_priv = priv_from_js(context, proto);
 
     obj = JS_NewObjectWithGivenProto(context, JS_GetClass(proto), proto);
 
@@ -414,7 +426,17 @@ gjs_union_from_c_union(JSContext    *context,
     priv->info = info;
     g_base_info_ref( (GIBaseInfo *) priv->info);
     priv->gtype = gtype;
-    priv->gboxed = g_boxed_copy(gtype, gboxed);
+    priv->counted_in = proto_priv->type_counter;
+    gjs_type_counter_inc(priv->counted_in);
+
+    if ((flags & GJS_BOXED_CREATION_NO_COPY) != 0) {
+        /* Used for G_SIGNAL_TYPE_STATIC_SCOPE arguments, such as the
+         * events passed to event signal handlers */
+        priv->gboxed = gboxed;
+        priv->not_owning_gboxed = true;
+    } else {
+        priv->gboxed = g_boxed_copy(gtype, gboxed);
+    }
 
     return obj;
 }
@@ -28,6 +28,7 @@
 #include <glib.h>
 #include <girepository.h>
 #include "cjs/jsapi-util.h"
+#include "boxed.h"
 
 G_BEGIN_DECLS
 
@@ -38,9 +39,10 @@ bool gjs_define_union_class(JSContext       *context,
 void     *gjs_c_union_from_union(JSContext       *context,
                                  JS::HandleObject obj);
 
-JSObject* gjs_union_from_c_union       (JSContext    *context,
-                                        GIUnionInfo  *info,
-                                        void         *gboxed);
+JSObject* gjs_union_from_c_union       (JSContext             *context,
+                                        GIUnionInfo           *info,
+                                        void                  *gboxed,
+                                        GjsBoxedCreationFlags  flags);
 bool      gjs_typecheck_union          (JSContext             *context,
                                         JS::HandleObject       obj,
                                         GIStructInfo          *expected_info,
@@ -36,6 +36,7 @@
 #include "union.h"
 #include "gtype.h"
 #include "gerror.h"
+#include "gjs_gi_trace.h"
 #include "cjs/jsapi-wrapper.h"
 
 #include <girepository.h>
@@ -269,9 +270,22 @@ closure_marshal(GClosure        *closure,
         if (type_info_for[i])
             g_base_info_unref((GIBaseInfo *)type_info_for[i]);
 
+    /* For signal handlers, param_values[0] is the emitting instance */
+    if (signal_query.signal_id) {
+        TRACE(GJS_SIGNAL_EMIT_ENTRY(g_value_peek_pointer(&param_values[0]),
+                                    (char *) g_type_name(signal_query.itype),
+                                    (char *) signal_query.signal_name));
+    }
+
     JS::RootedValue rval(context);
     gjs_closure_invoke(closure, argv, &rval);
 
+    if (signal_query.signal_id) {
+        TRACE(GJS_SIGNAL_EMIT_RETURN(g_value_peek_pointer(&param_values[0]),
+                                     (char *) g_type_name(signal_query.itype),
+                                     (char *) signal_query.signal_name));
+    }
+
     if (return_value != NULL) {
         if (rval.isUndefined()) {
             /* something went wrong invoking, error should be set already */
@@ -908,7 +922,8 @@ gjs_value_from_g_value_internal(JSContext             *context,
                 boxed_flags = (GjsBoxedCreationFlags) (boxed_flags | GJS_BOXED_CREATION_NO_COPY);
             obj = gjs_boxed_from_c_struct(context, (GIStructInfo *)info, gboxed, boxed_flags);
         } else if (type == GI_INFO_TYPE_UNION) {
-            obj = gjs_union_from_c_union(context, (GIUnionInfo *)info, gboxed);
+            obj = gjs_union_from_c_union(context, (GIUnionInfo *)info, gboxed,
+                                         no_copy ? GJS_BOXED_CREATION_NO_COPY : GJS_BOXED_CREATION_NONE);
         } else {
             gjs_throw(context,
                       "Unexpected introspection type %d for %s",
@@ -0,0 +1,681 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <girepository.h>
+
+#include "boxed.h"
+#include "variant.h"
+#include "cjs/byteArray.h"
+#include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-wrapper.h"
+
+/*
+ * Packing and unpacking GVariants used to be done in the GLib overrides, one
+ * introspected call per value, each of which created a boxed wrapper for
+ * its result. Here we walk the GVariantType and the JS value together and
+ * only create a wrapper for the final result, or, when unpacking, for the
+ * children that unpack() leaves as GLib.Variant.
+ */
+
+static GIStructInfo *
+variant_info(void)
+{
+    static GIStructInfo *info = NULL;
+
+    if (g_once_init_enter(&info)) {
+        GIBaseInfo *found = g_irepository_find_by_gtype(NULL, G_TYPE_VARIANT);
+        g_assert(found != NULL);
+        g_once_init_leave(&info, (GIStructInfo *) found);
+    }
+    return info;
+}
+
+/* Takes ownership of @variant, which may be floating */
+static bool
+wrap_variant(JSContext             *cx,
+             GVariant              *variant,
+             JS::MutableHandleValue value)
+{
+    g_variant_ref_sink(variant);
+    JSObject *obj = gjs_boxed_from_c_struct(cx, variant_info(), variant,
+                                            GJS_BOXED_CREATION_NONE);
+    g_variant_unref(variant);
+    if (!obj)
+        return false;
+
+    value.setObject(*obj);
+    return true;
+}
+
+/* Frees a partly built value on error, whether or not it is floating */
+static void
+discard_variant(GVariant *variant)
+{
+    g_variant_unref(g_variant_ref_sink(variant));
+}
+
+static GVariant *
+throw_out_of_range(JSContext          *cx,
+                   const GVariantType *type)
+{
+    gjs_throw_custom(cx, "TypeError", NULL,
+                     "Value is out of range for GVariant type '%.*s'",
+                     (int) g_variant_type_get_string_length(type),
+                     g_variant_type_peek_string(type));
+    return NULL;
+}
+
+static GVariant *
+throw_wrong_type(JSContext          *cx,
+                 const GVariantType *type,
+                 const char         *expected)
+{
+    gjs_throw_custom(cx, "TypeError", NULL,
+                     "Expected %s for GVariant type '%.*s'", expected,
+                     (int) g_variant_type_get_string_length(type),
+                     g_variant_type_peek_string(type));
+    return NULL;
+}
+
+static GVariant *pack_value(JSContext          *cx,
+                            const GVariantType *type,
+                            JS::HandleValue     value);
+
+/* Strings are usually short, so avoid the allocation when we can */
+static GVariant *
+pack_string(JSContext          *cx,
+            const GVariantType *type,
+            JS::HandleValue     value)
+{
+    char buffer[256];
+    char *allocated = NULL;
+    const char *str = buffer;
+
+    if (!value.isString())
+        return throw_wrong_type(cx, type, "a string");
+
+    if (!gjs_string_to_utf8_in_buffer(cx, value, buffer, sizeof(buffer), NULL)) {
+        if (!gjs_string_to_utf8(cx, value, &allocated))
+            return NULL;
+        str = allocated;
+    }
+
+    GVariant *retval = NULL;
+    if (g_variant_type_equal(type, G_VARIANT_TYPE_OBJECT_PATH)) {
+        if (g_variant_is_object_path(str))
+            retval = g_variant_new_object_path(str);
+        else
+            gjs_throw_custom(cx, "TypeError", NULL,
+                             "'%s' is not a valid D-Bus object path", str);
+    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_SIGNATURE)) {
+        if (g_variant_is_signature(str))
+            retval = g_variant_new_signature(str);
+        else
+            gjs_throw_custom(cx, "TypeError", NULL,
+                             "'%s' is not a valid D-Bus signature", str);
+    } else {
+        retval = g_variant_new_string(str);
+    }
+
+    g_free(allocated);
+    return retval;
+}
+
+static GVariant *
+pack_bytes(JSContext          *cx,
+           const GVariantType *type,
+           JS::HandleValue     value)
+{
+    if (value.isString()) {
+        char *str;
+        if (!gjs_string_to_utf8(cx, value, &str))
+            return NULL;
+        GVariant *retval = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, str,
+                                                     strlen(str), 1);
+        g_free(str);
+        return retval;
+    }
+
+    if (!value.isObject())
+        return throw_wrong_type(cx, type, "a ByteArray or an array of numbers");
+
+    JS::RootedObject obj(cx, &value.toObject());
+    if (gjs_typecheck_bytearray(cx, obj, false)) {
+        guint8 *data;
+        gsize len;
+        gjs_byte_array_peek_data(cx, obj, &data, &len);
+        return g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, len, 1);
+    }
+
+    uint32_t len;
+    if (!JS_GetArrayLength(cx, obj, &len))
+        return NULL;
+
+    guint8 *data = g_new(guint8, len);
+    JS::RootedValue elem(cx);
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t byte;
+        if (!JS_GetElement(cx, obj, i, &elem) ||
+            !JS::ToUint32(cx, elem, &byte)) {
+            g_free(data);
+            return NULL;
+        }
+        if (byte > G_MAXUINT8) {
+            g_free(data);
+            return throw_out_of_range(cx, G_VARIANT_TYPE_BYTE);
+        }
+        data[i] = byte;
+    }
+
+    GVariant *retval = g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, len, 1);
+    g_free(data);
+    return retval;
+}
+
+/* Dictionaries are packed from the enumerable own properties of an object;
+ * the property names are converted to the key type */
+static GVariant *
+pack_dict(JSContext          *cx,
+          const GVariantType *type,
+          JS::HandleValue     value)
+{
+    if (!value.isObject())
+        return throw_wrong_type(cx, type, "an object");
+
+    JS::RootedObject obj(cx, &value.toObject());
+    JS::AutoIdArray ids(cx, JS_Enumerate(cx, obj));
+    if (!ids)
+        return NULL;
+
+    const GVariantType *entry_type = g_variant_type_element(type);
+    const GVariantType *key_type = g_variant_type_key(entry_type);
+    const GVariantType *value_type = g_variant_type_value(entry_type);
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, type);
+
+    JS::RootedValue key_val(cx), value_val(cx);
+    JS::RootedId id(cx);
+    for (size_t i = 0; i < ids.length(); i++) {
+        GVariant *key, *child;
+        JSString *key_str;
+
+        id = ids[i];
+        if (!JS_IdToValue(cx, id, &key_val) ||
+            !(key_str = JS::ToString(cx, key_val)))
+            goto fail;
+        key_val.setString(key_str);
+
+        if (!JS_GetPropertyById(cx, obj, id, &value_val))
+            goto fail;
+
+        key = pack_value(cx, key_type, key_val);
+        if (!key)
+            goto fail;
+        child = pack_value(cx, value_type, value_val);
+        if (!child) {
+            discard_variant(key);
+            goto fail;
+        }
+
+        g_variant_builder_add_value(&builder, g_variant_new_dict_entry(key, child));
+    }
+
+    return g_variant_builder_end(&builder);
+
+ fail:
+    g_variant_builder_clear(&builder);
+    return NULL;
+}
+
+static GVariant *
+pack_array(JSContext          *cx,
+           const GVariantType *type,
+           JS::HandleValue     value)
+{
+    const GVariantType *element_type = g_variant_type_element(type);
+
+    if (g_variant_type_equal(element_type, G_VARIANT_TYPE_BYTE))
+        return pack_bytes(cx, type, value);
+    if (g_variant_type_is_dict_entry(element_type))
+        return pack_dict(cx, type, value);
+
+    if (!value.isObject())
+        return throw_wrong_type(cx, type, "an array");
+
+    JS::RootedObject obj(cx, &value.toObject());
+    uint32_t len;
+    if (!JS_GetArrayLength(cx, obj, &len))
+        return NULL;
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, type);
+
+    JS::RootedValue elem(cx);
+    for (uint32_t i = 0; i < len; i++) {
+        GVariant *child;
+        if (!JS_GetElement(cx, obj, i, &elem) ||
+            !(child = pack_value(cx, element_type, elem))) {
+            g_variant_builder_clear(&builder);
+            return NULL;
+        }
+        g_variant_builder_add_value(&builder, child);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+/* Tuples and dictionary entries are packed from arrays; extra elements are
+ * ignored */
+static GVariant *
+pack_tuple(JSContext          *cx,
+           const GVariantType *type,
+           JS::HandleValue     value)
+{
+    if (!value.isObject())
+        return throw_wrong_type(cx, type, "an array");
+
+    JS::RootedObject obj(cx, &value.toObject());
+    uint32_t len;
+    if (!JS_GetArrayLength(cx, obj, &len))
+        return NULL;
+
+    if (len < g_variant_type_n_items(type)) {
+        gjs_throw_custom(cx, "TypeError", NULL,
+                         "Expected %" G_GSIZE_FORMAT " elements for GVariant type '%.*s', got %u",
+                         g_variant_type_n_items(type),
+                         (int) g_variant_type_get_string_length(type),
+                         g_variant_type_peek_string(type), len);
+        return NULL;
+    }
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, type);
+
+    JS::RootedValue elem(cx);
+    uint32_t i = 0;
+    for (const GVariantType *item = g_variant_type_first(type); item;
+         item = g_variant_type_next(item), i++) {
+        GVariant *child;
+        if (!JS_GetElement(cx, obj, i, &elem) ||
+            !(child = pack_value(cx, item, elem))) {
+            g_variant_builder_clear(&builder);
+            return NULL;
+        }
+        g_variant_builder_add_value(&builder, child);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+/* Returns a floating reference */
+static GVariant *
+pack_value(JSContext          *cx,
+           const GVariantType *type,
+           JS::HandleValue     value)
+{
+    int32_t i;
+    uint32_t u;
+    double d;
+
+    switch (g_variant_type_peek_string(type)[0]) {
+    case 'b':
+        return g_variant_new_boolean(JS::ToBoolean(value));
+    case 'y':
+        if (!JS::ToUint32(cx, value, &u))
+            return NULL;
+        if (u > G_MAXUINT8)
+            return throw_out_of_range(cx, type);
+        return g_variant_new_byte(u);
+    case 'n':
+        if (!JS::ToInt32(cx, value, &i))
+            return NULL;
+        if (i > G_MAXINT16 || i < G_MININT16)
+            return throw_out_of_range(cx, type);
+        return g_variant_new_int16(i);
+    case 'q':
+        if (!JS::ToUint32(cx, value, &u))
+            return NULL;
+        if (u > G_MAXUINT16)
+            return throw_out_of_range(cx, type);
+        return g_variant_new_uint16(u);
+    case 'i':
+        if (!JS::ToInt32(cx, value, &i))
+            return NULL;
+        return g_variant_new_int32(i);
+    case 'h':
+        if (!JS::ToInt32(cx, value, &i))
+            return NULL;
+        return g_variant_new_handle(i);
+    case 'u':
+        if (!JS::ToNumber(cx, value, &d))
+            return NULL;
+        if (isnan(d) || d < 0 || d >= 4294967296.)  /* 2^32 */
+            return throw_out_of_range(cx, type);
+        return g_variant_new_uint32(d);
+    case 'x':
+        if (!JS::ToNumber(cx, value, &d))
+            return NULL;
+        /* G_MAXINT64 isn't a double; it rounds up to 2^63, which is out of
+         * range */
+        if (isnan(d) || d < -9223372036854775808. || d >= 9223372036854775808.)
+            return throw_out_of_range(cx, type);
+        return g_variant_new_int64(d);
+    case 't':
+        if (!JS::ToNumber(cx, value, &d))
+            return NULL;
+        if (isnan(d) || d < 0 || d >= 18446744073709551616.)  /* 2^64 */
+            return throw_out_of_range(cx, type);
+        return g_variant_new_uint64(d);
+    case 'd':
+        if (!JS::ToNumber(cx, value, &d))
+            return NULL;
+        return g_variant_new_double(d);
+    case 's':
+    case 'o':
+    case 'g':
+        return pack_string(cx, type, value);
+
+    case 'v': {
+        if (!value.isObject())
+            return throw_wrong_type(cx, type, "a GLib.Variant");
+        JS::RootedObject obj(cx, &value.toObject());
+        if (!gjs_typecheck_boxed(cx, obj, NULL, G_TYPE_VARIANT, true))
+            return NULL;
+        return g_variant_new_variant((GVariant *) gjs_c_struct_from_boxed(cx, obj));
+    }
+
+    case 'm': {
+        const GVariantType *element_type = g_variant_type_element(type);
+        if (value.isNullOrUndefined())
+            return g_variant_new_maybe(element_type, NULL);
+        GVariant *child = pack_value(cx, element_type, value);
+        if (!child)
+            return NULL;
+        return g_variant_new_maybe(element_type, child);
+    }
+
+    case 'a':
+        return pack_array(cx, type, value);
+    case '(':
+    case '{':
+        return pack_tuple(cx, type, value);
+
+    default:
+        g_assert_not_reached();
+    }
+}
+
+GVariant *
+gjs_variant_pack(JSContext      *cx,
+                 const char     *signature,
+                 JS::HandleValue value)
+{
+    const char *end;
+
+    if (!*signature) {
+        gjs_throw_custom(cx, "TypeError", NULL,
+                         "GVariant signature cannot be empty");
+        return NULL;
+    }
+    if (!g_variant_type_string_scan(signature, NULL, &end)) {
+        gjs_throw_custom(cx, "TypeError", NULL,
+                         "Invalid GVariant signature '%s'", signature);
+        return NULL;
+    }
+    if (*end) {
+        gjs_throw_custom(cx, "TypeError", NULL,
+                         "Invalid GVariant signature '%s' (more than one single complete type)",
+                         signature);
+        return NULL;
+    }
+
+    const GVariantType *type = G_VARIANT_TYPE(signature);
+    if (!g_variant_type_is_definite(type)) {
+        gjs_throw_custom(cx, "TypeError", NULL,
+                         "Invalid GVariant signature '%s' (a definite type was expected)",
+                         signature);
+        return NULL;
+    }
+
+    return pack_value(cx, type, value);
+}
+
+GVariant *
+gjs_variant_pack_type(JSContext          *cx,
+                      const GVariantType *type,
+                      JS::HandleValue     value)
+{
+    g_assert(g_variant_type_is_definite(type));
+    return pack_value(cx, type, value);
+}
+
+GVariant *
+gjs_variant_pack_args(JSContext                  *cx,
+                      const GVariantType         *tuple_type,
+                      const JS::HandleValueArray& args)
+{
+    g_assert(g_variant_type_is_tuple(tuple_type));
+    g_assert(args.length() >= g_variant_type_n_items(tuple_type));
+
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, tuple_type);
+
+    size_t i = 0;
+    for (const GVariantType *item = g_variant_type_first(tuple_type); item;
+         item = g_variant_type_next(item), i++) {
+        GVariant *child = pack_value(cx, item, args[i]);
+        if (!child) {
+            g_variant_builder_clear(&builder);
+            return NULL;
+        }
+        g_variant_builder_add_value(&builder, child);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+static bool
+unpack_child(JSContext             *cx,
+             GVariant              *parent,
+             size_t                 index,
+             bool                   deep,
+             JS::MutableHandleValue value)
+{
+    GVariant *child = g_variant_get_child_value(parent, index);
+    if (!deep)
+        return wrap_variant(cx, child, value);
+
+    bool ok = gjs_variant_unpack(cx, child, true, value);
+    g_variant_unref(child);
+    return ok;
+}
+
+/* Dictionary keys are always unpacked, since they become property names */
+static bool
+unpack_dict(JSContext             *cx,
+            GVariant              *variant,
+            bool                   deep,
+            JS::MutableHandleValue value)
+{
+    JS::RootedObject obj(cx, JS_NewPlainObject(cx));
+    if (!obj)
+        return false;
+
+    size_t n_children = g_variant_n_children(variant);
+    JS::RootedValue key_val(cx), child_val(cx);
+    JS::RootedId key(cx);
+
+    for (size_t i = 0; i < n_children; i++) {
+        GVariant *entry = g_variant_get_child_value(variant, i);
+        GVariant *entry_key = g_variant_get_child_value(entry, 0);
+
+        bool ok = gjs_variant_unpack(cx, entry_key, true, &key_val) &&
+            JS_ValueToId(cx, key_val, &key) &&
+            unpack_child(cx, entry, 1, deep, &child_val) &&
+            JS_DefinePropertyById(cx, obj, key, child_val, JSPROP_ENUMERATE);
+
+        g_variant_unref(entry_key);
+        g_variant_unref(entry);
+        if (!ok)
+            return false;
+    }
+
+    value.setObject(*obj);
+    return true;
+}
+
+static bool
+unpack_children(JSContext             *cx,
+                GVariant              *variant,
+                bool                   deep,
+                JS::MutableHandleValue value)
+{
+    size_t n_children = g_variant_n_children(variant);
+    JS::AutoValueVector elems(cx);
+    JS::RootedValue child(cx);
+
+    for (size_t i = 0; i < n_children; i++) {
+        if (!unpack_child(cx, variant, i, deep, &child) ||
+            !elems.append(child))
+            return false;
+    }
+
+    JSObject *array = JS_NewArrayObject(cx, elems);
+    if (!array)
+        return false;
+
+    value.setObject(*array);
+    return true;
+}
+
+bool
+gjs_variant_unpack(JSContext             *cx,
+                   GVariant              *variant,
+                   bool                   deep,
+                   JS::MutableHandleValue value)
+{
+    switch (g_variant_classify(variant)) {
+    case G_VARIANT_CLASS_BOOLEAN:
+        value.setBoolean(g_variant_get_boolean(variant));
+        return true;
+    case G_VARIANT_CLASS_BYTE:
+        value.setInt32(g_variant_get_byte(variant));
+        return true;
+    case G_VARIANT_CLASS_INT16:
+        value.setInt32(g_variant_get_int16(variant));
+        return true;
+    case G_VARIANT_CLASS_UINT16:
+        value.setInt32(g_variant_get_uint16(variant));
+        return true;
+    case G_VARIANT_CLASS_INT32:
+        value.setInt32(g_variant_get_int32(variant));
+        return true;
+    case G_VARIANT_CLASS_UINT32:
+        value.setNumber(g_variant_get_uint32(variant));
+        return true;
+    case G_VARIANT_CLASS_INT64:
+        value.setNumber(double(g_variant_get_int64(variant)));
+        return true;
+    case G_VARIANT_CLASS_UINT64:
+        value.setNumber(double(g_variant_get_uint64(variant)));
+        return true;
+    case G_VARIANT_CLASS_HANDLE:
+        value.setInt32(g_variant_get_handle(variant));
+        return true;
+    case G_VARIANT_CLASS_DOUBLE:
+        value.setNumber(g_variant_get_double(variant));
+        return true;
+
+    case G_VARIANT_CLASS_STRING:
+    case G_VARIANT_CLASS_OBJECT_PATH:
+    case G_VARIANT_CLASS_SIGNATURE: {
+        gsize len;
+        const char *str = g_variant_get_string(variant, &len);
+        return gjs_string_from_utf8(cx, str, len, value);
+    }
+
+    /* Variants are never unpacked, even by deep_unpack() */
+    case G_VARIANT_CLASS_VARIANT:
+        return wrap_variant(cx, g_variant_get_variant(variant), value);
+
+    case G_VARIANT_CLASS_MAYBE: {
+        GVariant *child = g_variant_get_maybe(variant);
+        if (!child) {
+            value.setNull();
+            return true;
+        }
+        if (!deep)
+            return wrap_variant(cx, child, value);
+        bool ok = gjs_variant_unpack(cx, child, true, value);
+        g_variant_unref(child);
+        return ok;
+    }
+
+    case G_VARIANT_CLASS_ARRAY:
+        if (g_variant_is_of_type(variant, G_VARIANT_TYPE("a{?*}")))
+            return unpack_dict(cx, variant, deep, value);
+
+        if (g_variant_is_of_type(variant, G_VARIANT_TYPE_BYTESTRING)) {
+            GBytes *bytes = g_variant_get_data_as_bytes(variant);
+            JSObject *obj = gjs_byte_array_from_bytes(cx, bytes);
+            g_bytes_unref(bytes);
+            if (!obj)
+                return false;
+            value.setObject(*obj);
+            return true;
+        }
+        return unpack_children(cx, variant, deep, value);
+
+    case G_VARIANT_CLASS_TUPLE:
+    case G_VARIANT_CLASS_DICT_ENTRY:
+        return unpack_children(cx, variant, deep, value);
+
+    default:
+        g_assert_not_reached();
+    }
+}
+
+bool
+gjs_variant_unpack_func(JSContext *cx,
+                        unsigned   argc,
+                        JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp(argc, vp);
+    JS::RootedObject variant_obj(cx);
+    bool deep;
+
+    if (!gjs_parse_call_args(cx, "unpack_variant", argv, "ob",
+                             "variant", &variant_obj,
+                             "deep", &deep))
+        return false;
+
+    if (!gjs_typecheck_boxed(cx, variant_obj, NULL, G_TYPE_VARIANT, true))
+        return false;
+
+    auto variant = static_cast<GVariant *>(gjs_c_struct_from_boxed(cx, variant_obj));
+    return gjs_variant_unpack(cx, variant, deep, argv.rval());
+}
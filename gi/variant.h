@@ -0,0 +1,64 @@
+/* -*- mode: C++; c-basic-offset: 4; indent-tabs-mode: nil; -*- */
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef __GJS_VARIANT_H__
+#define __GJS_VARIANT_H__
+
+#include <stdbool.h>
+#include <glib.h>
+#include "cjs/jsapi-util.h"
+
+G_BEGIN_DECLS
+
+/* Packs @value into a new floating GVariant of type @signature, following
+ * the rules of new GLib.Variant(). Returns NULL with an exception pending
+ * on failure. */
+GVariant *gjs_variant_pack(JSContext      *cx,
+                           const char     *signature,
+                           JS::HandleValue value);
+
+/* Like gjs_variant_pack(), for a type that is already known to be valid */
+GVariant *gjs_variant_pack_type(JSContext          *cx,
+                                const GVariantType *type,
+                                JS::HandleValue     value);
+
+/* Packs a floating tuple of type @tuple_type from the first values in @args,
+ * one per item, e.g. the arguments of a D-Bus method call. @args must have
+ * at least as many values as the tuple has items. */
+GVariant *gjs_variant_pack_args(JSContext                  *cx,
+                                const GVariantType         *tuple_type,
+                                const JS::HandleValueArray& args);
+
+/* Converts @variant to JS, as GLib.Variant.unpack() if @deep is false, or
+ * deep_unpack() if it is true */
+bool gjs_variant_unpack(JSContext             *cx,
+                        GVariant              *variant,
+                        bool                   deep,
+                        JS::MutableHandleValue value);
+
+/* The above, as a JS function for the GLib overrides */
+bool gjs_variant_unpack_func(JSContext *cx,
+                             unsigned   argc,
+                             JS::Value *vp);
+
+G_END_DECLS
+
+#endif  /* __GJS_VARIANT_H__ */
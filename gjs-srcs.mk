@@ -3,6 +3,7 @@ gjs_public_headers =		\
 	cjs/coverage.h		\
 	cjs/gjs.h		\
 	cjs/macros.h		\
+	cjs/profiler.h		\
 	util/error.h		\
 	$(NULL)
 
@@ -17,6 +18,8 @@ gjs_srcs =				\
 	gi/boxed.h			\
 	gi/closure.cpp			\
 	gi/closure.h			\
+	gi/dbus.cpp			\
+	gi/dbus.h			\
 	gi/enumeration.cpp		\
 	gi/enumeration.h		\
 	gi/foreign.cpp			\
@@ -48,12 +51,16 @@ gjs_srcs =				\
 	gi/union.h			\
 	gi/value.cpp			\
 	gi/value.h			\
+	gi/variant.cpp			\
+	gi/variant.h			\
 	cjs/byteArray.cpp		\
 	cjs/byteArray.h			\
 	cjs/context.cpp			\
 	cjs/context-private.h		\
 	cjs/coverage-internal.h		\
 	cjs/coverage.cpp 		\
+	cjs/gc-telemetry.cpp		\
+	cjs/gc-telemetry.h		\
 	cjs/importer.cpp		\
 	cjs/importer.h			\
 	cjs/jsapi-class.h		\
@@ -73,6 +80,8 @@ gjs_srcs =				\
 	cjs/mem.cpp			\
 	cjs/native.cpp			\
 	cjs/native.h			\
+	cjs/profiler.cpp		\
+	cjs/profiler-private.h		\
 	cjs/runtime.cpp			\
 	cjs/runtime.h			\
 	cjs/stack.cpp			\
@@ -105,3 +114,7 @@ gjs_gtk_private_srcs =			\
 gjs_console_srcs =	\
 	cjs/console.cpp	\
 	$(NULL)
+
+gjs_coverage_merge_srcs =	\
+	cjs/coverage-merge.cpp	\
+	$(NULL)
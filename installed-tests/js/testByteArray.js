@@ -128,4 +128,44 @@ describe('Byte array', function () {
         expect(s.length).toEqual(4);
         expect(s).toEqual('abcd');
     });
+
+    describe('parsed as JSON', function () {
+        it('gives the same result as JSON.parse()', function () {
+            let json = '{"name": "caf\u00e9 \u2665", "list": [1, 2.5, true, null]}';
+            let a = ByteArray.fromString(json);
+            expect(a.parseJSON()).toEqual(JSON.parse(json));
+        });
+
+        it('skips a byte order mark', function () {
+            let a = ByteArray.fromArray([0xEF, 0xBB, 0xBF, 0x5B, 0x31, 0x5D]);
+            expect(a.parseJSON()).toEqual([1]);
+        });
+
+        it('throws on invalid JSON', function () {
+            expect(() => ByteArray.fromString('{').parseJSON()).toThrow();
+            expect(() => new ByteArray.ByteArray().parseJSON()).toThrow();
+        });
+
+        it('throws on invalid UTF-8', function () {
+            let a = ByteArray.fromArray([0x22, 0xFF, 0x22]);
+            expect(() => a.parseJSON()).toThrow();
+        });
+
+        it('throws on a NUL byte whether or not the data is ASCII', function () {
+            let ascii = ByteArray.fromString('{"a":"e"}');
+            ascii[ascii.length] = 0;
+            expect(() => ascii.parseJSON()).toThrow();
+
+            let nonAscii = ByteArray.fromString('{"a":"\u00e9"}');
+            nonAscii[nonAscii.length] = 0;
+            nonAscii[nonAscii.length] = 0x7B;
+            expect(() => nonAscii.parseJSON()).toThrow();
+        });
+
+        it('works on GLib.Bytes', function () {
+            const GLib = imports.gi.GLib;
+            let bytes = GLib.Bytes.new('{"a": [1]}');
+            expect(bytes.parseJSON()).toEqual({ a: [1] });
+        });
+    });
 });
@@ -30,6 +30,19 @@ describe('Cairo', function () {
             expect(_ts(cr.getTarget())).toEqual('ImageSurface');
         });
 
+        it('returns the same wrapper for its target surface every time', function () {
+            expect(cr.getTarget()).toBe(surface);
+            expect(cr.getTarget()).toBe(cr.getTarget());
+            expect(cr.getGroupTarget()).toBe(surface);
+        });
+
+        it('returns the same wrapper for its source every time', function () {
+            let pattern = Cairo.SolidPattern.createRGB(1, 2, 3);
+            cr.setSource(pattern);
+            expect(cr.getSource()).toBe(pattern);
+            expect(cr.getSource()).toBe(cr.getSource());
+        });
+
         it('can set its source to a pattern', function () {
             let pattern = Cairo.SolidPattern.createRGB(1, 2, 3);
             cr.setSource(pattern);
@@ -165,6 +178,26 @@ describe('Cairo', function () {
             }).not.toThrow();
         });
 
+        it('can draw a path from a list of operations', function () {
+            cr.drawPath(new Float64Array([
+                Cairo.PathOp.MOVE_TO, 0, 0,
+                Cairo.PathOp.LINE_TO, 10, 0,
+                Cairo.PathOp.REL_LINE_TO, 0, 5,
+                Cairo.PathOp.CLOSE_PATH,
+            ]));
+            expect(cr.pathExtents()).toEqual([0, 0, 10, 5]);
+
+            cr.drawPath([Cairo.PathOp.NEW_PATH,
+                Cairo.PathOp.RECTANGLE, 1, 2, 3, 4]);
+            expect(cr.pathExtents()).toEqual([1, 2, 4, 6]);
+        });
+
+        it('rejects malformed path operations', function () {
+            expect(() => cr.drawPath(new Float64Array([Cairo.PathOp.LINE_TO, 1])))
+                .toThrow();
+            expect(() => cr.drawPath(new Float64Array([42]))).toThrow();
+        });
+
         it('can be marshalled through a signal handler', function () {
             let o = new Regress.TestObj();
             let foreignSpy = jasmine.createSpy('sig-with-foreign-struct');
@@ -185,6 +218,92 @@ describe('Cairo', function () {
         });
     });
 
+    describe('image surface', function () {
+        it('gives access to its pixels', function () {
+            surface = new Cairo.ImageSurface(Cairo.Format.ARGB32, 2, 2);
+            cr = new Cairo.Context(surface);
+            cr.setSourceRGBA(1, 0, 0, 1);
+            cr.paint();
+
+            let data = surface.getData();
+            expect(data instanceof Uint8ClampedArray).toBeTruthy();
+            expect(data.length).toEqual(surface.getStride() * 2);
+            let pixel = Array.prototype.slice.call(data, 0, 4);
+            expect(pixel.filter(b => b === 255).length).toEqual(2);
+        });
+
+        it('shares its pixels with getData()', function () {
+            surface = new Cairo.ImageSurface(Cairo.Format.A8, 4, 1);
+            let data = surface.getData();
+            data[0] = 42;
+            surface.markDirty();
+            expect(surface.getData()[0]).toEqual(42);
+        });
+
+        it('can be created for a typed array', function () {
+            let array = new Uint8ClampedArray(4 * 2 * 2);
+            array.fill(255);
+            let s = Cairo.ImageSurface.createForData(array, Cairo.Format.ARGB32,
+                2, 2, 8);
+            expect(s.getWidth()).toEqual(2);
+            expect(s.getStride()).toEqual(8);
+            expect(s.getData()[15]).toEqual(255);
+        });
+
+        it('copies pixels that belong to another surface', function () {
+            surface = new Cairo.ImageSurface(Cairo.Format.A8, 4, 1);
+            let data = surface.getData();
+            data[0] = 42;
+            let s = Cairo.ImageSurface.createForData(data, Cairo.Format.A8,
+                4, 1);
+            expect(s.getData()[0]).toEqual(42);
+            expect(data.length).toEqual(4);
+            s.getData()[0] = 7;
+            expect(surface.getData()[0]).toEqual(42);
+        });
+
+        it('rejects a typed array that is too small', function () {
+            expect(() => Cairo.ImageSurface.createForData(new Uint8Array(4),
+                Cairo.Format.ARGB32, 2, 2)).toThrow();
+        });
+    });
+
+    describe('path', function () {
+        it('can be converted to a list of operations', function () {
+            cr.moveTo(1, 2);
+            cr.lineTo(3, 4);
+            cr.curveTo(5, 6, 7, 8, 9, 10);
+            cr.closePath();
+            let ops = cr.copyPath().toOps();
+            expect(ops instanceof Float64Array).toBeTruthy();
+            expect(Array.prototype.slice.call(ops)).toEqual([
+                Cairo.PathOp.MOVE_TO, 1, 2,
+                Cairo.PathOp.LINE_TO, 3, 4,
+                Cairo.PathOp.CURVE_TO, 5, 6, 7, 8, 9, 10,
+                Cairo.PathOp.CLOSE_PATH,
+                // cairo adds a MOVE_TO after CLOSE_PATH
+                Cairo.PathOp.MOVE_TO, 1, 2,
+            ]);
+        });
+
+        it('can be constructed from a list of operations', function () {
+            let path = new Cairo.Path(new Float64Array([
+                Cairo.PathOp.MOVE_TO, 0, 0,
+                Cairo.PathOp.LINE_TO, 10, 20,
+            ]));
+            cr.appendPath(path);
+            expect(cr.pathExtents()).toEqual([0, 0, 10, 20]);
+            expect(Array.prototype.slice.call(path.toOps()))
+                .toEqual([0, 0, 0, 1, 10, 20]);
+        });
+
+        it('rejects operations that paths cannot contain', function () {
+            expect(() => new Cairo.Path([Cairo.PathOp.RECTANGLE, 0, 0, 1, 1]))
+                .toThrow();
+            expect(() => new Cairo.Path([Cairo.PathOp.CURVE_TO, 0, 0])).toThrow();
+        });
+    });
+
     describe('solid pattern', function () {
         it('can be created from RGB static method', function () {
             let p1 = Cairo.SolidPattern.createRGB(1, 2, 3);
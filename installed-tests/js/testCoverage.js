@@ -1118,6 +1118,17 @@ describe('Coverage statistics container', function () {
             container.fetchStatistics('uncached');
             expect(container.staleCache()).toBeTruthy();
         });
+
+        it('reports files without a cache entry as stale', function () {
+            expect(container.staleFiles(['filename', 'uncached']))
+                .toEqual(['uncached']);
+        });
+
+        it('fetches counters from an analysis done in advance', function () {
+            container.addAnalysis('uncached', Coverage.analyzeFile('uncached'));
+            container.fetchStatistics('uncached');
+            expect(Coverage._fetchCountersFromReflection).not.toHaveBeenCalled();
+        });
     });
 
     describe('coverage counters from cache', function () {
@@ -164,6 +164,13 @@ describe('Life, the Universe and Everything', function () {
             Regress.test_utf8_const_in(CONST_STR);
         });
 
+        it('as in parameters of any length', function () {
+            for (let len of [0, 1, 1023, 1024, 4096]) {
+                let str = '\u2665'.repeat(len);
+                expect(Regress.test_int_out_utf8(str)).toEqual(len);
+            }
+        });
+
         it('as out parameters', function () {
             expect(Regress.test_utf8_out()).toEqual(NONCONST_STR);
         });
@@ -570,6 +577,19 @@ describe('Life, the Universe and Everything', function () {
             expect(err.domain).toEqual(Gio.io_error_quark());
             expect(err.code).toEqual(Gio.IOErrorEnum.NOT_FOUND);
         });
+
+        it('has a stack like a JS error', function () {
+            expect(err.stack).toMatch(/testEverythingBasic\.js/);
+            expect(err.fileName).toMatch(/testEverythingBasic\.js$/);
+            expect(err.lineNumber).toBeGreaterThan(0);
+            expect(Object.keys(err)).toContain('stack');
+        });
+
+        it('lets the stack be replaced', function () {
+            err.stack = 'replaced';
+            expect(err.stack).toEqual('replaced');
+            expect(err.fileName).toMatch(/testEverythingBasic\.js$/);
+        });
     });
 
     it('GError callback', function (done) {
@@ -26,6 +26,25 @@ describe('Introspected structs', function () {
             expect(b.some_double).toEqual(42.5);
             expect(b.some_enum).toEqual(Regress.TestEnum.VALUE3);
         });
+
+        it('checks the range of values written to fields', function () {
+            expect(() => struct.some_int8 = 300).toThrow();
+            expect(struct.some_int8).toEqual(43);
+        });
+
+        it('cannot access fields on the prototype', function () {
+            expect(() => Regress.TestStructA.prototype.some_int).toThrow();
+            expect(() => Regress.TestStructA.prototype.some_int = 1).toThrow();
+        });
+
+        it('cannot use field accessors on a struct of another type', function () {
+            let desc = Object.getOwnPropertyDescriptor(Regress.TestStructA.prototype,
+                'some_double');
+            let other = new Regress.TestStructB();
+            expect(() => desc.get.call(other)).toThrow();
+            expect(() => desc.set.call(other, 42.5)).toThrow();
+            expect(desc.get.call(struct)).toEqual(42.5);
+        });
     });
 
     describe('nested', function () {
@@ -133,6 +152,17 @@ describe('Introspected boxed types', function () {
             expect(copy.some_double).toEqual(42.5);
             expect(copy.some_enum).toEqual(Regress.TestEnum.VALUE3);
         });
+
+        it('does not share memory between copies', function () {
+            let copy = simple_boxed.copy();
+            copy.some_int = 1;
+            let copy2 = new Regress.TestSimpleBoxedA(copy);
+            copy2.some_int = 2;
+            expect(simple_boxed.some_int).toEqual(42);
+            expect(copy.some_int).toEqual(1);
+            expect(copy2.some_int).toEqual(2);
+            expect(copy.equals(simple_boxed)).toBeFalsy();
+        });
     });
 
     describe('nested', function () {
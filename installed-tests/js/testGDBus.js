@@ -329,6 +329,26 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('checks the number of arguments passed to a remote method', function () {
+        expect(() => proxy.multipleInArgsRemote(1, 2, 3))
+            .toThrowError(/Not enough arguments/);
+        expect(() => proxy.noInParameterRemote(1, 2, 3, 4))
+            .toThrowError(/Too many arguments/);
+        expect(() => proxy.noInParameterRemote('a string'))
+            .toThrowError(/It should be a callback, flags or a Gio.Cancellable/);
+    });
+
+    it('can call a remote method through Function.prototype.apply()', function () {
+        expect(proxy.multipleInArgsRemote instanceof Function).toBeTruthy();
+        expect(proxy.multipleInArgsRemote.length).toEqual(5);
+        proxy.multipleInArgsRemote.apply(proxy, [1, 2, 3, 4, 5, ([result], excp) => {
+            expect(result).toEqual('1 2 3 4 5');
+            expect(excp).toBeNull();
+            loop.quit();
+        }]);
+        loop.run();
+    });
+
     it('can call a remote method with no return value', function () {
         proxy.noReturnValueRemote(([result], excp) => {
             expect(result).not.toBeDefined();
@@ -437,6 +457,76 @@ describe('Exported DBus object', function () {
         loop.run();
     });
 
+    it('signals property changes queued together at once', function () {
+        let id = proxy.connect('g-properties-changed', (proxy, changed, invalidated) => {
+            proxy.disconnect(id);
+            let props = changed.deep_unpack();
+            expect(Object.keys(props).sort()).toEqual(['PropReadOnly', 'PropReadWrite']);
+            expect(props.PropReadOnly.deep_unpack()).toBe(false);
+            loop.quit();
+        });
+        test._impl.emit_property_changed('PropReadOnly',
+            new GLib.Variant('b', false));
+        test._impl.emit_property_changed('PropReadWrite',
+            new GLib.Variant('v', new GLib.Variant('s', '59')));
+        loop.run();
+    });
+
+    describe('batching property changes', function () {
+        afterEach(function () {
+            test._impl.batch_latency = 10;
+            test._impl.batch_max_size = 0;
+        });
+
+        it('signals them right away once batch-max-size are queued', function () {
+            test._impl.batch_latency = 60000;
+            test._impl.batch_max_size = 2;
+
+            let timeoutId = GLib.timeout_add(GLib.PRIORITY_DEFAULT, 5000, () => {
+                fail('Property changes were not signalled right away');
+                loop.quit();
+                return GLib.SOURCE_REMOVE;
+            });
+            let id = proxy.connect('g-properties-changed', (proxy, changed) => {
+                proxy.disconnect(id);
+                GLib.source_remove(timeoutId);
+                expect(Object.keys(changed.deep_unpack()).sort())
+                    .toEqual(['PropReadOnly', 'PropReadWrite']);
+                loop.quit();
+            });
+            test._impl.emit_property_changed('PropReadOnly',
+                new GLib.Variant('b', false));
+            test._impl.emit_property_changed('PropReadWrite',
+                new GLib.Variant('v', new GLib.Variant('s', '59')));
+            loop.run();
+        });
+
+        it('signals them on the next main loop iteration with batch-latency 0', function () {
+            test._impl.batch_latency = 0;
+            test._impl.emit_property_changed('PropReadOnly',
+                new GLib.Variant('b', false));
+            GLib.MainContext.default().iteration(false);
+
+            // Had the first change not been flushed yet, this one would
+            // be signalled together with it
+            test._impl.batch_latency = 60000;
+            test._impl.emit_property_changed('PropReadWrite',
+                new GLib.Variant('v', new GLib.Variant('s', '59')));
+
+            let signalled = [];
+            let id = proxy.connect('g-properties-changed', (proxy, changed) => {
+                signalled.push(Object.keys(changed.deep_unpack()));
+                if (signalled.length === 1)
+                    test._impl.flush();
+                else
+                    loop.quit();
+            });
+            loop.run();
+            proxy.disconnect(id);
+            expect(signalled).toEqual([['PropReadOnly'], ['PropReadWrite']]);
+        });
+    });
+
     it('can send and receive dicts from a remote method', function () {
         let someDict = {
             aDouble: new GLib.Variant('d', 10),
@@ -6,6 +6,7 @@ const Gio = imports.gi.Gio;
 const GLib = imports.gi.GLib;
 const GObject = imports.gi.GObject;
 const Lang = imports.lang;
+const System = imports.system;
 
 describe('C array', function () {
     function createStructArray() {
@@ -149,6 +150,22 @@ describe('C array', function () {
         it('can be implicitly converted from a string', function () {
             expect(() => GIMarshallingTests.array_uint8_in('abcd')).not.toThrow();
         });
+
+        it('can be passed in from a ByteArray', function () {
+            let array = ByteArray.fromString('abcd');
+            expect(() => GIMarshallingTests.array_uint8_in(array)).not.toThrow();
+            array[0] = 122;  // Still our own copy afterwards
+            expect(array.toString()).toEqual('zbcd');
+        });
+
+        it('can be passed in from a ByteArray holding a GBytes', function () {
+            let bytes = ByteArray.fromString('abcd').toGBytes();
+            let array = ByteArray.fromGBytes(bytes);
+            expect(() => GIMarshallingTests.array_uint8_in(array)).not.toThrow();
+            array[0] = 122;
+            expect(array.toString()).toEqual('zbcd');
+            expect(ByteArray.fromGBytes(bytes).toString()).toEqual('abcd');
+        });
     });
 
     describe('of 64-bit ints', function () {
@@ -391,6 +408,31 @@ describe('GHashTable', function () {
     }).pend('https://bugzilla.gnome.org/show_bug.cgi?id=773763');
 });
 
+describe('Boxed struct', function () {
+    it('with a pointer array field is copied by its copy function', function () {
+        let struct = GIMarshallingTests.boxed_struct_returnv();
+        expect(struct.long_).toEqual(42);
+        expect(struct.g_strv).toEqual(['0', '1', '2']);
+
+        let copy = new GIMarshallingTests.BoxedStruct(struct);
+        expect(copy.g_strv).toEqual(['0', '1', '2']);
+        expect(GIMarshallingTests.boxed_struct_returnv().g_strv)
+            .toEqual(['0', '1', '2']);
+    });
+});
+
+describe('Union', function () {
+    it('is copied when returned with transfer none', function () {
+        let union = GIMarshallingTests.union_returnv();
+        let union2 = GIMarshallingTests.union_returnv();
+        expect(union instanceof GIMarshallingTests.Union).toBeTruthy();
+        expect(union).not.toBe(union2);
+        union = null;
+        System.gc();
+        expect(() => union2.method()).not.toThrow();
+    });
+});
+
 describe('GValue', function () {
     it('can be passed into a function and packed', function () {
         expect(() => GIMarshallingTests.gvalue_in(42)).not.toThrow();
@@ -40,4 +40,112 @@ describe('GVariant constructor', function () {
         maybe_variant = new GLib.Variant('ms', 'string');
         expect(maybe_variant.deep_unpack()).toEqual('string');
     });
+
+    it('constructs a dictionary variant', function () {
+        let dict_variant = new GLib.Variant('a{sv}', {
+            foo: new GLib.Variant('s', 'bar'),
+            answer: new GLib.Variant('u', 42),
+        });
+        let unpacked = dict_variant.unpack();
+        expect(unpacked.foo instanceof GLib.Variant).toBeTruthy();
+        expect(unpacked.foo.unpack()).toEqual('bar');
+        expect(unpacked.answer.unpack()).toEqual(42);
+
+        let int_keys = new GLib.Variant('a{ub}', {1: true, 2: false});
+        expect(int_keys.deep_unpack()).toEqual({1: true, 2: false});
+    });
+
+    it('constructs a byte array variant', function () {
+        let bytes = new GLib.Variant('ay', [1, 2, 255]).deep_unpack();
+        expect(bytes.length).toEqual(3);
+        expect(bytes[2]).toEqual(255);
+
+        let from_string = new GLib.Variant('ay', 'abc');
+        expect(from_string.get_data_as_bytes().get_size()).toEqual(3);
+    });
+
+    it('ignores extra tuple elements', function () {
+        let tuple = new GLib.Variant('(ib)', [-1, true, 'extra']);
+        expect(tuple.deep_unpack()).toEqual([-1, true]);
+    });
+
+    it('leaves children as variants when not unpacking deeply', function () {
+        let unpacked = new GLib.Variant('(iai)', [1, [2]]).unpack();
+        expect(unpacked[0] instanceof GLib.Variant).toBeTruthy();
+        expect(unpacked[1].deep_unpack()).toEqual([2]);
+    });
+
+    it('rejects invalid signatures', function () {
+        expect(() => new GLib.Variant('', 1)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('ii', 1)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('(i', [1])).toThrowError(TypeError);
+        expect(() => new GLib.Variant('a*', [])).toThrowError(TypeError);
+    });
+
+    it('rejects values of the wrong type', function () {
+        expect(() => new GLib.Variant('s', 5)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('o', 'not a path')).toThrowError(TypeError);
+        expect(() => new GLib.Variant('y', 256)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('(ii)', [1])).toThrowError(TypeError);
+        expect(() => new GLib.Variant('v', 'string')).toThrowError(TypeError);
+    });
+
+    it('rejects numbers out of range for 32- and 64-bit types', function () {
+        ['u', 'x', 't'].forEach(type => {
+            expect(() => new GLib.Variant(type, NaN)).toThrowError(TypeError);
+            expect(() => new GLib.Variant(type, 'junk')).toThrowError(TypeError);
+        });
+        expect(() => new GLib.Variant('u', Math.pow(2, 32))).toThrowError(TypeError);
+        expect(() => new GLib.Variant('u', -1)).toThrowError(TypeError);
+        expect(() => new GLib.Variant('x', Math.pow(2, 63))).toThrowError(TypeError);
+        expect(() => new GLib.Variant('x', -Math.pow(2, 64))).toThrowError(TypeError);
+        expect(() => new GLib.Variant('t', Math.pow(2, 64))).toThrowError(TypeError);
+        expect(() => new GLib.Variant('t', Infinity)).toThrowError(TypeError);
+    });
+
+    it('packs numbers at the limits of 32- and 64-bit types', function () {
+        expect(new GLib.Variant('u', Math.pow(2, 32) - 1).unpack())
+            .toEqual(Math.pow(2, 32) - 1);
+        expect(new GLib.Variant('x', -Math.pow(2, 63)).unpack())
+            .toEqual(-Math.pow(2, 63));
+        expect(new GLib.Variant('t', Math.pow(2, 53)).unpack())
+            .toEqual(Math.pow(2, 53));
+    });
+});
+
+describe('Byte arrays returned from C', function () {
+    let path;
+    beforeEach(function () {
+        path = GLib.build_filenamev([GLib.get_tmp_dir(),
+            'cjs-test-bytes-' + GLib.random_int()]);
+        GLib.file_set_contents(path, 'hello');
+    });
+
+    afterEach(function () {
+        imports.gi.Gio.File.new_for_path(path).delete(null);
+    });
+
+    it('hold the data of an owned C array', function () {
+        let [success, contents] = GLib.file_get_contents(path);
+        expect(success).toBeTruthy();
+        expect(contents.length).toEqual(5);
+        expect(contents.toString()).toEqual('hello');
+    });
+
+    it('can be modified', function () {
+        let [, contents] = GLib.file_get_contents(path);
+        contents[0] = 72;
+        expect(contents.toString()).toEqual('Hello');
+    });
+
+    it('are zero-filled when they grow', function () {
+        let [, contents] = GLib.file_get_contents(path);
+        contents.length = 64;
+        contents[100] = 1;
+        let grown = [];
+        for (let i = 5; i < 100; i++)
+            grown.push(contents[i]);
+        expect(grown.every(b => b === 0)).toBeTruthy();
+        expect(contents[100]).toEqual(1);
+    });
 });
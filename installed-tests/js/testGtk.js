@@ -1,6 +1,8 @@
+imports.gi.versions.Gdk = '3.0';
 imports.gi.versions.Gtk = '3.0';
 
 const ByteArray = imports.byteArray;
+const Gdk = imports.gi.Gdk;
 const Gtk = imports.gi.Gtk;
 const Lang = imports.lang;
 
@@ -114,4 +116,21 @@ describe('Gtk overrides', function () {
     it('sets CSS names on classes', function () {
         expect(Gtk.Widget.get_css_name.call(MyComplexGtkSubclass)).toEqual('complex-subclass');
     });
+
+    it('passes events to static-scope signal handlers', function () {
+        let win = new Gtk.Window({ type: Gtk.WindowType.TOPLEVEL });
+        win.realize();
+        let handledType = null;
+        win.connect('delete-event', (widget, event) => {
+            expect(event instanceof Gdk.Event).toBeTruthy();
+            handledType = event.get_event_type();
+            return true;
+        });
+
+        let event = new Gdk.Event(Gdk.EventType.DELETE);
+        expect(win.event(event)).toBeTruthy();
+        expect(handledType).toEqual(Gdk.EventType.DELETE);
+        expect(event.get_event_type()).toEqual(Gdk.EventType.DELETE);
+        win.destroy();
+    });
 });
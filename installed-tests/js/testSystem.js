@@ -1,4 +1,5 @@
 const System = imports.system;
+const GLib = imports.gi.GLib;
 const GObject = imports.gi.GObject;
 
 describe('System.addressOf()', function () {
@@ -28,3 +29,148 @@ describe('System.gc()', function () {
         expect(System.gc).not.toThrow();
     });
 });
+
+describe('System.startProfiler()', function () {
+    let filename;
+
+    beforeEach(function () {
+        filename = GLib.build_filenamev([GLib.get_tmp_dir(),
+            'cjs-test-profile-' + GLib.get_monotonic_time() + '.collapsed']);
+    });
+
+    afterEach(function () {
+        System.stopProfiler();
+        GLib.unlink(filename);
+    });
+
+    it('writes the profile when stopped', function () {
+        if (!System.startProfiler(filename, 5000))
+            pending('The profiler is not supported on this platform');
+
+        let then = GLib.get_monotonic_time();
+        while (GLib.get_monotonic_time() - then < 100000)
+            JSON.stringify({some: 'object'});
+        System.stopProfiler();
+
+        expect(GLib.file_test(filename, GLib.FileTest.EXISTS)).toBeTruthy();
+    });
+
+    it('refuses to start twice', function () {
+        if (!System.startProfiler(filename))
+            pending('The profiler is not supported on this platform');
+        expect(() => System.startProfiler(filename)).toThrow();
+    });
+});
+
+describe('System.getFunctionStats()', function () {
+    afterEach(function () {
+        System.setFunctionStatsEnabled(false);
+    });
+
+    it('counts calls into introspected functions', function () {
+        System.setFunctionStatsEnabled(true);
+        for (let i = 0; i < 10; i++)
+            GLib.get_monotonic_time();
+        System.setFunctionStatsEnabled(false);
+
+        let stats = System.getFunctionStats(1000)
+            .filter(s => s.name === 'GLib.get_monotonic_time');
+        expect(stats.length).toEqual(1);
+        expect(stats[0].calls).not.toBeLessThan(10);
+        expect(stats[0].exceptions).toEqual(0);
+    });
+});
+
+describe('System.dumpHeap()', function () {
+    let filename;
+
+    beforeEach(function () {
+        filename = GLib.build_filenamev([GLib.get_tmp_dir(),
+            'cjs-test-heap-' + GLib.get_monotonic_time() + '.heap']);
+    });
+
+    afterEach(function () {
+        GLib.unlink(filename);
+    });
+
+    it('annotates GObject wrappers', function () {
+        let object = new GObject.Object();
+        System.dumpHeap(filename);
+
+        let [, contents] = GLib.file_get_contents(filename);
+        contents = contents.toString();
+        expect(contents).toMatch(/^# GI wrappers\.$/m);
+        expect(contents).toMatch(/ gobject 0x[0-9a-f]+ GObject refcount=/);
+    });
+
+    it('throws if the file cannot be written', function () {
+        expect(() => System.dumpHeap('/nonexistent/dir/heap')).toThrow();
+    });
+});
+
+describe('System.getTypeCounts()', function () {
+    function find(kind, name) {
+        return System.getTypeCounts(kind).filter(c => c.name === name)[0];
+    }
+
+    it('counts wrappers by GType', function () {
+        let before = find('object', 'GObject');
+        let objects = [];
+        for (let i = 0; i < 5; i++)
+            objects.push(new GObject.Object());
+
+        let after = find('object', 'GObject');
+        expect(after.live).not.toBeLessThan(objects.length);
+        expect(after.total - (before ? before.total : 0)).toEqual(objects.length);
+        expect(after.peak).not.toBeLessThan(after.live);
+    });
+
+    it('counts signal connections', function () {
+        let object = new GObject.Object();
+        let id = object.connect('notify', () => {});
+
+        let count = find('signal', 'GObject::notify');
+        expect(count.live).not.toBeLessThan(1);
+        let live = count.live;
+
+        object.disconnect(id);
+        expect(find('signal', 'GObject::notify').live).toEqual(live - 1);
+    });
+
+    it('filters by kind', function () {
+        expect(System.getTypeCounts('signal').every(c => c.kind === 'signal'))
+            .toBeTruthy();
+    });
+});
+
+describe('System.getGCStats()', function () {
+    it('records garbage collections', function () {
+        let before = System.getGCStats();
+        System.gc();
+        let after = System.getGCStats();
+
+        expect(after.gcCount).toBeGreaterThan(before.gcCount);
+        expect(after.sliceCount).toBeGreaterThan(before.sliceCount);
+        expect(after.pauses.count).toBeGreaterThan(0);
+        expect(after.pauses.maxMs).not.toBeLessThan(after.pauses.minMs);
+        expect(after.heapBytesBefore).toBeGreaterThan(0);
+    });
+
+    it('records the reason for the last GC only if asked to', function () {
+        System.gc();
+        let reason = System.getGCStats().lastReason;
+        if (GLib.getenv('GJS_GC_REASON'))
+            expect(reason).not.toMatch(/^(none)?$/);
+        else
+            expect(reason).toEqual('');
+    });
+
+    it('sums the histogram buckets to the sample count', function () {
+        System.gc();
+        let slices = System.getGCStats().slices;
+        let total = slices.buckets.reduce((sum, b) => sum + b.count, 0);
+        expect(total).toEqual(slices.count);
+        expect(slices.buckets[slices.buckets.length - 1].limitMs)
+            .toEqual(Infinity);
+    });
+});
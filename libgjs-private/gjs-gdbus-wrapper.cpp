@@ -9,6 +9,9 @@
 enum {
     PROP_0,
     PROP_G_INTERFACE_INFO,
+    PROP_BATCH_LATENCY,
+    PROP_BATCH_MAX_SIZE,
+    PROP_BATCH_PRIORITY,
     PROP_LAST
 };
 
@@ -21,13 +24,32 @@ enum {
 
 static guint signals[SIGNAL_LAST];
 
+/* Property changes from all the implementations exported on a connection
+ * are flushed together, so that one busy object doesn't wake up the
+ * others' clients at different times */
+typedef struct {
+    GPtrArray *pending;  /* of GjsDBusImplementation, with a ref */
+    GSource   *source;
+    gint64     deadline;  /* monotonic time of the scheduled flush */
+} PropertiesBatch;
+
+static GQuark properties_batch_quark;
+
 struct _GjsDBusImplementationPrivate {
     GDBusInterfaceVTable  vtable;
     GDBusInterfaceInfo   *ifaceinfo;
 
-    // from gchar* to GVariant*
+    // from gchar* to GVariant*, or NULL if invalidated
     GHashTable           *outstanding_properties;
-    guint                 idle_id;
+    PropertiesBatch      *batch;
+
+    unsigned              batch_latency;
+    unsigned              batch_max_size;
+    int                   batch_priority;
+
+    GjsDBusMethodHandler  method_handler;
+    void                 *method_handler_data;
+    GDestroyNotify        method_handler_destroy;
 };
 
 G_DEFINE_TYPE(GjsDBusImplementation, gjs_dbus_implementation, G_TYPE_DBUS_INTERFACE_SKELETON)
@@ -44,7 +66,11 @@ gjs_dbus_implementation_method_call(GDBusConnection       *connection,
 {
     GjsDBusImplementation *self = GJS_DBUS_IMPLEMENTATION (user_data);
 
-    g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name, parameters, invocation);
+    if (self->priv->method_handler)
+        self->priv->method_handler(self, method_name, parameters, invocation,
+                                   self->priv->method_handler_data);
+    else
+        g_signal_emit(self, signals[SIGNAL_HANDLE_METHOD], 0, method_name, parameters, invocation);
     g_object_unref (invocation);
 }
 
@@ -87,6 +113,13 @@ gjs_dbus_implementation_property_set(GDBusConnection       *connection,
     return true;
 }
 
+static void
+maybe_variant_unref(void *data)
+{
+    if (data)
+        g_variant_unref((GVariant *) data);
+}
+
 static void
 gjs_dbus_implementation_init(GjsDBusImplementation *self) {
     GjsDBusImplementationPrivate *priv = G_TYPE_INSTANCE_GET_PRIVATE (self, GJS_TYPE_DBUS_IMPLEMENTATION, GjsDBusImplementationPrivate);
@@ -97,7 +130,7 @@ gjs_dbus_implementation_init(GjsDBusImplementation *self) {
     priv->vtable.get_property = gjs_dbus_implementation_property_get;
     priv->vtable.set_property = gjs_dbus_implementation_property_set;
 
-    priv->outstanding_properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+    priv->outstanding_properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, maybe_variant_unref);
 }
 
 static void
@@ -106,6 +139,8 @@ gjs_dbus_implementation_finalize(GObject *object) {
 
     g_dbus_interface_info_unref (self->priv->ifaceinfo);
     g_hash_table_unref (self->priv->outstanding_properties);
+    if (self->priv->method_handler_destroy)
+        self->priv->method_handler_destroy(self->priv->method_handler_data);
 
     G_OBJECT_CLASS(gjs_dbus_implementation_parent_class)->finalize(object);
 }
@@ -119,6 +154,35 @@ gjs_dbus_implementation_set_property(GObject *object, guint property_id, const G
     case PROP_G_INTERFACE_INFO:
         self->priv->ifaceinfo = (GDBusInterfaceInfo*) g_value_dup_boxed (value);
         break;
+    case PROP_BATCH_LATENCY:
+        self->priv->batch_latency = g_value_get_uint (value);
+        break;
+    case PROP_BATCH_MAX_SIZE:
+        self->priv->batch_max_size = g_value_get_uint (value);
+        break;
+    case PROP_BATCH_PRIORITY:
+        self->priv->batch_priority = g_value_get_int (value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+gjs_dbus_implementation_get_property(GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    GjsDBusImplementation *self = GJS_DBUS_IMPLEMENTATION (object);
+
+    switch (property_id) {
+    case PROP_BATCH_LATENCY:
+        g_value_set_uint (value, self->priv->batch_latency);
+        break;
+    case PROP_BATCH_MAX_SIZE:
+        g_value_set_uint (value, self->priv->batch_max_size);
+        break;
+    case PROP_BATCH_PRIORITY:
+        g_value_set_int (value, self->priv->batch_priority);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -165,6 +229,19 @@ gjs_dbus_implementation_get_properties (GDBusInterfaceSkeleton *skeleton) {
     return g_variant_builder_end(&builder);
 }
 
+static void
+properties_batch_remove (GjsDBusImplementation *self)
+{
+    PropertiesBatch *batch = self->priv->batch;
+
+    if (!batch)
+        return;
+
+    self->priv->batch = NULL;
+    /* drops the batch's reference, so this must be the last thing we do */
+    g_ptr_array_remove_fast (batch->pending, self);
+}
+
 static void
 gjs_dbus_implementation_flush (GDBusInterfaceSkeleton *skeleton) {
     GjsDBusImplementation *self = GJS_DBUS_IMPLEMENTATION (skeleton);
@@ -174,6 +251,15 @@ gjs_dbus_implementation_flush (GDBusInterfaceSkeleton *skeleton) {
     GHashTableIter iter;
     GVariant *val;
     gchar *prop_name;
+    GList *connections, *l;
+
+    g_object_ref (self);
+    properties_batch_remove (self);
+
+    if (g_hash_table_size (self->priv->outstanding_properties) == 0) {
+        g_object_unref (self);
+        return;
+    }
 
     g_variant_builder_init(&changed_props, G_VARIANT_TYPE_VARDICT);
     g_variant_builder_init(&invalidated_props, G_VARIANT_TYPE_STRING_ARRAY);
@@ -186,22 +272,27 @@ gjs_dbus_implementation_flush (GDBusInterfaceSkeleton *skeleton) {
             g_variant_builder_add(&invalidated_props, "s", prop_name);
     }
 
-    g_dbus_connection_emit_signal(g_dbus_interface_skeleton_get_connection(skeleton),
-                                  NULL, /* bus name */
-                                  g_dbus_interface_skeleton_get_object_path(skeleton),
-                                  "org.freedesktop.DBus.Properties",
-                                  "PropertiesChanged",
-                                  g_variant_new("(s@a{sv}@as)",
-                                                self->priv->ifaceinfo->name,
-                                                g_variant_builder_end(&changed_props),
-                                                g_variant_builder_end(&invalidated_props)),
-                                   NULL /* error */);
+    /* Build the signal once, for every connection we are exported on */
+    GVariant *parameters = g_variant_ref_sink(g_variant_new("(s@a{sv}@as)",
+                                                            self->priv->ifaceinfo->name,
+                                                            g_variant_builder_end(&changed_props),
+                                                            g_variant_builder_end(&invalidated_props)));
+
+    connections = g_dbus_interface_skeleton_get_connections(skeleton);
+    for (l = connections; l; l = l->next) {
+        g_dbus_connection_emit_signal(G_DBUS_CONNECTION(l->data),
+                                      NULL, /* bus name */
+                                      g_dbus_interface_skeleton_get_object_path(skeleton),
+                                      "org.freedesktop.DBus.Properties",
+                                      "PropertiesChanged",
+                                      parameters,
+                                      NULL /* error */);
+    }
+    g_list_free_full(connections, g_object_unref);
+    g_variant_unref(parameters);
 
     g_hash_table_remove_all(self->priv->outstanding_properties);
-    if (self->priv->idle_id) {
-        g_source_remove(self->priv->idle_id);
-        self->priv->idle_id = 0;
-    }
+    g_object_unref (self);
 }
 
 void
@@ -213,6 +304,7 @@ gjs_dbus_implementation_class_init(GjsDBusImplementationClass *klass) {
 
     gobject_class->finalize = gjs_dbus_implementation_finalize;
     gobject_class->set_property = gjs_dbus_implementation_set_property;
+    gobject_class->get_property = gjs_dbus_implementation_get_property;
 
     skeleton_class->get_info = gjs_dbus_implementation_get_info;
     skeleton_class->get_vtable = gjs_dbus_implementation_get_vtable;
@@ -226,6 +318,29 @@ gjs_dbus_implementation_class_init(GjsDBusImplementationClass *klass) {
                                                        G_TYPE_DBUS_INTERFACE_INFO,
                                                        (GParamFlags) (G_PARAM_STATIC_STRINGS | G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY)));
 
+    g_object_class_install_property(gobject_class, PROP_BATCH_LATENCY,
+                                    g_param_spec_uint("batch-latency",
+                                                      "Batch latency",
+                                                      "Longest time in milliseconds that a property change waits before being signalled",
+                                                      0, G_MAXUINT, 10,
+                                                      (GParamFlags) (G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE | G_PARAM_CONSTRUCT)));
+
+    g_object_class_install_property(gobject_class, PROP_BATCH_MAX_SIZE,
+                                    g_param_spec_uint("batch-max-size",
+                                                      "Batch maximum size",
+                                                      "Number of changed properties that are signalled right away, or 0 for no limit",
+                                                      0, G_MAXUINT, 0,
+                                                      (GParamFlags) (G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE | G_PARAM_CONSTRUCT)));
+
+    g_object_class_install_property(gobject_class, PROP_BATCH_PRIORITY,
+                                    g_param_spec_int("batch-priority",
+                                                     "Batch priority",
+                                                     "Main loop priority at which property changes are signalled",
+                                                     G_MININT, G_MAXINT, G_PRIORITY_DEFAULT,
+                                                     (GParamFlags) (G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE | G_PARAM_CONSTRUCT)));
+
+    properties_batch_quark = g_quark_from_static_string("gjs-dbus-properties-batch");
+
     signals[SIGNAL_HANDLE_METHOD] = g_signal_new("handle-method-call",
                                                  G_TYPE_FROM_CLASS(klass),
                                                  (GSignalFlags) 0, /* flags */
@@ -264,14 +379,110 @@ gjs_dbus_implementation_class_init(GjsDBusImplementationClass *klass) {
                                                        G_TYPE_VARIANT /* parameters */);
 }
 
-static gboolean
-idle_cb (gpointer data) {
-    GDBusInterfaceSkeleton *skeleton = G_DBUS_INTERFACE_SKELETON (data);
+static void
+properties_batch_flush (PropertiesBatch *batch)
+{
+    GPtrArray *pending = batch->pending;
 
-    g_dbus_interface_skeleton_flush(skeleton);
+    if (batch->source) {
+        g_source_destroy(batch->source);
+        g_source_unref(batch->source);
+        batch->source = NULL;
+    }
+
+    /* Flushing would remove each implementation from the batch, so take
+     * them out first */
+    batch->pending = g_ptr_array_new_with_free_func(g_object_unref);
+    for (unsigned i = 0; i < pending->len; i++) {
+        auto self = GJS_DBUS_IMPLEMENTATION(g_ptr_array_index(pending, i));
+        self->priv->batch = NULL;
+        g_dbus_interface_skeleton_flush(G_DBUS_INTERFACE_SKELETON(self));
+    }
+    g_ptr_array_unref(pending);
+}
+
+static gboolean
+properties_batch_timeout (gpointer data)
+{
+    properties_batch_flush((PropertiesBatch *) data);
     return G_SOURCE_REMOVE;
 }
 
+static void
+properties_batch_free (void *data)
+{
+    auto batch = static_cast<PropertiesBatch *>(data);
+
+    if (batch->source) {
+        g_source_destroy(batch->source);
+        g_source_unref(batch->source);
+    }
+    for (unsigned i = 0; i < batch->pending->len; i++)
+        GJS_DBUS_IMPLEMENTATION(g_ptr_array_index(batch->pending, i))->priv->batch = NULL;
+    g_ptr_array_unref(batch->pending);
+    g_slice_free(PropertiesBatch, batch);
+}
+
+static PropertiesBatch *
+properties_batch_get (GDBusConnection *connection)
+{
+    auto batch = static_cast<PropertiesBatch *>(g_object_get_qdata(G_OBJECT(connection),
+                                                                   properties_batch_quark));
+    if (batch)
+        return batch;
+
+    batch = g_slice_new0(PropertiesBatch);
+    batch->pending = g_ptr_array_new_with_free_func(g_object_unref);
+    g_object_set_qdata_full(G_OBJECT(connection), properties_batch_quark,
+                            batch, properties_batch_free);
+    return batch;
+}
+
+/* Joins the batch of the connection we are exported on, bringing the
+ * batch's flush forward if our latency is shorter or our priority higher */
+static void
+properties_batch_add (GjsDBusImplementation *self)
+{
+    GjsDBusImplementationPrivate *priv = self->priv;
+    GDBusConnection *connection;
+    PropertiesBatch *batch;
+    gint64 now, deadline;
+    int priority;
+
+    if (!priv->batch) {
+        connection = g_dbus_interface_skeleton_get_connection(G_DBUS_INTERFACE_SKELETON(self));
+        /* Not exported; the changes will be signalled on the next flush */
+        if (!connection)
+            return;
+
+        batch = properties_batch_get(connection);
+        g_ptr_array_add(batch->pending, g_object_ref(self));
+        priv->batch = batch;
+    }
+    batch = priv->batch;
+
+    now = g_get_monotonic_time();
+    deadline = now + priv->batch_latency * G_GINT64_CONSTANT(1000);
+    priority = priv->batch_priority;
+
+    if (batch->source) {
+        if (batch->deadline <= deadline &&
+            g_source_get_priority(batch->source) <= priority)
+            return;
+
+        deadline = MIN(deadline, batch->deadline);
+        priority = MIN(priority, g_source_get_priority(batch->source));
+        g_source_destroy(batch->source);
+        g_source_unref(batch->source);
+    }
+
+    batch->deadline = deadline;
+    batch->source = g_timeout_source_new((guint) (MAX(deadline - now, 0) / 1000));
+    g_source_set_priority(batch->source, priority);
+    g_source_set_callback(batch->source, properties_batch_timeout, batch, NULL);
+    g_source_attach(batch->source, NULL);
+}
+
 /**
  * gjs_dbus_implementation_emit_property_changed:
  * @self: a #GjsDBusImplementation
@@ -279,17 +490,34 @@ idle_cb (gpointer data) {
  * @newvalue: (allow-none): the new value, or %NULL to just invalidate it
  *
  * Queue a PropertyChanged signal for emission, or update the one queued
- * adding @property
+ * adding @property.
+ *
+ * The signal is emitted within #GjsDBusImplementation:batch-latency
+ * milliseconds, together with those queued by other implementations
+ * exported on the same connection, or as soon as
+ * #GjsDBusImplementation:batch-max-size properties are queued.
  */
 void
 gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self,
                                                gchar                 *property,
                                                GVariant              *newvalue)
 {
-    g_hash_table_replace (self->priv->outstanding_properties, g_strdup (property), g_variant_ref (newvalue));
+    GjsDBusImplementationPrivate *priv = self->priv;
+
+    g_hash_table_replace (priv->outstanding_properties, g_strdup (property),
+                          newvalue ? g_variant_ref_sink (newvalue) : NULL);
+
+    if (priv->batch_max_size &&
+        g_hash_table_size (priv->outstanding_properties) >= priv->batch_max_size) {
+        /* Take the rest of the batch with us */
+        if (priv->batch)
+            properties_batch_flush (priv->batch);
+        else
+            g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (self));
+        return;
+    }
 
-    if (!self->priv->idle_id)
-        self->priv->idle_id = g_idle_add(idle_cb, self);
+    properties_batch_add (self);
 }
 
 /**
@@ -316,3 +544,31 @@ gjs_dbus_implementation_emit_signal (GjsDBusImplementation *self,
                                   parameters,
                                   NULL);
 }
+
+/**
+ * gjs_dbus_implementation_set_method_handler: (skip)
+ * @self: a #GjsDBusImplementation
+ * @handler: function to call for each incoming method call
+ * @user_data: data to pass to @handler
+ * @destroy: function to free @user_data when @self is finalized
+ *
+ * Makes @self call @handler directly for incoming method calls, instead of
+ * emitting #GjsDBusImplementation::handle-method-call. Like the signal
+ * handlers, @handler must reply to the invocation, and must take a
+ * reference to it if it does so asynchronously.
+ */
+void
+gjs_dbus_implementation_set_method_handler (GjsDBusImplementation *self,
+                                            GjsDBusMethodHandler   handler,
+                                            void                  *user_data,
+                                            GDestroyNotify         destroy)
+{
+    GjsDBusImplementationPrivate *priv = self->priv;
+
+    if (priv->method_handler_destroy)
+        priv->method_handler_destroy(priv->method_handler_data);
+
+    priv->method_handler = handler;
+    priv->method_handler_data = user_data;
+    priv->method_handler_destroy = destroy;
+}
@@ -52,11 +52,18 @@ struct _GjsDBusImplementationClass {
     GDBusInterfaceSkeletonClass parent_class;
 };
 
+typedef void (*GjsDBusMethodHandler) (GjsDBusImplementation *self,
+                                      const char            *method_name,
+                                      GVariant              *parameters,
+                                      GDBusMethodInvocation *invocation,
+                                      void                  *user_data);
+
 GJS_EXPORT
 GType                  gjs_dbus_implementation_get_type (void);
 
 void                   gjs_dbus_implementation_emit_property_changed (GjsDBusImplementation *self, gchar *property, GVariant *newvalue);
 void                   gjs_dbus_implementation_emit_signal           (GjsDBusImplementation *self, gchar *signal_name, GVariant *parameters);
+void                   gjs_dbus_implementation_set_method_handler    (GjsDBusImplementation *self, GjsDBusMethodHandler handler, void *user_data, GDestroyNotify destroy);
 
 G_END_DECLS
 
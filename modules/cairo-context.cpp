@@ -260,6 +260,8 @@ _gjs_cairo_context_construct_internal(JSContext       *context,
     priv->context = context;
     priv->object = obj;
     priv->cr = cairo_reference(cr);
+
+    gjs_cairo_wrapper_cache_insert(context, GJS_CAIRO_WRAPPER_CONTEXT, cr, obj);
 }
 
 GJS_NATIVE_CONSTRUCTOR_DECLARE(cairo_context)
@@ -402,6 +404,10 @@ dispose_func(JSContext *context,
     GJS_GET_PRIV(context, argc, vp, rec, obj, GjsCairoContext, priv);
 
     if (priv->cr != NULL) {
+        /* The cairo_t may outlive us; don't hand out a disposed wrapper */
+        if (gjs_cairo_wrapper_cache_lookup(context, GJS_CAIRO_WRAPPER_CONTEXT,
+                                           priv->cr) == obj)
+            gjs_cairo_wrapper_cache_remove(GJS_CAIRO_WRAPPER_CONTEXT, priv->cr);
         cairo_destroy(priv->cr);
         priv->cr = NULL;
     }
@@ -468,6 +474,149 @@ copyPathFlat_func(JSContext *context,
     return true;
 }
 
+/* Opcodes for drawPath(); the first four match cairo_path_data_type_t.
+ * Keep in sync with PathOp in cairo.js. */
+typedef enum {
+    PATH_OP_MOVE_TO,
+    PATH_OP_LINE_TO,
+    PATH_OP_CURVE_TO,
+    PATH_OP_CLOSE_PATH,
+    PATH_OP_REL_MOVE_TO,
+    PATH_OP_REL_LINE_TO,
+    PATH_OP_REL_CURVE_TO,
+    PATH_OP_ARC,
+    PATH_OP_ARC_NEGATIVE,
+    PATH_OP_RECTANGLE,
+    PATH_OP_NEW_SUB_PATH,
+    PATH_OP_NEW_PATH,
+    PATH_OP_LAST
+} GjsCairoPathOp;
+
+static const unsigned path_op_n_args[PATH_OP_LAST] = {
+    2, 2, 6, 0, 2, 2, 6, 5, 5, 4, 0, 0
+};
+
+/* Replays @n_ops doubles worth of opcodes and their operands on @cr. Returns
+ * false and the position of the offending opcode if the data is malformed;
+ * everything before that position has been applied. */
+static bool
+replay_path_ops(cairo_t      *cr,
+                const double *ops,
+                size_t        n_ops,
+                size_t       *error_pos)
+{
+    size_t i = 0;
+
+    while (i < n_ops) {
+        double op = ops[i];
+        if (!(op >= 0 && op < PATH_OP_LAST) || op != unsigned(op) ||
+            n_ops - i - 1 < path_op_n_args[unsigned(op)]) {
+            *error_pos = i;
+            return false;
+        }
+
+        const double *a = &ops[i + 1];
+        switch (GjsCairoPathOp(op)) {
+        case PATH_OP_MOVE_TO:
+            cairo_move_to(cr, a[0], a[1]);
+            break;
+        case PATH_OP_LINE_TO:
+            cairo_line_to(cr, a[0], a[1]);
+            break;
+        case PATH_OP_CURVE_TO:
+            cairo_curve_to(cr, a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case PATH_OP_CLOSE_PATH:
+            cairo_close_path(cr);
+            break;
+        case PATH_OP_REL_MOVE_TO:
+            cairo_rel_move_to(cr, a[0], a[1]);
+            break;
+        case PATH_OP_REL_LINE_TO:
+            cairo_rel_line_to(cr, a[0], a[1]);
+            break;
+        case PATH_OP_REL_CURVE_TO:
+            cairo_rel_curve_to(cr, a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case PATH_OP_ARC:
+            cairo_arc(cr, a[0], a[1], a[2], a[3], a[4]);
+            break;
+        case PATH_OP_ARC_NEGATIVE:
+            cairo_arc_negative(cr, a[0], a[1], a[2], a[3], a[4]);
+            break;
+        case PATH_OP_RECTANGLE:
+            cairo_rectangle(cr, a[0], a[1], a[2], a[3]);
+            break;
+        case PATH_OP_NEW_SUB_PATH:
+            cairo_new_sub_path(cr);
+            break;
+        case PATH_OP_NEW_PATH:
+            cairo_new_path(cr);
+            break;
+        default:
+            g_assert_not_reached();
+        }
+
+        i += 1 + path_op_n_args[unsigned(op)];
+    }
+
+    return true;
+}
+
+/* drawPath(ops): issues a whole sequence of path construction calls in one
+ * go. @ops is a Float64Array (or, more slowly, an array of numbers) of
+ * Cairo.PathOp opcodes, each followed by the arguments the corresponding
+ * context method takes. */
+static bool
+drawPath_func(JSContext *context,
+              unsigned   argc,
+              JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, argv, obj, GjsCairoContext, priv);
+    JS::RootedObject ops(context);
+    cairo_t *cr = priv ? priv->cr : NULL;
+    size_t error_pos;
+    bool ok;
+
+    if (!gjs_parse_call_args(context, "drawPath", argv, "o",
+                             "ops", &ops))
+        return false;
+
+    if (JS_IsFloat64Array(ops)) {
+        JS::AutoCheckCannotGC nogc;
+        ok = replay_path_ops(cr, JS_GetFloat64ArrayData(ops, nogc),
+                             JS_GetTypedArrayLength(ops), &error_pos);
+    } else if (JS_IsArrayObject(context, ops)) {
+        guint len;
+        if (!JS_GetArrayLength(context, ops, &len))
+            return false;
+
+        std::vector<double> ops_c(len);
+        JS::RootedValue elem(context);
+        for (guint i = 0; i < len; ++i) {
+            if (!JS_GetElement(context, ops, i, &elem) ||
+                !JS::ToNumber(context, elem, &ops_c[i]))
+                return false;
+        }
+        ok = replay_path_ops(cr, ops_c.data(), len, &error_pos);
+    } else {
+        gjs_throw(context, "drawPath() expects a Float64Array or an array");
+        return false;
+    }
+
+    if (!ok) {
+        gjs_throw(context, "Invalid or truncated path operation at index %"
+                  G_GSIZE_FORMAT, error_pos);
+        return false;
+    }
+
+    if (!gjs_cairo_check_status(context, cairo_status(cr), "context"))
+        return false;
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 static bool
 mask_func(JSContext *context,
           unsigned   argc,
@@ -836,6 +985,7 @@ JSFunctionSpec gjs_cairo_context_proto_funcs[] = {
     JS_FS("curveTo", curveTo_func, 0, 0),
     JS_FS("deviceToUser", deviceToUser_func, 0, 0),
     JS_FS("deviceToUserDistance", deviceToUserDistance_func, 0, 0),
+    JS_FS("drawPath", drawPath_func, 0, 0),
     JS_FS("fill", fill_func, 0, 0),
     JS_FS("fillPreserve", fillPreserve_func, 0, 0),
     JS_FS("fillExtents", fillExtents_func, 0, 0),
@@ -929,6 +1079,12 @@ JSObject *
 gjs_cairo_context_from_context(JSContext *context,
                                cairo_t *cr)
 {
+    JSObject *cached = gjs_cairo_wrapper_cache_lookup(context,
+                                                      GJS_CAIRO_WRAPPER_CONTEXT,
+                                                      cr);
+    if (cached)
+        return cached;
+
     JS::RootedObject proto(context, gjs_cairo_context_get_proto(context));
     JS::RootedObject object(context,
         JS_NewObjectWithGivenProto(context, &gjs_cairo_context_class, proto));
@@ -22,17 +22,161 @@
 
 #include <config.h>
 
+#include <mutex>
+#include <set>
+
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
 #include "cjs/jsapi-util-args.h"
+#include "cjs/jsapi-util-root.h"
 #include "cjs/jsapi-wrapper.h"
 #include <cairo.h>
 #include "cairo-private.h"
 
 static JSObject *gjs_cairo_image_surface_get_proto(JSContext *);
 
+/* Not background-finalized: dropping the last reference to a surface whose
+ * pixels live in a JS ArrayBuffer unroots that buffer, which must happen on
+ * the main thread. */
 GJS_DEFINE_PROTO_WITH_PARENT("ImageSurface", cairo_image_surface,
-                             cairo_surface, JSCLASS_BACKGROUND_FINALIZE)
+                             cairo_surface, 0)
+
+/* Image surfaces created from JS keep their pixels in an ArrayBuffer, so that
+ * getData() can hand out views on them without copying. The buffer is kept
+ * alive for as long as the cairo surface is, not just as long as the wrapper,
+ * since C code may hold on to the surface. */
+typedef struct {
+    GjsMaybeOwned<JSObject *> buffer;
+    void *contents;
+    cairo_surface_t *surface;  /* NULL once the surface is gone */
+    intptr_t owner_thread;
+    GMainContext *main_context;
+} GjsCairoImageData;
+
+static cairo_user_data_key_t image_data_key;
+
+/* Pixel storage currently in use by a surface, so that createForData() can
+ * tell a buffer that came from getData() from one it may take over */
+static std::mutex attached_contents_lock;
+static std::set<void *> attached_contents;
+
+static bool
+contents_are_attached(void *contents)
+{
+    std::lock_guard<std::mutex> hold(attached_contents_lock);
+    return attached_contents.count(contents) > 0;
+}
+
+static void
+image_data_destroy(GjsCairoImageData *image_data)
+{
+    {
+        std::lock_guard<std::mutex> hold(attached_contents_lock);
+        attached_contents.erase(image_data->contents);
+    }
+    g_main_context_unref(image_data->main_context);
+    delete image_data;
+}
+
+static gboolean
+image_data_idle_destroy(void *data)
+{
+    image_data_destroy(static_cast<GjsCairoImageData *>(data));
+    return G_SOURCE_REMOVE;
+}
+
+/* The last reference to the surface may be dropped on the background
+ * finalization thread, by a context or pattern wrapper. Unrooting the buffer
+ * is only allowed on the thread that owns the JS context, so in that case it
+ * is deferred to that thread's main loop. */
+static void
+image_data_free(void *data)
+{
+    auto image_data = static_cast<GjsCairoImageData *>(data);
+
+    image_data->surface = NULL;
+    if (image_data->owner_thread == JS_GetCurrentThread()) {
+        image_data_destroy(image_data);
+        return;
+    }
+
+    GSource *source = g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_HIGH);
+    g_source_set_callback(source, image_data_idle_destroy, image_data, NULL);
+    g_source_attach(source, image_data->main_context);
+    g_source_unref(source);
+}
+
+/* If the JS context goes away before the surface does, make sure cairo stops
+ * touching the memory that is about to be freed along with the buffer. */
+static void
+image_data_on_context_destroy(JS::HandleObject buffer,
+                              void            *data)
+{
+    auto image_data = static_cast<GjsCairoImageData *>(data);
+    if (image_data->surface)
+        cairo_surface_finish(image_data->surface);
+}
+
+/* Takes ownership of @contents, which must be allocated with g_malloc() and
+ * hold at least @stride * @height bytes. */
+static cairo_surface_t *
+image_surface_new_for_contents(JSContext     *context,
+                               void          *contents,
+                               cairo_format_t format,
+                               int            width,
+                               int            height,
+                               int            stride)
+{
+    JS::RootedObject buffer(context,
+        JS_NewArrayBufferWithContents(context, stride * height, contents));
+    if (!buffer) {
+        g_free(contents);
+        return NULL;
+    }
+
+    cairo_surface_t *surface =
+        cairo_image_surface_create_for_data(static_cast<unsigned char *>(contents),
+                                            format, width, height, stride);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface")) {
+        cairo_surface_destroy(surface);
+        return NULL;
+    }
+
+    auto image_data = new GjsCairoImageData;
+    image_data->contents = contents;
+    image_data->surface = surface;
+    image_data->owner_thread = JS_GetCurrentThread();
+    image_data->main_context = g_main_context_ref_thread_default();
+    image_data->buffer.root(context, buffer, image_data_on_context_destroy,
+                            image_data);
+    {
+        std::lock_guard<std::mutex> hold(attached_contents_lock);
+        attached_contents.insert(contents);
+    }
+    cairo_surface_set_user_data(surface, &image_data_key, image_data,
+                                image_data_free);
+    return surface;
+}
+
+static cairo_surface_t *
+image_surface_new(JSContext     *context,
+                  cairo_format_t format,
+                  int            width,
+                  int            height)
+{
+    int stride = cairo_format_stride_for_width(format, width);
+    if (stride < 0 || height < 0 || (height > 0 && stride > G_MAXINT / height)) {
+        gjs_throw(context, "Invalid image surface size %dx%d", width, height);
+        return NULL;
+    }
+
+    /* Assumes that g_malloc == js_malloc == malloc, as does
+     * gjs_string_from_utf8() */
+    void *contents = g_malloc0(MAX(stride * height, 1));
+    return image_surface_new_for_contents(context, contents, format, width,
+                                          height, stride);
+}
 
 GJS_NATIVE_CONSTRUCTOR_DECLARE(cairo_image_surface)
 {
@@ -42,16 +186,14 @@ GJS_NATIVE_CONSTRUCTOR_DECLARE(cairo_image_surface)
 
     GJS_NATIVE_CONSTRUCTOR_PRELUDE(cairo_image_surface);
 
-    // create_for_data optional parameter
     if (!gjs_parse_call_args(context, "ImageSurface", argv, "iii",
                              "format", &format,
                              "width", &width,
                              "height", &height))
         return false;
 
-    surface = cairo_image_surface_create((cairo_format_t) format, width, height);
-
-    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+    surface = image_surface_new(context, (cairo_format_t) format, width, height);
+    if (!surface)
         return false;
 
     gjs_cairo_surface_construct(context, object, surface);
@@ -80,15 +222,123 @@ createFromPNG_func(JSContext *context,
 {
     JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
     char *filename;
-    cairo_surface_t *surface;
+    cairo_surface_t *surface, *png_surface;
+    cairo_t *cr;
 
     if (!gjs_parse_call_args(context, "createFromPNG", argv, "s",
                              "filename", &filename))
         return false;
 
-    surface = cairo_image_surface_create_from_png(filename);
+    png_surface = cairo_image_surface_create_from_png(filename);
 
-    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+    if (!gjs_cairo_check_status(context, cairo_surface_status(png_surface), "surface")) {
+        cairo_surface_destroy(png_surface);
+        return false;
+    }
+
+    /* One copy at load time, so that getData() works without copying later */
+    surface = image_surface_new(context,
+                                cairo_image_surface_get_format(png_surface),
+                                cairo_image_surface_get_width(png_surface),
+                                cairo_image_surface_get_height(png_surface));
+    if (!surface) {
+        cairo_surface_destroy(png_surface);
+        return false;
+    }
+
+    cr = cairo_create(surface);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, png_surface, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_destroy(png_surface);
+
+    JS::RootedObject proto(context, gjs_cairo_image_surface_get_proto(context));
+    JS::RootedObject surface_wrapper(context,
+        JS_NewObjectWithGivenProto(context, &gjs_cairo_image_surface_class,
+                                   proto));
+    if (!surface_wrapper) {
+        cairo_surface_destroy(surface);
+        gjs_throw(context, "failed to create surface");
+        return false;
+    }
+    gjs_cairo_surface_construct(context, surface_wrapper, surface);
+    cairo_surface_destroy(surface);
+
+    argv.rval().setObject(*surface_wrapper);
+    return true;
+}
+
+static bool
+createForData_func(JSContext *context,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    JS::RootedObject data(context);
+    int format, width, height, stride = -1;
+    cairo_surface_t *surface;
+    size_t n_bytes;
+    void *contents;
+
+    if (!gjs_parse_call_args(context, "createForData", argv, "oiii|i",
+                             "data", &data,
+                             "format", &format,
+                             "width", &width,
+                             "height", &height,
+                             "stride", &stride))
+        return false;
+
+    if (stride < 0)
+        stride = cairo_format_stride_for_width((cairo_format_t) format, width);
+    if (stride < 0 || height < 0 || (height > 0 && stride > G_MAXINT / height)) {
+        gjs_throw(context, "Invalid image surface size %dx%d", width, height);
+        return false;
+    }
+
+    JS::RootedObject buffer(context);
+    if (JS_IsArrayBufferObject(data)) {
+        buffer = data;
+    } else if (JS_IsArrayBufferViewObject(data)) {
+        if (JS_GetArrayBufferViewByteLength(data) !=
+            JS_GetArrayBufferByteLength(JS_GetArrayBufferViewBuffer(context, data))) {
+            gjs_throw(context, "createForData() needs a typed array covering "
+                      "its whole buffer");
+            return false;
+        }
+        buffer = JS_GetArrayBufferViewBuffer(context, data);
+    } else {
+        gjs_throw(context, "createForData() expects an ArrayBuffer or typed array");
+        return false;
+    }
+
+    n_bytes = JS_GetArrayBufferByteLength(buffer);
+    if (n_bytes < size_t(stride) * height) {
+        gjs_throw(context, "Buffer of %" G_GSIZE_FORMAT " bytes is too small for a %dx%d "
+                  "surface with stride %d", n_bytes, width, height, stride);
+        return false;
+    }
+
+    /* The pixels are transferred into the surface rather than shared, since
+     * only a buffer we allocated is guaranteed not to move. Afterwards the
+     * passed-in array is detached and getData() gives access to the pixels.
+     * A buffer that another surface draws into can't be taken over, so its
+     * pixels are copied instead. */
+    {
+        JS::AutoCheckCannotGC nogc;
+        void *data = JS_GetArrayBufferData(buffer, nogc);
+        contents = contents_are_attached(data) ? g_memdup(data, n_bytes) : NULL;
+    }
+    if (!contents) {
+        contents = JS_StealArrayBufferContents(context, buffer);
+        if (!contents)
+            return false;
+    }
+
+    surface = image_surface_new_for_contents(context, contents,
+                                             (cairo_format_t) format,
+                                             width, height, stride);
+    if (!surface)
         return false;
 
     JS::RootedObject proto(context, gjs_cairo_image_surface_get_proto(context));
@@ -96,6 +346,7 @@ createFromPNG_func(JSContext *context,
         JS_NewObjectWithGivenProto(context, &gjs_cairo_image_surface_class,
                                    proto));
     if (!surface_wrapper) {
+        cairo_surface_destroy(surface);
         gjs_throw(context, "failed to create surface");
         return false;
     }
@@ -106,6 +357,49 @@ createFromPNG_func(JSContext *context,
     return true;
 }
 
+static bool
+getData_func(JSContext *context,
+             unsigned   argc,
+             JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, rec, obj);
+    cairo_surface_t *surface;
+    GjsCairoImageData *image_data;
+
+    if (argc > 1) {
+        gjs_throw(context, "ImageSurface.getData() takes no arguments");
+        return false;
+    }
+
+    surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    image_data = static_cast<GjsCairoImageData *>(
+        cairo_surface_get_user_data(surface, &image_data_key));
+    if (!image_data) {
+        gjs_throw(context, "ImageSurface.getData() is only available for "
+                  "surfaces created from JS; paint this one onto a new "
+                  "ImageSurface first");
+        return false;
+    }
+
+    /* Let cairo finish any pending drawing before JS looks at the pixels.
+     * After writing to them, call markDirty(). */
+    cairo_surface_flush(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface), "surface"))
+        return false;
+
+    JS::RootedObject buffer(context, image_data->buffer);
+    JS::RootedObject array(context,
+        JS_NewUint8ClampedArrayWithBuffer(context, buffer, 0, -1));
+    if (!array)
+        return false;
+
+    rec.rval().setObject(*array);
+    return true;
+}
+
 static bool
 getFormat_func(JSContext *context,
                unsigned   argc,
@@ -204,7 +498,7 @@ getStride_func(JSContext *context,
 
 JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
     JS_FS("createFromPNG", createFromPNG_func, 0, 0),
-    // getData
+    JS_FS("getData", getData_func, 0, 0),
     JS_FS("getFormat", getFormat_func, 0, 0),
     JS_FS("getWidth", getWidth_func, 0, 0),
     JS_FS("getHeight", getHeight_func, 0, 0),
@@ -214,6 +508,7 @@ JSFunctionSpec gjs_cairo_image_surface_proto_funcs[] = {
 
 JSFunctionSpec gjs_cairo_image_surface_static_funcs[] = {
     JS_FS("createFromPNG", createFromPNG_func, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS("createForData", createForData_func, 4, GJS_MODULE_PROP_FLAGS),
     JS_FS_END
 };
 
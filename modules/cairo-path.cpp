@@ -22,8 +22,11 @@
 
 #include <config.h>
 
+#include <vector>
+
 #include "cjs/jsapi-class.h"
 #include "cjs/jsapi-util.h"
+#include "cjs/jsapi-util-args.h"
 #include "cjs/jsapi-wrapper.h"
 #include <cairo.h>
 #include "cairo-private.h"
@@ -36,9 +39,127 @@ typedef struct {
 
 static JSObject *gjs_cairo_path_get_proto(JSContext *);
 
-GJS_DEFINE_PROTO_ABSTRACT("Path", cairo_path, JSCLASS_BACKGROUND_FINALIZE)
+GJS_DEFINE_PROTO("Path", cairo_path, JSCLASS_BACKGROUND_FINALIZE)
 GJS_DEFINE_PRIV_FROM_JS(GjsCairoPath, gjs_cairo_path_class)
 
+/* Paths are converted to and from the same flat format that
+ * Context.drawPath() takes: a cairo_path_data_type_t (which are the first
+ * four Cairo.PathOp values) followed by the coordinates of its points. */
+static unsigned
+path_op_n_points(cairo_path_data_type_t type)
+{
+    switch (type) {
+    case CAIRO_PATH_MOVE_TO:
+    case CAIRO_PATH_LINE_TO:
+        return 1;
+    case CAIRO_PATH_CURVE_TO:
+        return 3;
+    case CAIRO_PATH_CLOSE_PATH:
+        return 0;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* Builds a cairo_path_t from @n_ops doubles of path operations; returns NULL
+ * and the position of the offending opcode if they are malformed. */
+static cairo_path_t *
+path_from_ops(const double *ops,
+              size_t        n_ops,
+              size_t       *error_pos)
+{
+    size_t i, n_data = 0;
+
+    for (i = 0; i < n_ops; ) {
+        double op = ops[i];
+        if (!(op >= CAIRO_PATH_MOVE_TO && op <= CAIRO_PATH_CLOSE_PATH) ||
+            op != unsigned(op) ||
+            (n_ops - i - 1) / 2 < path_op_n_points(cairo_path_data_type_t(op))) {
+            *error_pos = i;
+            return NULL;
+        }
+        unsigned n_points = path_op_n_points(cairo_path_data_type_t(op));
+        n_data += 1 + n_points;
+        i += 1 + 2 * n_points;
+    }
+
+    /* cairo_path_destroy() frees with free(); assumes g_malloc == malloc */
+    cairo_path_t *path = g_new0(cairo_path_t, 1);
+    path->status = CAIRO_STATUS_SUCCESS;
+    path->num_data = n_data;
+    path->data = g_new(cairo_path_data_t, MAX(n_data, 1));
+
+    cairo_path_data_t *data = path->data;
+    for (i = 0; i < n_ops; ) {
+        auto type = cairo_path_data_type_t(ops[i]);
+        unsigned n_points = path_op_n_points(type);
+
+        data->header.type = type;
+        data->header.length = 1 + n_points;
+        data++;
+        i++;
+        for (unsigned j = 0; j < n_points; j++, data++, i += 2) {
+            data->point.x = ops[i];
+            data->point.y = ops[i + 1];
+        }
+    }
+
+    return path;
+}
+
+GJS_NATIVE_CONSTRUCTOR_DECLARE(cairo_path)
+{
+    GJS_NATIVE_CONSTRUCTOR_VARIABLES(cairo_path)
+    JS::RootedObject ops(context);
+    GjsCairoPath *priv;
+    cairo_path_t *path;
+    size_t error_pos;
+
+    GJS_NATIVE_CONSTRUCTOR_PRELUDE(cairo_path);
+
+    if (!gjs_parse_call_args(context, "Path", argv, "o",
+                             "ops", &ops))
+        return false;
+
+    if (JS_IsFloat64Array(ops)) {
+        JS::AutoCheckCannotGC nogc;
+        path = path_from_ops(JS_GetFloat64ArrayData(ops, nogc),
+                             JS_GetTypedArrayLength(ops), &error_pos);
+    } else if (JS_IsArrayObject(context, ops)) {
+        guint len;
+        if (!JS_GetArrayLength(context, ops, &len))
+            return false;
+
+        std::vector<double> ops_c(len);
+        JS::RootedValue elem(context);
+        for (guint i = 0; i < len; ++i) {
+            if (!JS_GetElement(context, ops, i, &elem) ||
+                !JS::ToNumber(context, elem, &ops_c[i]))
+                return false;
+        }
+        path = path_from_ops(ops_c.data(), len, &error_pos);
+    } else {
+        gjs_throw(context, "Path() expects a Float64Array or an array");
+        return false;
+    }
+
+    if (!path) {
+        gjs_throw(context, "Invalid or truncated path operation at index %"
+                  G_GSIZE_FORMAT, error_pos);
+        return false;
+    }
+
+    priv = g_slice_new0(GjsCairoPath);
+    JS_SetPrivate(object, priv);
+    priv->context = context;
+    priv->object = object;
+    priv->path = path;
+
+    GJS_NATIVE_CONSTRUCTOR_FINISH(cairo_path);
+
+    return true;
+}
+
 static void
 gjs_cairo_path_finalize(JSFreeOp *fop,
                         JSObject *obj)
@@ -56,7 +177,56 @@ JSPropertySpec gjs_cairo_path_proto_props[] = {
     JS_PS_END
 };
 
+static bool
+toOps_func(JSContext *context,
+           unsigned   argc,
+           JS::Value *vp)
+{
+    GJS_GET_PRIV(context, argc, vp, rec, obj, GjsCairoPath, priv);
+    cairo_path_t *path;
+    size_t n_ops = 0;
+    int i;
+
+    if (argc > 0) {
+        gjs_throw(context, "Path.toOps() takes no arguments");
+        return false;
+    }
+
+    if (priv == NULL)
+        return false;
+    path = priv->path;
+    if (!gjs_cairo_check_status(context, path->status, "path"))
+        return false;
+
+    for (i = 0; i < path->num_data; i += path->data[i].header.length)
+        n_ops += 1 + 2 * path_op_n_points(path->data[i].header.type);
+
+    JS::RootedObject array(context, JS_NewFloat64Array(context, n_ops));
+    if (!array)
+        return false;
+
+    {
+        JS::AutoCheckCannotGC nogc;
+        double *ops = JS_GetFloat64ArrayData(array, nogc);
+
+        for (i = 0; i < path->num_data; i += path->data[i].header.length) {
+            const cairo_path_data_t *data = &path->data[i];
+            unsigned n_points = path_op_n_points(data->header.type);
+
+            *ops++ = data->header.type;
+            for (unsigned j = 1; j <= n_points; j++) {
+                *ops++ = data[j].point.x;
+                *ops++ = data[j].point.y;
+            }
+        }
+    }
+
+    rec.rval().setObject(*array);
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_path_proto_funcs[] = {
+    JS_FS("toOps", toOps_func, 0, 0),
     JS_FS_END
 };
 
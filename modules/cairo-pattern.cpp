@@ -125,6 +125,9 @@ gjs_cairo_pattern_construct(JSContext       *context,
     priv->context = context;
     priv->object = object;
     priv->pattern = cairo_pattern_reference(pattern);
+
+    gjs_cairo_wrapper_cache_insert(context, GJS_CAIRO_WRAPPER_PATTERN, pattern,
+                                   object);
 }
 
 /**
@@ -152,8 +155,8 @@ gjs_cairo_pattern_finalize_pattern(JSFreeOp *fop,
  * @context: the context
  * @pattern: cairo_pattern to attach to the object
  *
- * Constructs a pattern wrapper given cairo pattern.
- * A reference to @pattern will be taken.
+ * Returns the wrapper for @pattern, constructing one if it doesn't have a
+ * live one yet. A reference to @pattern will be taken.
  *
  */
 JSObject *
@@ -163,6 +166,12 @@ gjs_cairo_pattern_from_pattern(JSContext       *context,
     g_return_val_if_fail(context != NULL, NULL);
     g_return_val_if_fail(pattern != NULL, NULL);
 
+    JSObject *cached = gjs_cairo_wrapper_cache_lookup(context,
+                                                      GJS_CAIRO_WRAPPER_PATTERN,
+                                                      pattern);
+    if (cached)
+        return cached;
+
     switch (cairo_pattern_get_type(pattern)) {
         case CAIRO_PATTERN_TYPE_SOLID:
             return gjs_cairo_solid_pattern_from_pattern(context, pattern);
@@ -30,6 +30,23 @@ bool             gjs_cairo_check_status                 (JSContext       *contex
                                                          cairo_status_t   status,
                                                          const char      *name);
 
+/* wrapper cache */
+typedef enum {
+    GJS_CAIRO_WRAPPER_SURFACE,
+    GJS_CAIRO_WRAPPER_PATTERN,
+    GJS_CAIRO_WRAPPER_CONTEXT
+} GjsCairoWrapperKind;
+
+void             gjs_cairo_wrapper_cache_insert         (JSContext          *context,
+                                                         GjsCairoWrapperKind kind,
+                                                         void               *native,
+                                                         JS::HandleObject    wrapper);
+JSObject *       gjs_cairo_wrapper_cache_lookup         (JSContext          *context,
+                                                         GjsCairoWrapperKind kind,
+                                                         void               *native);
+void             gjs_cairo_wrapper_cache_remove         (GjsCairoWrapperKind kind,
+                                                         void               *native);
+
 bool gjs_cairo_region_define_proto(JSContext              *cx,
                                    JS::HandleObject        module,
                                    JS::MutableHandleObject proto);
@@ -111,13 +111,94 @@ getType_func(JSContext *context,
     return true;
 }
 
+static bool
+flush_func(JSContext *context,
+           unsigned   argc,
+           JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, rec, obj);
+    cairo_surface_t *surface;
+
+    if (argc > 1) {
+        gjs_throw(context, "Surface.flush() takes no arguments");
+        return false;
+    }
+
+    surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_flush(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+
+    rec.rval().setUndefined();
+    return true;
+}
+
+static bool
+markDirty_func(JSContext *context,
+               unsigned   argc,
+               JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, rec, obj);
+    cairo_surface_t *surface;
+
+    if (argc > 1) {
+        gjs_throw(context, "Surface.markDirty() takes no arguments");
+        return false;
+    }
+
+    surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty(surface);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+
+    rec.rval().setUndefined();
+    return true;
+}
+
+static bool
+markDirtyRectangle_func(JSContext *context,
+                        unsigned   argc,
+                        JS::Value *vp)
+{
+    GJS_GET_THIS(context, argc, vp, argv, obj);
+    cairo_surface_t *surface;
+    int x, y, width, height;
+
+    if (!gjs_parse_call_args(context, "markDirtyRectangle", argv, "iiii",
+                             "x", &x,
+                             "y", &y,
+                             "width", &width,
+                             "height", &height))
+        return false;
+
+    surface = gjs_cairo_surface_get_surface(context, obj);
+    if (!surface)
+        return false;
+
+    cairo_surface_mark_dirty_rectangle(surface, x, y, width, height);
+    if (!gjs_cairo_check_status(context, cairo_surface_status(surface),
+                                "surface"))
+        return false;
+
+    argv.rval().setUndefined();
+    return true;
+}
+
 JSFunctionSpec gjs_cairo_surface_proto_funcs[] = {
-    // flush
+    JS_FS("flush", flush_func, 0, 0),
     // getContent
     // getFontOptions
     JS_FS("getType", getType_func, 0, 0),
-    // markDirty
-    // markDirtyRectangle
+    JS_FS("markDirty", markDirty_func, 0, 0),
+    JS_FS("markDirtyRectangle", markDirtyRectangle_func, 0, 0),
     // setDeviceOffset
     // getDeviceOffset
     // setFallbackResolution
@@ -163,6 +244,9 @@ gjs_cairo_surface_construct(JSContext       *context,
     priv->context = context;
     priv->object = object;
     priv->surface = cairo_surface_reference(surface);
+
+    gjs_cairo_wrapper_cache_insert(context, GJS_CAIRO_WRAPPER_SURFACE, surface,
+                                   object);
 }
 
 /**
@@ -189,8 +273,8 @@ gjs_cairo_surface_finalize_surface(JSFreeOp *fop,
  * @context: the context
  * @surface: cairo_surface to attach to the object
  *
- * Constructs a surface wrapper given cairo surface.
- * A reference to @surface will be taken.
+ * Returns the wrapper for @surface, constructing one if it doesn't have a
+ * live one yet. A reference to @surface will be taken.
  *
  */
 JSObject *
@@ -200,6 +284,12 @@ gjs_cairo_surface_from_surface(JSContext       *context,
     g_return_val_if_fail(context != NULL, NULL);
     g_return_val_if_fail(surface != NULL, NULL);
 
+    JSObject *cached = gjs_cairo_wrapper_cache_lookup(context,
+                                                      GJS_CAIRO_WRAPPER_SURFACE,
+                                                      surface);
+    if (cached)
+        return cached;
+
     cairo_surface_type_t type = cairo_surface_get_type(surface);
     if (type == CAIRO_SURFACE_TYPE_IMAGE)
         return gjs_cairo_image_surface_from_surface(context, surface);
@@ -22,7 +22,12 @@
 
 #include <config.h>
 
+#include <mutex>
+#include <set>
+#include <vector>
+
 #include "cjs/jsapi-util.h"
+#include "cjs/runtime.h"
 #include "cjs/jsapi-wrapper.h"
 #include "cairo-private.h"
 
@@ -55,6 +60,232 @@ gjs_cairo_check_status(JSContext      *context,
     return true;
 }
 
+/* Wrapper cache: each cairo object that has a live JS wrapper carries a
+ * link to it in its user data, so that getTarget(), getSource() etc. return
+ * the same wrapper every time instead of allocating a new one. The link does
+ * not keep the wrapper alive (the wrapper keeps the cairo object alive); it
+ * is updated after each GC like the GObject wrapper back-pointers in
+ * gi/object.cpp, and dropped when the wrapper dies.
+ *
+ * The links are kept in a set per runtime, since each runtime has to update
+ * its own after GC. A link can be freed from any thread (cairo objects may be
+ * released by the background finalizer, or by C code on another thread), so
+ * the set is locked, and it lives until both the runtime and the last of its
+ * links are gone.
+ */
+typedef struct {
+    JSRuntime *runtime;  /* NULL once the runtime is destroyed */
+    unsigned refcount;
+    std::mutex lock;
+    std::set<struct _GjsCairoWrapperLink *> links;
+} GjsCairoWrapperCache;
+
+typedef struct _GjsCairoWrapperLink {
+    GjsCairoWrapperKind kind;
+    void *native;
+    GjsCairoWrapperCache *cache;
+    JS::Heap<JSObject *> wrapper;
+} GjsCairoWrapperLink;
+
+static const char wrapper_cache_key[] = "gjs-cairo-wrapper-cache";
+static cairo_user_data_key_t wrapper_link_key;
+
+static void
+wrapper_cache_unref(GjsCairoWrapperCache *cache)
+{
+    if (g_atomic_int_dec_and_test(&cache->refcount))
+        delete cache;
+}
+
+static void
+wrapper_link_free(void *data)
+{
+    auto link = static_cast<GjsCairoWrapperLink *>(data);
+    GjsCairoWrapperCache *cache = link->cache;
+
+    {
+        std::lock_guard<std::mutex> hold(cache->lock);
+        cache->links.erase(link);
+    }
+    wrapper_cache_unref(cache);
+    delete link;
+}
+
+static void *
+wrapper_link_get(GjsCairoWrapperKind kind,
+                 void               *native)
+{
+    switch (kind) {
+    case GJS_CAIRO_WRAPPER_SURFACE:
+        return cairo_surface_get_user_data(static_cast<cairo_surface_t *>(native),
+                                           &wrapper_link_key);
+    case GJS_CAIRO_WRAPPER_PATTERN:
+        return cairo_pattern_get_user_data(static_cast<cairo_pattern_t *>(native),
+                                           &wrapper_link_key);
+    case GJS_CAIRO_WRAPPER_CONTEXT:
+        return cairo_get_user_data(static_cast<cairo_t *>(native),
+                                   &wrapper_link_key);
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/* Passing NULL for @link removes the current link, freeing it */
+static cairo_status_t
+wrapper_link_set(GjsCairoWrapperKind  kind,
+                 void                *native,
+                 GjsCairoWrapperLink *link)
+{
+    cairo_destroy_func_t destroy = link ? wrapper_link_free : NULL;
+
+    switch (kind) {
+    case GJS_CAIRO_WRAPPER_SURFACE:
+        return cairo_surface_set_user_data(static_cast<cairo_surface_t *>(native),
+                                           &wrapper_link_key, link, destroy);
+    case GJS_CAIRO_WRAPPER_PATTERN:
+        return cairo_pattern_set_user_data(static_cast<cairo_pattern_t *>(native),
+                                           &wrapper_link_key, link, destroy);
+    case GJS_CAIRO_WRAPPER_CONTEXT:
+        return cairo_set_user_data(static_cast<cairo_t *>(native),
+                                   &wrapper_link_key, link, destroy);
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static void
+update_wrapper_links(JSRuntime *rt,
+                     void      *data)
+{
+    auto cache = static_cast<GjsCairoWrapperCache *>(data);
+    std::vector<GjsCairoWrapperLink *> dead;
+
+    {
+        std::lock_guard<std::mutex> hold(cache->lock);
+        for (GjsCairoWrapperLink *link : cache->links) {
+            JS_UpdateWeakPointerAfterGC(&link->wrapper);
+            if (link->wrapper == nullptr)
+                dead.push_back(link);
+        }
+    }
+
+    /* The wrappers will be finalized later, possibly on the background
+     * finalization thread; drop the links now, on the main thread. */
+    for (GjsCairoWrapperLink *link : dead)
+        wrapper_link_set(link->kind, link->native, NULL);
+}
+
+/* Runs just before the runtime is destroyed. Links that outlive it, because C
+ * code still holds their cairo objects, no longer point anywhere. */
+static void
+wrapper_cache_runtime_destroyed(void *data)
+{
+    auto cache = static_cast<GjsCairoWrapperCache *>(data);
+
+    JS_RemoveWeakPointerCallback(cache->runtime, update_wrapper_links);
+    {
+        std::lock_guard<std::mutex> hold(cache->lock);
+        for (GjsCairoWrapperLink *link : cache->links)
+            link->wrapper = nullptr;
+        cache->runtime = NULL;
+    }
+    wrapper_cache_unref(cache);
+}
+
+static GjsCairoWrapperCache *
+wrapper_cache_for_runtime(JSRuntime *rt)
+{
+    auto cache = static_cast<GjsCairoWrapperCache *>(
+        gjs_runtime_get_data(rt, wrapper_cache_key));
+    if (cache)
+        return cache;
+
+    cache = new GjsCairoWrapperCache;
+    cache->runtime = rt;
+    cache->refcount = 1;
+    JS_AddWeakPointerCallback(rt, update_wrapper_links, cache);
+    gjs_runtime_set_data(rt, wrapper_cache_key, cache,
+                         wrapper_cache_runtime_destroyed);
+    return cache;
+}
+
+/**
+ * gjs_cairo_wrapper_cache_insert:
+ * @context: the context
+ * @kind: which kind of cairo object @native is
+ * @native: a cairo_surface_t, cairo_pattern_t or cairo_t
+ * @wrapper: the JS wrapper for @native
+ *
+ * Records @wrapper as the wrapper for @native, so that subsequent calls to
+ * gjs_cairo_wrapper_cache_lookup() return it while it is alive.
+ */
+void
+gjs_cairo_wrapper_cache_insert(JSContext          *context,
+                               GjsCairoWrapperKind kind,
+                               void               *native,
+                               JS::HandleObject    wrapper)
+{
+    GjsCairoWrapperCache *cache =
+        wrapper_cache_for_runtime(JS_GetRuntime(context));
+
+    auto link = new GjsCairoWrapperLink;
+    link->kind = kind;
+    link->native = native;
+    link->cache = cache;
+    link->wrapper = wrapper;
+    g_atomic_int_inc(&cache->refcount);
+
+    {
+        std::lock_guard<std::mutex> hold(cache->lock);
+        cache->links.insert(link);
+    }
+
+    /* Objects in an error state can't carry user data; they just don't get
+     * cached. */
+    if (wrapper_link_set(kind, native, link) != CAIRO_STATUS_SUCCESS)
+        wrapper_link_free(link);
+}
+
+/**
+ * gjs_cairo_wrapper_cache_lookup:
+ * @context: the context
+ * @kind: which kind of cairo object @native is
+ * @native: a cairo_surface_t, cairo_pattern_t or cairo_t
+ *
+ * Returns: the live JS wrapper for @native, or %NULL if there is none in
+ * @context's compartment.
+ */
+JSObject *
+gjs_cairo_wrapper_cache_lookup(JSContext          *context,
+                               GjsCairoWrapperKind kind,
+                               void               *native)
+{
+    auto link = static_cast<GjsCairoWrapperLink *>(wrapper_link_get(kind, native));
+    if (link == NULL || link->cache->runtime != JS_GetRuntime(context))
+        return NULL;
+
+    JSObject *wrapper = link->wrapper;
+    if (wrapper == NULL ||
+        js::GetObjectCompartment(wrapper) != js::GetContextCompartment(context))
+        return NULL;
+    return wrapper;
+}
+
+/**
+ * gjs_cairo_wrapper_cache_remove:
+ * @kind: which kind of cairo object @native is
+ * @native: a cairo_surface_t, cairo_pattern_t or cairo_t
+ *
+ * Forgets the wrapper for @native, for example because it was disposed
+ * while @native is still in use elsewhere.
+ */
+void
+gjs_cairo_wrapper_cache_remove(GjsCairoWrapperKind kind,
+                               void               *native)
+{
+    wrapper_link_set(kind, native, NULL);
+}
+
 bool
 gjs_js_define_cairo_stuff(JSContext              *context,
                           JS::MutableHandleObject module)
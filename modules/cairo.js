@@ -118,6 +118,24 @@ const Operator = {
     HSL_LUMINOSITY : 28
 };
 
+// Opcodes for Context.drawPath(); each is followed by the arguments of
+// the Context method with the same name. Paths only consist of the first
+// four, see Path.toOps() and the Path constructor.
+const PathOp = {
+    MOVE_TO: 0,
+    LINE_TO: 1,
+    CURVE_TO: 2,
+    CLOSE_PATH: 3,
+    REL_MOVE_TO: 4,
+    REL_LINE_TO: 5,
+    REL_CURVE_TO: 6,
+    ARC: 7,
+    ARC_NEGATIVE: 8,
+    RECTANGLE: 9,
+    NEW_SUB_PATH: 10,
+    NEW_PATH: 11
+};
+
 const PatternType = {
     SOLID : 0,
     SURFACE : 1,
@@ -722,6 +722,24 @@ function _convertFunctionCountersToArray(functionCounters) {
     return arrayReturn;
 }
 
+/* Checks whether the cache has an entry for filename that was
+ * computed from the current contents of the file */
+function _cacheEntryIsFresh(filename, cache) {
+    if (!cache || !cache.hasOwnProperty(filename))
+        return false;
+
+    let cache_for_file = cache[filename];
+
+    if (cache_for_file.mtime) {
+        let mtime = getFileModificationTime(filename);
+        return mtime !== null &&
+            mtime[0] == cache_for_file.mtime[0] &&
+            mtime[1] == cache_for_file.mtime[1];
+    }
+
+    return getFileChecksum(filename) == cache_for_file.checksum;
+}
+
 /* Looks up filename in cache and fetches statistics
  * directly from the cache */
 function _fetchCountersFromCache(filename, cache, nLines) {
@@ -731,16 +749,8 @@ function _fetchCountersFromCache(filename, cache, nLines) {
     if (Object.keys(cache).indexOf(filename) !== -1) {
         let cache_for_file = cache[filename];
 
-        if (cache_for_file.mtime) {
-             let mtime = getFileModificationTime(filename);
-             if (mtime[0] != cache[filename].mtime[0] ||
-                 mtime[1] != cache[filename].mtime[1])
-                 return null;
-        } else {
-            let checksum = getFileChecksum(filename);
-            if (checksum != cache[filename].checksum)
-                return null;
-        }
+        if (!_cacheEntryIsFresh(filename, cache))
+            return null;
 
         let functions = cache_for_file.functions;
 
@@ -769,6 +779,29 @@ function _fetchCountersFromReflection(filename, contents, nLines) {
     };
 }
 
+/**
+ * analyzeFile
+ *
+ * Computes the executable lines, branches and functions of a file in the
+ * format used by the coverage cache, and returns them as a JSON string.
+ * This is called on worker threads before any code runs, each with its own
+ * global, so it must not depend on any other state.
+ */
+function analyzeFile(filename) {
+    let reflection = Reflect.parse(getFileContents(filename));
+
+    return JSON.stringify({
+        lines: expressionLinesForAST(reflection),
+        branches: branchesForAST(reflection),
+        functions: functionsForAST(reflection).map(function(func) {
+            return {
+                key: func.key,
+                line: func.line
+            };
+        })
+    });
+}
+
 function CoverageStatisticsContainer(prefixes, cache) {
     /* Copy the files array, so that it can be re-used in the tests */
     let cachedASTs = cache ? JSON.parse(cache) : null;
@@ -802,6 +835,17 @@ function CoverageStatisticsContainer(prefixes, cache) {
 
     this.stringify = function() {
         let cache_data = {};
+
+        /* Keep the entries for files that were analyzed in advance, or
+         * came from the cache, but never ran in this process */
+        if (cachedASTs) {
+            Object.keys(cachedASTs).forEach(function(filename) {
+                if (!coveredFiles[filename] &&
+                    _cacheEntryIsFresh(filename, cachedASTs))
+                    cache_data[filename] = cachedASTs[filename];
+            });
+        }
+
         Object.keys(coveredFiles).forEach(function(filename) {
             let statisticsForFilename = coveredFiles[filename];
             let mtime = getFileModificationTime(filename);
@@ -854,20 +898,91 @@ function CoverageStatisticsContainer(prefixes, cache) {
         return cacheMisses > 0;
     };
 
+    /* Returns the files in filenames which have no usable cache entry */
+    this.staleFiles = function(filenames) {
+        return filenames.filter(function(filename) {
+            return !_cacheEntryIsFresh(filename, cachedASTs);
+        });
+    };
+
+    /* Adds the result of analyzeFile() to the cache, so that
+     * createStatisticsFor() does not need to parse the file again */
+    this.addAnalysis = function(filename, analysis) {
+        let mtime = getFileModificationTime(filename);
+        let cacheDataForFilename = JSON.parse(analysis);
+
+        cacheDataForFilename.mtime = mtime;
+        cacheDataForFilename.checksum = mtime === null ? getFileChecksum(filename) : null;
+
+        if (!cachedASTs)
+            cachedASTs = {};
+        cachedASTs[filename] = cacheDataForFilename;
+        cacheMisses++;
+    };
+
     this.deleteStatistics = function(filename) {
         coveredFiles[filename] = undefined;
     };
 }
 
+/**
+ * _LineBreakpoint
+ *
+ * Breakpoint handler recording hits on one line of a script. A single
+ * handler is installed on every entry point of its line, so it can be
+ * cleared from the script as a unit.
+ *
+ * onHit: called with the frame and the line number when the line is
+ * entered.
+ * firstHitOnly: if true, the handler removes itself after the first hit,
+ * so that further executions of the line run at full speed.
+ */
+function _LineBreakpoint(script, line, onHit, firstHitOnly) {
+    this.hit = function(frame) {
+        if (firstHitOnly)
+            script.clearBreakpoint(this);
+        onHit(frame, line);
+        return undefined;
+    };
+}
+
+/**
+ * _instrumentScript
+ *
+ * Sets a breakpoint on each line entry point in script. Only the lines
+ * the engine reports as having entry points are instrumented, so the
+ * handlers run once per line entered instead of once per bytecode step.
+ */
+function _instrumentScript(script, onHit, firstHitOnly) {
+    let allOffsets = script.getAllOffsets();
+
+    for (let line = 0; line < allOffsets.length; line++) {
+        let offsets = allOffsets[line];
+        if (offsets === undefined)
+            continue;
+
+        let handler = new _LineBreakpoint(script, line, onHit, firstHitOnly);
+        offsets.forEach(function(offset) {
+            script.setBreakpoint(offset, handler);
+        });
+    }
+}
+
 /**
  * Main class tying together the Debugger object and CoverageStatisticsContainer.
  *
+ * Executed lines are recorded with per-line breakpoints, installed the first
+ * time a script is entered. If @firstHitOnly is true, each breakpoint is
+ * removed after its first hit; line hit counts are then capped at one and
+ * branch exits are only recorded the first time they are taken.
+ *
  * It isn't poissible to unit test this class because it depends on running
  * Debugger which in turn depends on objects injected in from another compartment */
-function CoverageStatistics(prefixes, cache, shouldWarn) {
+function CoverageStatistics(prefixes, cache, shouldWarn, firstHitOnly) {
     this.container = new CoverageStatisticsContainer(prefixes, cache);
     let fetchStatistics = this.container.fetchStatistics.bind(this.container);
     let deleteStatistics = this.container.deleteStatistics.bind(this.container);
+    let instrumentedScripts = new WeakMap();
 
     /* 'debuggee' comes from the invocation from
      * a separate compartment inside of coverage.cpp */
@@ -908,14 +1023,16 @@ function CoverageStatistics(prefixes, cache, shouldWarn) {
             return undefined;
         }
 
-        function _logExceptionAndReset(exception, callee, line) {
+        function _logExceptionAndReset(exception, activeFrame, callee, line) {
+            let script = activeFrame.script;
             log(exception.fileName + ":" + exception.lineNumber +
-                " (processing " + frame.script.url + ":" + callee + ":" +
+                " (processing " + script.url + ":" + callee + ":" +
                 line + ") - " + exception.message);
             log("Will not log statistics for this file");
-            frame.onStep = undefined;
-            frame._branchTracker = undefined;
-            deleteStatistics(frame.script.url);
+            script.clearAllBreakpoints();
+            instrumentedScripts.delete(script);
+            activeFrame._branchTracker = undefined;
+            deleteStatistics(script.url);
         }
 
         /* Log function calls */
@@ -933,7 +1050,7 @@ function CoverageStatistics(prefixes, cache, shouldWarn) {
             } catch (e) {
                 /* Something bad happened. Log the exception and delete
                  * statistics for this file */
-                _logExceptionAndReset(e, name, line);
+                _logExceptionAndReset(e, frame, name, line);
                 return undefined;
             }
         }
@@ -941,23 +1058,23 @@ function CoverageStatistics(prefixes, cache, shouldWarn) {
         /* Upon entering the frame, the active branch is always inactive */
         frame._branchTracker = new _BranchTracker(statistics.branchCounters);
 
-        /* Set single-step hook */
-        frame.onStep = function() {
-            /* Line counts */
-            let offset = this.offset;
-            let offsetLine = this.script.getOffsetLine(offset);
-
-            try {
-                _incrementExpressionCounters(statistics.expressionCounters,
-                                             frame.script.url,
-                                             offsetLine, shouldWarn);
-                this._branchTracker.incrementBranchCounters(offsetLine);
-            } catch (e) {
-                /* Something bad happened. Log the exception and delete
-                 * statistics for this file */
-                _logExceptionAndReset(e, frame.callee, offsetLine);
-            }
-        };
+        /* Set line breakpoints, once per script */
+        if (!instrumentedScripts.has(frame.script)) {
+            instrumentedScripts.set(frame.script, true);
+            _instrumentScript(frame.script, function(hitFrame, line) {
+                try {
+                    _incrementExpressionCounters(statistics.expressionCounters,
+                                                 hitFrame.script.url,
+                                                 line, shouldWarn);
+                    if (hitFrame._branchTracker)
+                        hitFrame._branchTracker.incrementBranchCounters(line);
+                } catch (e) {
+                    /* Something bad happened. Log the exception and delete
+                     * statistics for this file */
+                    _logExceptionAndReset(e, hitFrame, hitFrame.callee, line);
+                }
+            }, firstHitOnly);
+        }
 
         return undefined;
     };
@@ -971,4 +1088,6 @@ function CoverageStatistics(prefixes, cache, shouldWarn) {
 
     this.staleCache = this.container.staleCache.bind(this.container);
     this.stringify = this.container.stringify.bind(this.container);
+    this.staleFiles = this.container.staleFiles.bind(this.container);
+    this.addAnalysis = this.container.addAnalysis.bind(this.container);
 }
@@ -21,110 +21,11 @@
 var GLib = imports.gi.GLib;
 var GObject = imports.gi.GObject;
 var CjsPrivate = imports.gi.CjsPrivate;
+var Gi = imports._gi;
 var Lang = imports.lang;
 var Signals = imports.signals;
 var Gio;
 
-function _signatureLength(sig) {
-    var counter = 0;
-    // make it an array
-    var signature = Array.prototype.slice.call(sig);
-    while (signature.length) {
-        GLib._read_single_type(sig);
-        counter++;
-    }
-    return counter;
-}
-
-function _proxyInvoker(methodName, sync, inSignature, arg_array) {
-    var replyFunc;
-    var flags = 0;
-    var cancellable = null;
-
-    /* Convert arg_array to a *real* array */
-    arg_array = Array.prototype.slice.call(arg_array);
-
-    /* The default replyFunc only logs the responses */
-    replyFunc = _logReply;
-
-    var signatureLength = inSignature.length;
-    var minNumberArgs = signatureLength;
-    var maxNumberArgs = signatureLength + 3;
-
-    if (arg_array.length < minNumberArgs) {
-        throw new Error("Not enough arguments passed for method: " + methodName +
-                       ". Expected " + minNumberArgs + ", got " + arg_array.length);
-    } else if (arg_array.length > maxNumberArgs) {
-        throw new Error("Too many arguments passed for method: " + methodName +
-                       ". Maximum is " + maxNumberArgs +
-                        " + one callback and/or flags");
-    }
-
-    while (arg_array.length > signatureLength) {
-        var argNum = arg_array.length - 1;
-        var arg = arg_array.pop();
-        if (typeof(arg) == "function" && !sync) {
-            replyFunc = arg;
-        } else if (typeof(arg) == "number") {
-            flags = arg;
-        } else if (arg instanceof Gio.Cancellable) {
-            cancellable = arg;
-        } else {
-            throw new Error("Argument " + argNum + " of method " + methodName +
-                            " is " + typeof(arg) + ". It should be a callback, flags or a Gio.Cancellable");
-        }
-    }
-
-    var inVariant = new GLib.Variant('(' + inSignature.join('') + ')', arg_array);
-
-    var asyncCallback = function (proxy, result) {
-        var outVariant = null, succeeded = false;
-        try {
-            outVariant = proxy.call_finish(result);
-            succeeded = true;
-        } catch (e) {
-            replyFunc([], e);
-        }
-
-        if (succeeded)
-            replyFunc(outVariant.deep_unpack(), null);
-    };
-
-    if (sync) {
-        return this.call_sync(methodName,
-                              inVariant,
-                              flags,
-                              -1,
-                              cancellable).deep_unpack();
-    } else {
-        return this.call(methodName,
-                         inVariant,
-                         flags,
-                         -1,
-                         cancellable,
-                         asyncCallback);
-    }
-}
-
-function _logReply(result, exc) {
-    if (exc != null) {
-        log("Ignored exception from dbus method: " + exc.toString());
-    }
-}
-
-function _makeProxyMethod(method, sync) {
-    var i;
-    var name = method.name;
-    var inArgs = method.in_args;
-    var inSignature = [ ];
-    for (i = 0; i < inArgs.length; i++)
-        inSignature.push(inArgs[i].signature);
-
-    return function() {
-        return _proxyInvoker.call(this, name, sync, inSignature, arguments);
-    };
-}
-
 function _convertToNativeSignal(proxy, sender_name, signal_name, parameters) {
     Signals._emit.call(proxy, signal_name, sender_name, parameters.deep_unpack());
 }
@@ -161,11 +62,13 @@ function _addDBusConvenience() {
     if (info.signals.length > 0)
         this.connect('g-signal', _convertToNativeSignal);
 
+    // The argument signatures are compiled once per method and shared
+    // between proxies, see gi/dbus.cpp
     let i, methods = info.methods;
     for (i = 0; i < methods.length; i++) {
         var method = methods[i];
-        this[method.name + 'Remote'] = _makeProxyMethod(methods[i], false);
-        this[method.name + 'Sync'] = _makeProxyMethod(methods[i], true);
+        this[method.name + 'Remote'] = Gi.make_proxy_method(method, false);
+        this[method.name + 'Sync'] = Gi.make_proxy_method(method, true);
     }
 
     let properties = info.properties;
@@ -181,6 +84,7 @@ function _addDBusConvenience() {
 
 function _makeProxyWrapper(interfaceXml) {
     var info = _newInterfaceInfo(interfaceXml);
+    info.cache_build();
     var iname = info.name;
     return function(bus, name, object, asyncCallback, cancellable) {
         var obj = new Gio.DBusProxy({ g_connection: bus,
@@ -245,66 +149,6 @@ function _wrapFunction(klass, method, addition) {
     };
 }
 
-function _makeOutSignature(args) {
-    var ret = '(';
-    for (var i = 0; i < args.length; i++)
-        ret += args[i].signature;
-
-    return ret + ')';
-}
-
-function _handleMethodCall(info, impl, method_name, parameters, invocation) {
-    // prefer a sync version if available
-    if (this[method_name]) {
-        let retval;
-        try {
-            retval = this[method_name].apply(this, parameters.deep_unpack());
-        } catch (e) {
-            if (e instanceof GLib.Error) {
-                invocation.return_gerror(e);
-            } else {
-                let name = e.name;
-                if (name.indexOf('.') == -1) {
-                    // likely to be a normal JS error
-                    name = 'org.gnome.gjs.JSError.' + name;
-                }
-                logError(e, "Exception in method call: " + method_name);
-                invocation.return_dbus_error(name, e.message);
-            }
-            return;
-        }
-        if (retval === undefined) {
-            // undefined (no return value) is the empty tuple
-            retval = new GLib.Variant('()', []);
-        }
-        try {
-            if (!(retval instanceof GLib.Variant)) {
-                // attempt packing according to out signature
-                let methodInfo = info.lookup_method(method_name);
-                let outArgs = methodInfo.out_args;
-                let outSignature = _makeOutSignature(outArgs);
-                if (outArgs.length == 1) {
-                    // if one arg, we don't require the handler wrapping it
-                    // into an Array
-                    retval = [retval];
-                }
-                retval = new GLib.Variant(outSignature, retval);
-            }
-            invocation.return_value(retval);
-        } catch(e) {
-            // if we don't do this, the other side will never see a reply
-            invocation.return_dbus_error('org.gnome.gjs.JSError.ValueError',
-                                         "Service implementation returned an incorrect value type");
-        }
-    } else if (this[method_name + 'Async']) {
-        this[method_name + 'Async'](parameters.deep_unpack(), invocation);
-    } else {
-        log('Missing handler for DBus method ' + method_name);
-        invocation.return_gerror(new Gio.DBusError({ code: Gio.DBusError.UNKNOWN_METHOD,
-                                                     message: 'Method ' + method_name + ' is not implemented' }));
-    }
-}
-
 function _handlePropertyGet(info, impl, property_name) {
     let propInfo = info.lookup_property(property_name);
     let jsval = this[property_name];
@@ -327,9 +171,8 @@ function _wrapJSObject(interfaceInfo, jsObj) {
     info.cache_build();
 
     var impl = new CjsPrivate.DBusImplementation({ g_interface_info: info });
-    impl.connect('handle-method-call', function(impl, method_name, parameters, invocation) {
-        return _handleMethodCall.call(jsObj, info, impl, method_name, parameters, invocation);
-    });
+    // Method calls are dispatched natively, see gi/dbus.cpp
+    Gi.export_dbus_object(impl, jsObj);
     impl.connect('handle-property-get', function(impl, property_name) {
         return _handlePropertyGet.call(jsObj, info, impl, property_name);
     });
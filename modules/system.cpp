@@ -24,14 +24,17 @@
 
 #include <config.h>
 
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 
 #include <cjs/context.h>
 
+#include "gi/function.h"
 #include "gi/object.h"
 #include "cjs/context-private.h"
 #include "cjs/jsapi-util-args.h"
+#include "cjs/mem.h"
 #include "system.h"
 
 /* Note that this cannot be relied on to test whether two objects are the same!
@@ -144,6 +147,281 @@ gjs_clear_date_caches(JSContext *context,
     return true;
 }
 
+static bool
+gjs_dump_heap(JSContext *context,
+              unsigned   argc,
+              JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    char *filename;
+    GError *error = NULL;
+
+    if (!gjs_parse_call_args(context, "dumpHeap", argv, "F",
+                             "filename", &filename))
+        return false;
+
+    GjsContext *gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    bool ok = gjs_context_dump_heap(gjs_context, filename, &error);
+    g_free(filename);
+
+    if (!ok) {
+        gjs_throw_g_error(context, error);
+        return false;
+    }
+
+    argv.rval().setUndefined();
+    return true;
+}
+
+static bool
+gjs_start_profiler(JSContext *context,
+                   unsigned   argc,
+                   JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    char *filename = NULL;
+    uint32_t frequency = 0;
+
+    if (!gjs_parse_call_args(context, "startProfiler", argv, "|Fu",
+                             "filename", &filename,
+                             "frequency", &frequency))
+        return false;
+
+    GjsContext *gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    GjsProfiler *profiler = gjs_context_get_profiler(gjs_context);
+
+    if (gjs_profiler_is_running(profiler)) {
+        g_free(filename);
+        gjs_throw(context, "The profiler is already running");
+        return false;
+    }
+
+    if (filename)
+        gjs_profiler_set_filename(profiler, filename);
+    if (frequency > 0)
+        gjs_profiler_set_frequency(profiler, frequency);
+    g_free(filename);
+
+    gjs_profiler_start(profiler);
+    argv.rval().setBoolean(gjs_profiler_is_running(profiler));
+    return true;
+}
+
+static bool
+gjs_stop_profiler(JSContext *context,
+                  unsigned   argc,
+                  JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    if (!gjs_parse_call_args(context, "stopProfiler", argv, ""))
+        return false;
+
+    GjsContext *gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    gjs_profiler_stop(gjs_context_get_profiler(gjs_context));
+    argv.rval().setUndefined();
+    return true;
+}
+
+static bool
+gjs_set_function_stats_enabled(JSContext *context,
+                               unsigned   argc,
+                               JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    bool enabled;
+
+    if (!gjs_parse_call_args(context, "setFunctionStatsEnabled", argv, "b",
+                             "enabled", &enabled))
+        return false;
+
+    gjs_function_stats_set_enabled(enabled);
+    argv.rval().setUndefined();
+    return true;
+}
+
+static bool
+define_stats_number(JSContext       *context,
+                    JS::HandleObject obj,
+                    const char      *name,
+                    double           number)
+{
+    JS::RootedValue value(context, JS::NumberValue(number));
+    return JS_DefineProperty(context, obj, name, value, JSPROP_ENUMERATE);
+}
+
+/* Returns the hottest introspected C functions called on this thread, as
+ * objects with the call counts and the time in nanoseconds spent in the C
+ * function and in marshalling its arguments */
+static bool
+gjs_get_function_stats(JSContext *context,
+                       unsigned   argc,
+                       JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    uint32_t max_entries = 20;
+
+    if (!gjs_parse_call_args(context, "getFunctionStats", argv, "|u",
+                             "maxEntries", &max_entries))
+        return false;
+
+    GPtrArray *top = gjs_function_stats_get_top(max_entries);
+    JS::AutoValueVector elems(context);
+    JS::RootedObject entry(context);
+    JS::RootedValue name(context);
+    bool retval = false;
+
+    for (unsigned i = 0; i < top->len; i++) {
+        auto stats = static_cast<GjsFunctionStats *>(g_ptr_array_index(top, i));
+
+        entry = JS_NewPlainObject(context);
+        if (!entry ||
+            !gjs_string_from_utf8(context, stats->name, -1, &name) ||
+            !JS_DefineProperty(context, entry, "name", name, JSPROP_ENUMERATE) ||
+            !define_stats_number(context, entry, "calls", stats->calls) ||
+            !define_stats_number(context, entry, "callNs", stats->call_ns) ||
+            !define_stats_number(context, entry, "marshalNs", stats->marshal_ns) ||
+            !define_stats_number(context, entry, "exceptions", stats->exceptions) ||
+            !elems.append(JS::ObjectValue(*entry)))
+            goto out;
+    }
+
+    {
+        JSObject *array = JS_NewArrayObject(context, elems);
+        if (!array)
+            goto out;
+        argv.rval().setObject(*array);
+    }
+    retval = true;
+
+ out:
+    g_ptr_array_unref(top);
+    return retval;
+}
+
+/* Returns the live, total and peak number of wrappers for each GType, and
+ * of closures connected to each signal, most live first. An optional kind
+ * ("object", "boxed", "fundamental", "union" or "signal") limits the list
+ * to one kind of counter. */
+static bool
+gjs_get_type_counts(JSContext *context,
+                    unsigned   argc,
+                    JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    char *kind = NULL;
+
+    if (!gjs_parse_call_args(context, "getTypeCounts", argv, "|s",
+                             "kind", &kind))
+        return false;
+
+    unsigned n_counters;
+    GjsTypeCounter **counters = gjs_type_counters_list(&n_counters);
+    JS::AutoValueVector elems(context);
+    JS::RootedObject entry(context);
+    JS::RootedValue value(context);
+    bool retval = false;
+
+    for (unsigned i = 0; i < n_counters; i++) {
+        GjsTypeCounter *counter = counters[i];
+        const char *kind_name = gjs_type_counter_kind_name(counter->kind);
+
+        if (kind && strcmp(kind, kind_name) != 0)
+            continue;
+
+        entry = JS_NewPlainObject(context);
+        if (!entry ||
+            !gjs_string_from_utf8(context, kind_name, -1, &value) ||
+            !JS_DefineProperty(context, entry, "kind", value, JSPROP_ENUMERATE) ||
+            !gjs_string_from_utf8(context, counter->name, -1, &value) ||
+            !JS_DefineProperty(context, entry, "name", value, JSPROP_ENUMERATE) ||
+            !define_stats_number(context, entry, "live", counter->live) ||
+            !define_stats_number(context, entry, "total", counter->total) ||
+            !define_stats_number(context, entry, "peak", counter->peak) ||
+            !elems.append(JS::ObjectValue(*entry)))
+            goto out;
+    }
+
+    {
+        JSObject *array = JS_NewArrayObject(context, elems);
+        if (!array)
+            goto out;
+        argv.rval().setObject(*array);
+    }
+    retval = true;
+
+ out:
+    g_free(counters);
+    g_free(kind);
+    return retval;
+}
+
+static bool
+define_gc_histogram(JSContext            *context,
+                    JS::HandleObject      obj,
+                    const char           *name,
+                    const GjsGCHistogram *histogram)
+{
+    JS::AutoValueVector buckets(context);
+    JS::RootedObject bucket(context);
+
+    for (unsigned i = 0; i < GJS_GC_HISTOGRAM_N_BUCKETS; i++) {
+        bucket = JS_NewPlainObject(context);
+        if (!bucket ||
+            !define_stats_number(context, bucket, "limitMs",
+                                 gjs_gc_histogram_bucket_limit_ms(i)) ||
+            !define_stats_number(context, bucket, "count", histogram->buckets[i]) ||
+            !buckets.append(JS::ObjectValue(*bucket)))
+            return false;
+    }
+
+    JS::RootedObject entry(context, JS_NewPlainObject(context));
+    JS::RootedObject array(context, JS_NewArrayObject(context, buckets));
+    return entry && array &&
+        define_stats_number(context, entry, "count", histogram->n_samples) &&
+        define_stats_number(context, entry, "minMs", histogram->min_ms) &&
+        define_stats_number(context, entry, "maxMs", histogram->max_ms) &&
+        define_stats_number(context, entry, "meanMs", histogram->mean_ms) &&
+        JS_DefineProperty(context, entry, "buckets", array, JSPROP_ENUMERATE) &&
+        JS_DefineProperty(context, obj, name, entry, JSPROP_ENUMERATE);
+}
+
+/* Returns the recent GC activity; see gjs_context_get_gc_stats() */
+static bool
+gjs_get_gc_stats(JSContext *context,
+                 unsigned   argc,
+                 JS::Value *vp)
+{
+    JS::CallArgs argv = JS::CallArgsFromVp (argc, vp);
+    GjsGCStats stats;
+
+    if (!gjs_parse_call_args(context, "getGCStats", argv, ""))
+        return false;
+
+    GjsContext *gjs_context = static_cast<GjsContext *>(JS_GetContextPrivate(context));
+    gjs_context_get_gc_stats(gjs_context, &stats);
+
+    JS::RootedObject retval(context, JS_NewPlainObject(context));
+    JS::RootedValue reason(context);
+    if (!retval ||
+        !define_stats_number(context, retval, "gcCount", stats.n_gcs) ||
+        !define_stats_number(context, retval, "sliceCount", stats.n_slices) ||
+        !gjs_string_from_utf8(context, stats.last_reason, -1, &reason) ||
+        !JS_DefineProperty(context, retval, "lastReason", reason, JSPROP_ENUMERATE) ||
+        !define_stats_number(context, retval, "heapBytesBefore", stats.heap_bytes_before) ||
+        !define_stats_number(context, retval, "heapBytesAfter", stats.heap_bytes_after) ||
+        !define_gc_histogram(context, retval, "pauses", &stats.pauses) ||
+        !define_gc_histogram(context, retval, "slices", &stats.slices) ||
+        !define_gc_histogram(context, retval, "toggleDrains", &stats.toggle_drains) ||
+        !define_stats_number(context, retval, "toggleQueueHighWater", stats.toggle_queue_high_water) ||
+        !define_stats_number(context, retval, "togglesDrained", stats.toggles_drained) ||
+        !define_stats_number(context, retval, "wrappersDisassociated", stats.wrappers_disassociated) ||
+        !define_stats_number(context, retval, "totalWrappersDisassociated", stats.total_wrappers_disassociated))
+        return false;
+
+    argv.rval().setObject(*retval);
+    return true;
+}
+
 static JSFunctionSpec module_funcs[] = {
     JS_FS("addressOf", gjs_address_of, 1, GJS_MODULE_PROP_FLAGS),
     JS_FS("refcount", gjs_refcount, 1, GJS_MODULE_PROP_FLAGS),
@@ -151,6 +429,13 @@ static JSFunctionSpec module_funcs[] = {
     JS_FS("gc", gjs_gc, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("exit", gjs_exit, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS("clearDateCaches", gjs_clear_date_caches, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("dumpHeap", gjs_dump_heap, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS("startProfiler", gjs_start_profiler, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("stopProfiler", gjs_stop_profiler, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("setFunctionStatsEnabled", gjs_set_function_stats_enabled, 1, GJS_MODULE_PROP_FLAGS),
+    JS_FS("getFunctionStats", gjs_get_function_stats, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("getTypeCounts", gjs_get_type_counts, 0, GJS_MODULE_PROP_FLAGS),
+    JS_FS("getGCStats", gjs_get_gc_stats, 0, GJS_MODULE_PROP_FLAGS),
     JS_FS_END
 };
 
@@ -1179,6 +1179,107 @@ test_hits_on_multiline_if_cond(gpointer      fixture_data,
     g_free(coverage_data_contents);
 }
 
+static void
+test_hits_counted_for_each_loop_iteration(gpointer      fixture_data,
+                                          gconstpointer user_data)
+{
+    GjsCoverageFixture *fixture = (GjsCoverageFixture *) fixture_data;
+
+    const char *script_with_loop =
+            "let total = 0;\n"
+            "for (let i = 0; i < 3; i++)\n"
+            "    total += i;\n";
+
+    replace_file(fixture->tmp_js_script, script_with_loop);
+
+    char *coverage_data_contents =
+        eval_script_and_get_coverage_data(fixture->context,
+                                          fixture->coverage,
+                                          fixture->tmp_js_script,
+                                          fixture->lcov_output,
+                                          NULL);
+
+    /* The line breakpoint fires again on every iteration */
+    LineCountIsMoreThanData data = {
+        3,
+        2
+    };
+
+    g_assert(coverage_data_matches_any_value_for_key(coverage_data_contents,
+                                                     "DA:",
+                                                     line_hit_count_is_more_than,
+                                                     &data));
+    g_free(coverage_data_contents);
+}
+
+static GFile *
+find_coverage_record(GFile *dir)
+{
+    GFileEnumerator *files =
+        g_file_enumerate_children(dir, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    GFile *record = NULL;
+
+    while (!record) {
+        GFile *file;
+        GFileInfo *info;
+        if (!g_file_enumerator_iterate(files, &info, &file, NULL, NULL) ||
+            !file || !info)
+            break;
+        if (g_str_has_suffix(g_file_info_get_name(info), ".record"))
+            record = G_FILE(g_object_ref(file));
+    }
+
+    g_object_unref(files);
+    return record;
+}
+
+static void
+test_merged_records_sum_line_hits(gpointer      fixture_data,
+                                  gconstpointer user_data)
+{
+    GjsCoverageFixture *fixture = (GjsCoverageFixture *) fixture_data;
+
+    const char *script_with_loop =
+            "let total = 0;\n"
+            "for (let i = 0; i < 3; i++)\n"
+            "    total += i;\n";
+
+    replace_file(fixture->tmp_js_script, script_with_loop);
+    eval_script(fixture->context, fixture->tmp_js_script);
+    gjs_coverage_write_record(fixture->coverage);
+
+    /* No lcov output is written until the records are merged */
+    g_assert_false(g_file_query_exists(fixture->lcov_output, NULL));
+
+    GFile *record = find_coverage_record(fixture->lcov_output_dir);
+    g_assert_nonnull(record);
+
+    /* Merging the same record twice doubles all the hit counts */
+    GFile *records[] = { record, record };
+    GError *error = NULL;
+    g_assert_true(gjs_coverage_merge_records(fixture->lcov_output_dir,
+                                             records, G_N_ELEMENTS(records),
+                                             &error));
+    g_assert_no_error(error);
+    g_object_unref(record);
+
+    char *coverage_data_contents;
+    g_file_load_contents(fixture->lcov_output, NULL, &coverage_data_contents,
+                         NULL, NULL, NULL);
+
+    LineCountIsMoreThanData data = {
+        3,
+        5
+    };
+
+    g_assert(coverage_data_matches_any_value_for_key(coverage_data_contents,
+                                                     "DA:",
+                                                     line_hit_count_is_more_than,
+                                                     &data));
+    g_free(coverage_data_contents);
+}
+
 static void
 test_full_line_tally_written_to_coverage_data(gpointer      fixture_data,
                                               gconstpointer user_data)
@@ -1978,6 +2079,35 @@ test_coverage_cache_file_written_when_no_cache_exists(gpointer      fixture_data
     g_object_unref(cache_file);
 }
 
+static void
+test_coverage_cache_filled_before_execution(gpointer      fixture_data,
+                                            gconstpointer user_data)
+{
+    GjsCoverageFixture *fixture = (GjsCoverageFixture *) fixture_data;
+    GFile *cache_file = get_coverage_tmp_cache();
+
+    g_clear_object(&fixture->coverage);
+    fixture->coverage = create_coverage_for_script_and_cache(fixture->context,
+                                                             cache_file,
+                                                             fixture->tmp_js_script,
+                                                             fixture->lcov_output_dir);
+
+    /* Files under the coverage prefixes are analyzed when the coverage
+     * object is created, so they end up in the cache without running */
+    gjs_coverage_write_statistics(fixture->coverage);
+
+    char *cache_contents = NULL;
+    g_assert_true(g_file_load_contents(cache_file, NULL, &cache_contents,
+                                       NULL, NULL, NULL));
+
+    char *script_path = get_script_identifier(fixture->tmp_js_script);
+    g_assert_nonnull(strstr(cache_contents, script_path));
+
+    g_free(script_path);
+    g_free(cache_contents);
+    g_object_unref(cache_file);
+}
+
 static GTimeVal
 eval_script_for_cache_mtime(GjsContext  *context,
                             GjsCoverage *coverage,
@@ -2226,6 +2356,14 @@ void gjs_test_add_tests_for_coverage()
                          &coverage_fixture,
                          test_hits_on_multiline_if_cond,
                          NULL);
+    add_test_for_fixture("/gjs/coverage/hits_counted_for_each_loop_iteration",
+                         &coverage_fixture,
+                         test_hits_counted_for_each_loop_iteration,
+                         NULL);
+    add_test_for_fixture("/gjs/coverage/merged_records_sum_line_hits",
+                         &coverage_fixture,
+                         test_merged_records_sum_line_hits,
+                         NULL);
     add_test_for_fixture("/gjs/coverage/full_line_tally_written_to_coverage_data",
                          &coverage_fixture,
                          test_full_line_tally_written_to_coverage_data,
@@ -2377,6 +2515,10 @@ void gjs_test_add_tests_for_coverage()
                          &coverage_fixture,
                          test_coverage_cache_file_written_when_no_cache_exists,
                          NULL);
+    add_test_for_fixture("/gjs/coverage/cache/filled_before_execution",
+                         &coverage_fixture,
+                         test_coverage_cache_filled_before_execution,
+                         NULL);
 
     add_test_for_fixture("/gjs/coverage/cache/no_update_on_full_hits",
                          &coverage_fixture,
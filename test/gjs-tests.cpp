@@ -27,6 +27,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <util/glib.h>
 
 #include <cjs/context.h>
@@ -34,6 +35,7 @@
 #include "cjs/jsapi-wrapper.h"
 #include "gjs-test-utils.h"
 #include "util/error.h"
+#include "util/log.h"
 
 #define VALID_UTF8_STRING "\303\211\303\226 foobar \343\203\237"
 
@@ -377,6 +379,38 @@ gjstest_test_strip_shebang_return_null_for_just_shebang(void)
     g_assert(line_number == -1);
 }
 
+static void
+gjstest_test_func_util_log_buffered_topics(void)
+{
+    char *filename = g_build_filename(g_get_tmp_dir(), "gjs-test-log.txt", NULL);
+
+    if (g_test_subprocess()) {
+        /* The log is configured on first use, which is in this process */
+        g_setenv("GJS_DEBUG_OUTPUT", filename, true);
+        g_setenv("GJS_DEBUG_TOPICS", "JS CTX;JS G BXD", true);
+        g_setenv("GJS_DEBUG_BUFFER", "flush", true);
+
+        gjs_debug(GJS_DEBUG_CONTEXT, "first %d", 1);
+        gjs_debug(GJS_DEBUG_GOBJECT, "filtered out");
+        gjs_debug(GJS_DEBUG_GBOXED, "second\n");
+        gjs_debug_flush();
+
+        char *contents;
+        g_assert(g_file_get_contents(filename, &contents, NULL, NULL));
+        g_assert_cmpstr(contents, ==,
+                        "      JS CTX: first 1\n"
+                        "    JS G BXD: second\n");
+        g_free(contents);
+        return;
+    }
+
+    g_unlink(filename);
+    g_test_trap_subprocess(NULL, 0, G_TEST_SUBPROCESS_INHERIT_STDERR);
+    g_test_trap_assert_passed();
+    g_unlink(filename);
+    g_free(filename);
+}
+
 int
 main(int    argc,
      char **argv)
@@ -397,6 +431,7 @@ main(int    argc,
     g_test_add_func("/gjs/jsutil/strip_shebang/only_shebang", gjstest_test_strip_shebang_return_null_for_just_shebang);
     g_test_add_func("/util/glib/strv/concat/null", gjstest_test_func_util_glib_strv_concat_null);
     g_test_add_func("/util/glib/strv/concat/pointers", gjstest_test_func_util_glib_strv_concat_pointers);
+    g_test_add_func("/util/log/buffered_topics", gjstest_test_func_util_log_buffered_topics);
 
 #define ADD_JSAPI_UTIL_TEST(path, func)                            \
     g_test_add("/gjs/jsapi/util/" path, GjsUnitTestFixture, NULL,  \
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to
+# deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# sell copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+"""Summarize a heap snapshot written by System.dumpHeap().
+
+Prints the GObject wrappers in the heap grouped by GType, and for each type
+the most common paths from a GC root to its wrappers, which tell you what is
+keeping them alive. Wrappers kept alive by their GObject ("rooted") are held
+from the C side; look at who holds a reference to the GObject instead.
+"""
+
+import argparse
+import collections
+import re
+import sys
+
+THING_RE = re.compile(r'^(> )?(0x[0-9a-fA-F]+) (.) (.*)$')
+WRAPPER_RE = re.compile(r'^(0x[0-9a-fA-F]+) gobject (0x[0-9a-fA-F]+) (\S+) '
+                        r'refcount=(\d+) (rooted|weak) signals=(\d+)$')
+
+Wrapper = collections.namedtuple('Wrapper',
+                                 'gobject type refcount state signals')
+
+
+class Heap:
+    def __init__(self):
+        self.roots = []  # (address, root name)
+        self.descriptions = {}  # address -> description
+        self.edges = collections.defaultdict(list)  # address -> [(child, edge name)]
+        self.wrappers = {}  # JS object address -> Wrapper
+
+
+def parse_heap(fp):
+    heap = Heap()
+    section = 'roots'
+    current = None
+
+    for line in fp:
+        line = line.rstrip('\n')
+        if line == '==========':
+            section = 'cells'
+            continue
+        if line == '# GI wrappers.':
+            section = 'wrappers'
+            continue
+        if line.startswith('#') or line.startswith('WeakMapEntry'):
+            continue
+
+        if section == 'wrappers':
+            match = WRAPPER_RE.match(line)
+            if match:
+                address, gobject, gtype, refcount, state, signals = match.groups()
+                heap.wrappers[int(address, 16)] = Wrapper(
+                    int(gobject, 16), gtype, int(refcount), state, int(signals))
+            continue
+
+        match = THING_RE.match(line)
+        if not match:
+            continue
+        is_edge, address, _color, description = match.groups()
+        address = int(address, 16)
+
+        if section == 'roots':
+            heap.roots.append((address, description))
+        elif is_edge:
+            if current is not None:
+                heap.edges[current].append((address, description))
+        else:
+            current = address
+            heap.descriptions[address] = description
+
+    return heap
+
+
+def shortest_retainers(heap):
+    """Breadth-first search from all the roots at once; returns, for every
+    reachable thing, the thing it was reached from and the edge name. Roots
+    map to (None, root name)."""
+    retainers = {}
+    queue = collections.deque()
+
+    for address, name in heap.roots:
+        if address not in retainers:
+            retainers[address] = (None, name)
+            queue.append(address)
+
+    while queue:
+        address = queue.popleft()
+        for child, edge in heap.edges.get(address, ()):
+            if child not in retainers:
+                retainers[child] = (address, edge)
+                queue.append(child)
+
+    return retainers
+
+
+def short_description(heap, address):
+    description = heap.descriptions.get(address, '?')
+    # "Object <Function foo>" is more useful than a bare "Object"
+    return description[:60]
+
+
+def retention_path(heap, retainers, address, max_hops):
+    if address not in retainers:
+        return '(unreachable; will be collected)'
+
+    hops = []
+    while True:
+        parent, edge = retainers[address]
+        if parent is None:
+            hops.append('root "%s"' % edge)
+            break
+        hops.append('[%s] %s' % (edge, short_description(heap, address)))
+        address = parent
+
+    hops.reverse()
+    if len(hops) > max_hops:
+        hops = hops[:2] + ['...'] + hops[-(max_hops - 2):]
+    return ' -> '.join(hops)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('snapshot', help='file written by System.dumpHeap()')
+    parser.add_argument('-t', '--type', action='append', dest='types',
+                        help='only show wrappers of this GType (repeatable)')
+    parser.add_argument('-n', '--top', type=int, default=20,
+                        help='number of types to show (default 20)')
+    parser.add_argument('-p', '--paths', type=int, default=3,
+                        help='retention paths to show per type (default 3)')
+    parser.add_argument('--max-hops', type=int, default=8,
+                        help='shorten retention paths longer than this')
+    args = parser.parse_args()
+
+    with open(args.snapshot) as fp:
+        heap = parse_heap(fp)
+
+    if not heap.wrappers:
+        sys.exit('%s has no GI wrapper section; was it written by '
+                 'System.dumpHeap()?' % args.snapshot)
+
+    by_type = collections.defaultdict(list)
+    for address, wrapper in heap.wrappers.items():
+        if not args.types or wrapper.type in args.types:
+            by_type[wrapper.type].append(address)
+
+    print('%d GC things, %d GObject wrappers\n' % (len(heap.descriptions),
+                                                  len(heap.wrappers)))
+    print('%-40s %8s %8s %8s %8s' % ('GType', 'Wrappers', 'Rooted',
+                                     'Weak', 'Signals'))
+    ranked = sorted(by_type.items(), key=lambda item: -len(item[1]))
+    ranked = ranked[:args.top]
+    for gtype, addresses in ranked:
+        wrappers = [heap.wrappers[a] for a in addresses]
+        rooted = sum(1 for w in wrappers if w.state == 'rooted')
+        print('%-40s %8d %8d %8d %8d' % (gtype, len(wrappers), rooted,
+                                         len(wrappers) - rooted,
+                                         sum(w.signals for w in wrappers)))
+
+    if args.paths <= 0:
+        return
+
+    retainers = shortest_retainers(heap)
+    for gtype, addresses in ranked:
+        paths = collections.Counter()
+        for address in addresses:
+            if heap.wrappers[address].state == 'rooted':
+                paths['(kept alive by a reference to the GObject)'] += 1
+            else:
+                paths[retention_path(heap, retainers, address,
+                                     args.max_hops)] += 1
+
+        print('\n%s:' % gtype)
+        for path, count in paths.most_common(args.paths):
+            print('  %6d  %s' % (count, path))
+
+
+if __name__ == '__main__':
+    main()
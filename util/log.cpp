@@ -26,10 +26,12 @@
 #include "log.h"
 #include "misc.h"
 
+#include <atomic>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/types.h>
 
 #ifdef G_OS_WIN32
@@ -42,243 +44,465 @@
 # include <unistd.h>
 #endif
 
-/* prefix is allowed if it's in the ;-delimited environment variable
- * GJS_DEBUG_TOPICS or if that variable is not set.
+/*
+ * By default each message is written straight to the log with a single
+ * write(), which is atomic for files opened in append mode, so there is no
+ * need to seek or flush.
+ *
+ * GJS_DEBUG_BUFFER selects one of two buffered modes. In both, each thread
+ * formats its messages into its own ring buffer, so logging never takes a
+ * lock or makes a system call:
+ *
+ * - "flush": a background thread writes out the rings every
+ *   LOG_FLUSH_INTERVAL. Messages are dropped (and the drop is reported) if
+ *   a thread logs faster than that.
+ * - "crash": the rings are only kept in memory, overwriting the oldest
+ *   messages, and written out if the process crashes or gjs_debug_flush()
+ *   is called. This is cheap enough to leave lifecycle logging on.
  */
-static bool
-is_allowed_prefix (const char *prefix)
+
+#define PREFIX_LENGTH 12
+#define LOG_LINE_SIZE 512
+#define LOG_RING_SIZE (64 * 1024)
+#define LOG_FLUSH_INTERVAL (100 * 1000)  /* µs */
+
+/* Keep this consistent with GjsDebugTopic */
+static const char *topic_prefixes[] = {
+    "JS GI USE", "JS MEMORY", "JS CTX", "JS IMPORT", "JS NATIVE",
+    "JS KP ALV", "JS G REPO", "JS G NS", "JS G OBJ", "JS G FUNC",
+    "JS G CLSR", "JS G BXD", "JS G ENUM", "JS G PRM", "JS DB", "JS RS",
+    "JS WEAK", "JS MAINLOOP", "JS PROPS", "JS SCOPE", "JS HTTP",
+    "JS BYTE ARRAY", "JS G ERR", "JS G FNDMTL", "JS CPROXY"
+};
+
+G_STATIC_ASSERT(G_N_ELEMENTS(topic_prefixes) == GJS_DEBUG_LAST);
+G_STATIC_ASSERT(GJS_DEBUG_LAST <= 64);
+
+typedef enum {
+    LOG_DISABLED,
+    LOG_DIRECT,
+    LOG_FLUSH_THREAD,
+    LOG_CRASH_RING
+} GjsLogMode;
+
+typedef struct {
+    GjsLogMode mode;
+    int fd;
+    guint64 allowed_topics;
+    bool print_timestamp;
+    GTimer *timer;
+} GjsLogConfig;
+
+/* Single producer (the owning thread), single consumer (whoever holds
+ * drain_lock). Both counters only ever grow; positions in data are taken
+ * modulo LOG_RING_SIZE. */
+typedef struct GjsLogRing {
+    char data[LOG_RING_SIZE];
+    std::atomic<size_t> head;  /* bytes written */
+    std::atomic<size_t> tail;  /* bytes written out, in flush mode */
+    std::atomic<unsigned> n_dropped;
+    struct GjsLogRing *next;
+} GjsLogRing;
+
+static GjsLogConfig log_config;
+
+/* Rings are pushed onto this list when a thread first logs, and are never
+ * freed, so that messages from threads that have exited can still be
+ * written out */
+static std::atomic<GjsLogRing *> all_rings(nullptr);
+static GPrivate thread_ring;
+static GMutex drain_lock;
+
+static void
+write_all(int         fd,
+          const char *buf,
+          size_t      len)
 {
-    static const char *topics = NULL;
-    static char **prefixes = NULL;
-    bool found = false;
-    int i;
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        buf += written;
+        len -= written;
+    }
+}
+
+static GjsLogRing *
+get_thread_ring(void)
+{
+    auto ring = static_cast<GjsLogRing *>(g_private_get(&thread_ring));
+    if (G_LIKELY(ring))
+        return ring;
+
+    ring = new GjsLogRing();
+    ring->head = 0;
+    ring->tail = 0;
+    ring->n_dropped = 0;
+
+    GjsLogRing *first = all_rings.load();
+    do {
+        ring->next = first;
+    } while (!all_rings.compare_exchange_weak(first, ring));
+
+    g_private_set(&thread_ring, ring);
+    return ring;
+}
 
-    if (topics == NULL) {
-        topics = g_getenv("GJS_DEBUG_TOPICS");
+static void
+ring_copy_in(GjsLogRing *ring,
+             size_t      pos,
+             const char *line,
+             size_t      len)
+{
+    size_t offset = pos % LOG_RING_SIZE;
+    size_t first = MIN(len, LOG_RING_SIZE - offset);
 
-        if (!topics)
-            return true;
+    memcpy(ring->data + offset, line, first);
+    memcpy(ring->data, line + first, len - first);
+}
 
-        /* We never really free this, should be gone when the process exits */
-        prefixes = g_strsplit(topics, ";", -1);
+static void
+ring_append(GjsLogRing *ring,
+            const char *line,
+            size_t      len,
+            bool        overwrite)
+{
+    size_t head = ring->head.load(std::memory_order_relaxed);
+
+    if (!overwrite &&
+        head - ring->tail.load(std::memory_order_acquire) + len > LOG_RING_SIZE) {
+        ring->n_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
 
-    if (!prefixes)
-        return true;
+    ring_copy_in(ring, head, line, len);
+    ring->head.store(head + len, std::memory_order_release);
+}
+
+/* Writes out the bytes in [from, to) of the ring; only the last
+ * LOG_RING_SIZE bytes are still there */
+static void
+ring_write_range(GjsLogRing *ring,
+                 int         fd,
+                 size_t      from,
+                 size_t      to)
+{
+    size_t offset = from % LOG_RING_SIZE;
+    size_t len = to - from;
+    size_t first = MIN(len, LOG_RING_SIZE - offset);
 
-    for (i = 0; prefixes[i] != NULL; i++) {
-        if (!strcmp(prefixes[i], prefix)) {
-            found = true;
-            break;
+    write_all(fd, ring->data + offset, first);
+    write_all(fd, ring->data, len - first);
+}
+
+static void
+drain_rings(int fd)
+{
+    g_mutex_lock(&drain_lock);
+
+    for (GjsLogRing *ring = all_rings.load(); ring; ring = ring->next) {
+        size_t head = ring->head.load(std::memory_order_acquire);
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+        if (head != tail) {
+            ring_write_range(ring, fd, tail, head);
+            ring->tail.store(head, std::memory_order_release);
+        }
+
+        unsigned n_dropped = ring->n_dropped.exchange(0);
+        if (n_dropped > 0) {
+            char note[64];
+            int len = g_snprintf(note, sizeof(note),
+                                 "%*s: %u messages dropped\n",
+                                 PREFIX_LENGTH, "JS LOG", n_dropped);
+            write_all(fd, note, len);
         }
     }
 
-    return found;
+    g_mutex_unlock(&drain_lock);
 }
 
-#define PREFIX_LENGTH 12
-
+/* Must be async-signal-safe, it runs from the crash handler */
 static void
-write_to_stream(FILE       *logfp,
-                const char *prefix,
-                const char *s)
+dump_rings(int fd)
 {
-    /* seek to end to avoid truncating in case we're using shared logfile */
-    (void)fseek(logfp, 0, SEEK_END);
+    for (GjsLogRing *ring = all_rings.load(); ring; ring = ring->next) {
+        size_t head = ring->head.load(std::memory_order_acquire);
+        size_t from = 0;
+
+        /* Skip the partly overwritten oldest line */
+        if (head > LOG_RING_SIZE) {
+            from = head - LOG_RING_SIZE;
+            while (from < head && ring->data[from % LOG_RING_SIZE] != '\n')
+                from++;
+            from++;
+        }
 
-    fprintf(logfp, "%*s: %s", PREFIX_LENGTH, prefix, s);
-    if (!g_str_has_suffix(s, "\n"))
-        fputs("\n", logfp);
-    fflush(logfp);
+        if (from < head)
+            ring_write_range(ring, fd, from, head);
+    }
 }
 
-void
-gjs_debug(GjsDebugTopic topic,
-          const char   *format,
-          ...)
+static gpointer
+flush_thread_func(gpointer data)
 {
-    static FILE *logfp = NULL;
-    static bool debug_log_enabled = false;
-    static bool checked_for_timestamp = false;
-    static bool print_timestamp = false;
-    static GTimer *timer = NULL;
-    const char *prefix;
-    va_list args;
-    char *s;
+    while (true) {
+        g_usleep(LOG_FLUSH_INTERVAL);
+        drain_rings(log_config.fd);
+    }
+    return NULL;
+}
+
+static void
+flush_at_exit(void)
+{
+    drain_rings(log_config.fd);
+}
 
-    if (!checked_for_timestamp) {
-        print_timestamp = gjs_environment_variable_is_set("GJS_DEBUG_TIMESTAMP");
-        checked_for_timestamp = true;
+#ifndef G_OS_WIN32
+static const int crash_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+static struct sigaction old_crash_actions[G_N_ELEMENTS(crash_signals)];
+
+/* Puts back whatever handler the application had installed (a crash reporter,
+ * or the default action) and lets it see the signal once we return */
+static void
+crash_handler(int signum)
+{
+    dump_rings(log_config.fd);
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(crash_signals); i++) {
+        if (crash_signals[i] == signum) {
+            sigaction(signum, &old_crash_actions[i], NULL);
+            break;
+        }
     }
+    raise(signum);
+}
+
+static void
+install_crash_handlers(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = crash_handler;
+    sigemptyset(&sa.sa_mask);
 
-    if (print_timestamp && !timer) {
-        timer = g_timer_new();
+    for (unsigned i = 0; i < G_N_ELEMENTS(crash_signals); i++)
+        sigaction(crash_signals[i], &sa, &old_crash_actions[i]);
+}
+#endif
+
+static guint64
+parse_topics(const char *topics)
+{
+    guint64 allowed = 0;
+    char **prefixes;
+
+    /* prefix is allowed if it's in the ;-delimited environment variable
+     * GJS_DEBUG_TOPICS or if that variable is not set. */
+    if (!topics)
+        return G_MAXUINT64;
+
+    prefixes = g_strsplit(topics, ";", -1);
+    for (unsigned topic = 0; topic < GJS_DEBUG_LAST; topic++) {
+        if (g_strv_contains(prefixes, topic_prefixes[topic]))
+            allowed |= G_GUINT64_CONSTANT(1) << topic;
     }
+    g_strfreev(prefixes);
 
-    if (logfp == NULL) {
-        const char *debug_output = g_getenv("GJS_DEBUG_OUTPUT");
-        if (debug_output != NULL &&
-            strcmp(debug_output, "stderr") == 0) {
-            debug_log_enabled = true;
-        } else if (debug_output != NULL) {
-            const char *log_file;
-            char *free_me;
-            char *c;
-
-            /* Allow debug-%u.log for per-pid logfiles as otherwise log
-             * messages from multiple processes can overwrite each other.
-             *
-             * (printf below should be safe as we check '%u' is the only format
-             * string)
-             */
-            c = strchr((char *) debug_output, '%');
-            if (c && c[1] == 'u' && !strchr(c+1, '%')) {
+    return allowed;
+}
+
+static int
+open_log_file(const char *debug_output)
+{
+    const char *log_file;
+    char *free_me;
+    const char *c;
+    int fd;
+
+    /* Allow debug-%u.log for per-pid logfiles as otherwise log
+     * messages from multiple processes can overwrite each other.
+     *
+     * (printf below should be safe as we check '%u' is the only format
+     * string)
+     */
+    c = strchr(debug_output, '%');
+    if (c && c[1] == 'u' && !strchr(c+1, '%')) {
 #if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
 _Pragma("GCC diagnostic push")
 _Pragma("GCC diagnostic ignored \"-Wformat-nonliteral\"")
 #endif
-                free_me = g_strdup_printf(debug_output, (guint)getpid());
+        free_me = g_strdup_printf(debug_output, (guint)getpid());
 #if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)
 _Pragma("GCC diagnostic pop")
 #endif
-                log_file = free_me;
-            } else {
-                log_file = debug_output;
-                free_me = NULL;
-            }
+        log_file = free_me;
+    } else {
+        log_file = debug_output;
+        free_me = NULL;
+    }
 
-            /* avoid truncating in case we're using shared logfile */
-            logfp = fopen(log_file, "a");
-            if (!logfp)
-                fprintf(stderr, "Failed to open log file `%s': %s\n",
-                        log_file, g_strerror(errno));
+    /* avoid truncating in case we're using shared logfile */
+    FILE *logfp = fopen(log_file, "a");
+    if (logfp) {
+        fd = dup(fileno(logfp));
+        fclose(logfp);
+    } else {
+        fprintf(stderr, "Failed to open log file `%s': %s\n",
+                log_file, g_strerror(errno));
+        fd = dup(fileno(stderr));
+    }
 
-            g_free(free_me);
+    g_free(free_me);
+    return fd;
+}
 
-            debug_log_enabled = true;
+static const GjsLogConfig *
+get_log_config(void)
+{
+    static gsize initialized = 0;
+
+    if (G_LIKELY(initialized))
+        return &log_config;
+
+    if (g_once_init_enter(&initialized)) {
+        const char *debug_output = g_getenv("GJS_DEBUG_OUTPUT");
+        const char *buffer_mode = g_getenv("GJS_DEBUG_BUFFER");
+
+        log_config.mode = LOG_DISABLED;
+        log_config.allowed_topics = parse_topics(g_getenv("GJS_DEBUG_TOPICS"));
+        log_config.print_timestamp =
+            gjs_environment_variable_is_set("GJS_DEBUG_TIMESTAMP");
+        if (log_config.print_timestamp)
+            log_config.timer = g_timer_new();
+
+        if (debug_output != NULL) {
+            if (strcmp(debug_output, "stderr") == 0)
+                log_config.fd = fileno(stderr);
+            else
+                log_config.fd = open_log_file(debug_output);
+
+            if (g_strcmp0(buffer_mode, "flush") == 0) {
+                log_config.mode = LOG_FLUSH_THREAD;
+                atexit(flush_at_exit);
+                g_thread_unref(g_thread_new("gjs-log-flush", flush_thread_func, NULL));
+            } else if (g_strcmp0(buffer_mode, "crash") == 0) {
+                log_config.mode = LOG_CRASH_RING;
+#ifndef G_OS_WIN32
+                install_crash_handlers();
+#endif
+            } else {
+                log_config.mode = LOG_DIRECT;
+            }
         }
 
-        if (logfp == NULL)
-            logfp = stderr;
+        g_once_init_leave(&initialized, 1);
     }
 
-    if (!debug_log_enabled)
-        return;
+    return &log_config;
+}
 
-    switch (topic) {
-    case GJS_DEBUG_GI_USAGE:
-        prefix = "JS GI USE";
-        break;
-    case GJS_DEBUG_MEMORY:
-        prefix = "JS MEMORY";
-        break;
-    case GJS_DEBUG_CONTEXT:
-        prefix = "JS CTX";
-        break;
-    case GJS_DEBUG_IMPORTER:
-        prefix = "JS IMPORT";
-        break;
-    case GJS_DEBUG_NATIVE:
-        prefix = "JS NATIVE";
-        break;
-    case GJS_DEBUG_KEEP_ALIVE:
-        prefix = "JS KP ALV";
-        break;
-    case GJS_DEBUG_GREPO:
-        prefix = "JS G REPO";
-        break;
-    case GJS_DEBUG_GNAMESPACE:
-        prefix = "JS G NS";
-        break;
-    case GJS_DEBUG_GOBJECT:
-        prefix = "JS G OBJ";
-        break;
-    case GJS_DEBUG_GFUNCTION:
-        prefix = "JS G FUNC";
-        break;
-    case GJS_DEBUG_GFUNDAMENTAL:
-        prefix = "JS G FNDMTL";
-        break;
-    case GJS_DEBUG_GCLOSURE:
-        prefix = "JS G CLSR";
-        break;
-    case GJS_DEBUG_GBOXED:
-        prefix = "JS G BXD";
-        break;
-    case GJS_DEBUG_GENUM:
-        prefix = "JS G ENUM";
-        break;
-    case GJS_DEBUG_GPARAM:
-        prefix = "JS G PRM";
-        break;
-    case GJS_DEBUG_DATABASE:
-        prefix = "JS DB";
-        break;
-    case GJS_DEBUG_RESULTSET:
-        prefix = "JS RS";
-        break;
-    case GJS_DEBUG_WEAK_HASH:
-        prefix = "JS WEAK";
-        break;
-    case GJS_DEBUG_MAINLOOP:
-        prefix = "JS MAINLOOP";
-        break;
-    case GJS_DEBUG_PROPS:
-        prefix = "JS PROPS";
-        break;
-    case GJS_DEBUG_SCOPE:
-        prefix = "JS SCOPE";
-        break;
-    case GJS_DEBUG_HTTP:
-        prefix = "JS HTTP";
-        break;
-    case GJS_DEBUG_BYTE_ARRAY:
-        prefix = "JS BYTE ARRAY";
-        break;
-    case GJS_DEBUG_GERROR:
-        prefix = "JS G ERR";
-        break;
-    case GJS_DEBUG_PROXY:
-        prefix = "JS CPROXY";
-        break;
-    default:
-        prefix = "???";
-        break;
+/**
+ * gjs_debug_flush:
+ *
+ * Writes out any messages held in the per-thread buffers selected with
+ * GJS_DEBUG_BUFFER. In "crash" mode this dumps the most recent messages
+ * without discarding them.
+ */
+void
+gjs_debug_flush(void)
+{
+    const GjsLogConfig *config = get_log_config();
+
+    if (config->mode == LOG_FLUSH_THREAD)
+        drain_rings(config->fd);
+    else if (config->mode == LOG_CRASH_RING)
+        dump_rings(config->fd);
+}
+
+static size_t
+format_timestamp(const GjsLogConfig *config,
+                 char               *buf,
+                 size_t              size)
+{
+    static gdouble previous = 0.0;
+    gdouble total = g_timer_elapsed(config->timer, NULL) * 1000.0;
+    gdouble since = total - previous;
+    const char *ts_suffix;
+
+    if (since > 50.0) {
+        ts_suffix = "!!  ";
+    } else if (since > 100.0) {
+        ts_suffix = "!!! ";
+    } else if (since > 200.0) {
+        ts_suffix = "!!!!";
+    } else {
+        ts_suffix = "    ";
     }
 
-    if (!is_allowed_prefix(prefix))
-        return;
+    previous = total;
+    return g_snprintf(buf, size, "%g %s", total, ts_suffix);
+}
 
-    va_start (args, format);
-    s = g_strdup_vprintf (format, args);
-    va_end (args);
-
-    if (print_timestamp) {
-        static gdouble previous = 0.0;
-        gdouble total = g_timer_elapsed(timer, NULL) * 1000.0;
-        gdouble since = total - previous;
-        const char *ts_suffix;
-        char *s2;
-
-        if (since > 50.0) {
-            ts_suffix = "!!  ";
-        } else if (since > 100.0) {
-            ts_suffix = "!!! ";
-        } else if (since > 200.0) {
-            ts_suffix = "!!!!";
-        } else {
-            ts_suffix = "    ";
-        }
+void
+gjs_debug(GjsDebugTopic topic,
+          const char   *format,
+          ...)
+{
+    const GjsLogConfig *config = get_log_config();
+    va_list args;
 
-        s2 = g_strdup_printf("%g %s%s",
-                             total, ts_suffix, s);
-        g_free(s);
-        s = s2;
+    if (config->mode == LOG_DISABLED ||
+        !(config->allowed_topics & (G_GUINT64_CONSTANT(1) << topic)))
+        return;
 
-        previous = total;
+    /* Most messages fit in the stack buffer; longer ones fall back to the
+     * heap, except in ring mode where they are truncated to fit the ring */
+    char stack_line[LOG_LINE_SIZE];
+    char *line = stack_line;
+    size_t size = sizeof(stack_line);
+    size_t len;
+
+    len = g_snprintf(line, size, "%*s: ", PREFIX_LENGTH, topic_prefixes[topic]);
+    if (config->print_timestamp)
+        len += format_timestamp(config, line + len, size - len);
+
+    va_start(args, format);
+    size_t msg_len = g_vsnprintf(line + len, size - len, format, args);
+    va_end(args);
+
+    if (len + msg_len + 2 > size && config->mode == LOG_DIRECT) {
+        size = len + msg_len + 2;
+        line = static_cast<char *>(g_malloc(size));
+        memcpy(line, stack_line, len);
+        va_start(args, format);
+        g_vsnprintf(line + len, size - len, format, args);
+        va_end(args);
     }
+    len = MIN(len + msg_len, size - 2);
 
-    write_to_stream(logfp, prefix, s);
+    if (len == 0 || line[len - 1] != '\n')
+        line[len++] = '\n';
+
+    switch (config->mode) {
+    case LOG_DIRECT:
+        write_all(config->fd, line, len);
+        break;
+    case LOG_FLUSH_THREAD:
+        ring_append(get_thread_ring(), line, len, false);
+        break;
+    case LOG_CRASH_RING:
+        ring_append(get_thread_ring(), line, len, true);
+        break;
+    case LOG_DISABLED:
+    default:
+        g_assert_not_reached();
+    }
 
-    g_free(s);
+    if (line != stack_line)
+        g_free(line);
 }
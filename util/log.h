@@ -31,7 +31,7 @@ G_BEGIN_DECLS
 /* The idea of this is to be able to have one big log file for the entire
  * environment, and grep out what you care about. So each module or app
  * should have its own entry in the enum. Be sure to add new enum entries
- * to the switch in log.c
+ * to topic_prefixes in log.cpp
  */
 typedef enum {
     GJS_DEBUG_GI_USAGE,
@@ -59,6 +59,8 @@ typedef enum {
     GJS_DEBUG_GERROR,
     GJS_DEBUG_GFUNDAMENTAL,
     GJS_DEBUG_PROXY,
+
+    GJS_DEBUG_LAST
 } GjsDebugTopic;
 
 /* These defines are because we have some pretty expensive and
@@ -156,6 +158,8 @@ void gjs_debug(GjsDebugTopic topic,
                const char   *format,
                ...) G_GNUC_PRINTF (2, 3);
 
+void gjs_debug_flush(void);
+
 G_END_DECLS
 
 #endif  /* __GJS_UTIL_LOG_H__ */